@@ -0,0 +1,64 @@
+#include "ALU.h"
+
+namespace {
+
+	uint16_t MakeEntry(BYTE result, bool N, bool V, bool Z, bool C)
+	{
+		StatusFlags flags = {};
+		flags.Bits.N = N;
+		flags.Bits.V = V;
+		flags.Bits.Z = Z;
+		flags.Bits.C = C;
+		return (uint16_t)(flags.Byte << 8) | result;
+	}
+
+	uint16_t GetAddEntry(BYTE A, BYTE value, int C, bool decimal)
+	{
+		int binary = A + C + value;
+		bool V = ((A ^ binary) & (value ^ binary) & BIT(7)) > 0;
+		if (!decimal)
+			return MakeEntry(BYTE(binary), (binary & BIT(7)) > 0, V, BYTE(binary) == 0, (binary & 0xFF00) > 0);
+
+		// NMOS: Z comes from the binary sum, N and V from the sum after the low digit was adjusted
+		int low = (A & 0x0F) + (value & 0x0F) + C;
+		if (low >= 0x0A)
+			low = ((low + 0x06) & 0x0F) + 0x10;
+
+		int sum = (A & 0xF0) + (value & 0xF0) + low;
+		int signedSum = (int8_t)(A & 0xF0) + (int8_t)(value & 0xF0) + low;
+		bool N = (sum & BIT(7)) > 0;
+		V = signedSum < -128 || signedSum > 127;
+
+		if (sum >= 0xA0)
+			sum += 0x60;
+		return MakeEntry(BYTE(sum), N, V, BYTE(binary) == 0, sum >= 0x100);
+	}
+
+	uint16_t GetSubEntry(BYTE A, BYTE value, int C, bool decimal)
+	{
+		// The carry is the inverted borrow, in and out, in both modes
+		int binary = A - value - (1 - C);
+		bool V = ((A ^ value) & (A ^ binary) & BIT(7)) > 0;
+		if (!decimal)
+			return MakeEntry(BYTE(binary), (binary & BIT(7)) > 0, V, BYTE(binary) == 0, binary >= 0);
+
+		// NMOS: the flags are those of the binary subtraction, only the result is adjusted
+		int low = (A & 0x0F) - (value & 0x0F) + C - 1;
+		if (low < 0)
+			low = ((low - 0x06) & 0x0F) - 0x10;
+
+		int result = (A & 0xF0) - (value & 0xF0) + low;
+		if (result < 0)
+			result -= 0x60;
+		return MakeEntry(BYTE(result), (binary & BIT(7)) > 0, V, BYTE(binary) == 0, binary >= 0);
+	}
+}
+
+ArithmeticTable::ArithmeticTable(uint16_t (*operation)(BYTE A, BYTE value, int C, bool decimal))
+{
+	for (uint32_t i = 0; i < ARITHMETIC_TABLE_SIZE; i++)
+		Entries[i] = operation(BYTE(i >> 8), BYTE(i), (i >> 16) & 1, (i >> 17) & 1);
+}
+
+const ArithmeticTable ALU::s_Add(GetAddEntry);
+const ArithmeticTable ALU::s_Sub(GetSubEntry);
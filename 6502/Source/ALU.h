@@ -0,0 +1,135 @@
+#pragma once
+
+#include "Base.h"
+#include "MicroCode.h"
+
+struct BitFlags
+{
+	BYTE C : 1;		// Carry (0)
+	BYTE Z : 1;		// Zero (1)
+	BYTE I : 1;		// Interrupt disable (2)
+	BYTE D : 1;		// Decimal (3)
+	BYTE B : 1;		// Break commnd (4)
+	BYTE UB : 1;	// Unused (5)
+	BYTE V : 1;		// Overflow (6)
+	BYTE N : 1;		// Negative (7)
+};
+
+union StatusFlags
+{
+	BitFlags Bits;
+	BYTE Byte;
+};
+
+// Entries of the ADC and SBC tables: the result in the low byte, and N, V, Z and C
+// in the high byte where they sit in PS
+constexpr uint32_t ARITHMETIC_TABLE_SIZE = 2 * 2 * 256 * 256;
+constexpr BYTE ARITHMETIC_FLAGS = 0xC3;
+
+struct ArithmeticTable
+{
+	uint16_t Entries[ARITHMETIC_TABLE_SIZE];
+
+	ArithmeticTable(uint16_t (*operation)(BYTE A, BYTE value, int C, bool decimal));
+};
+
+// What the operations do to the registers once their operand is on the data
+// bus. Shared by every core so they all compute the same results.
+class ALU
+{
+public:
+	static inline void SetZN(StatusFlags& PS, BYTE value)
+	{
+		PS.Bits.Z = value == 0;
+		PS.Bits.N = (value & BIT(7)) > 0;
+	}
+
+	static inline void Load(BYTE& reg, StatusFlags& PS, BYTE value)
+	{
+		reg = value;
+		SetZN(PS, reg);
+	}
+
+	static inline void Compare(BYTE reg, StatusFlags& PS, BYTE value)
+	{
+		int16_t result = reg - value;
+
+		PS.Bits.C = (result & BIT(8)) > 0;
+		PS.Bits.Z = BYTE(result) == 0;
+		PS.Bits.N = (result & BIT(7)) > 0;
+	}
+
+	// ADC and SBC are a single load from tables indexed by the decimal flag, carry, A and the operand
+	static inline uint32_t GetArithmeticIndex(StatusFlags PS, BYTE A, BYTE value)
+	{
+		return ((uint32_t)PS.Bits.D << 17) | ((uint32_t)PS.Bits.C << 16) | ((uint32_t)A << 8) | value;
+	}
+
+	static inline void SetArithmeticResult(BYTE& A, StatusFlags& PS, uint16_t entry)
+	{
+		A = BYTE(entry);
+		PS.Byte = (PS.Byte & ~ARITHMETIC_FLAGS) | BYTE(entry >> 8);
+	}
+
+	static inline void Add(BYTE& A, StatusFlags& PS, BYTE value)	{ SetArithmeticResult(A, PS, s_Add.Entries[GetArithmeticIndex(PS, A, value)]); }
+	static inline void Sub(BYTE& A, StatusFlags& PS, BYTE value)	{ SetArithmeticResult(A, PS, s_Sub.Entries[GetArithmeticIndex(PS, A, value)]); }
+
+	static inline const uint16_t* GetAddTable() { return s_Add.Entries; }
+	static inline const uint16_t* GetSubTable() { return s_Sub.Entries; }
+
+	static inline void And(BYTE& A, StatusFlags& PS, BYTE value)			{ A &= value; SetZN(PS, A); }
+	static inline void Or(BYTE& A, StatusFlags& PS, BYTE value)				{ A |= value; SetZN(PS, A); }
+	static inline void ExclusiveOr(BYTE& A, StatusFlags& PS, BYTE value)	{ A ^= value; SetZN(PS, A); }
+
+	static inline BYTE ShiftLeft(StatusFlags& PS, BYTE value, bool withC)
+	{
+		bool setC = (value & BIT(7)) > 0;
+		value <<= 1;
+		if (withC && PS.Bits.C)
+			value |= BIT(0);
+		PS.Bits.C = setC ? 1 : 0;
+		SetZN(PS, value);
+		return value;
+	}
+
+	static inline BYTE ShiftRight(StatusFlags& PS, BYTE value, bool withC)
+	{
+		bool setC = (value & BIT(0)) > 0;
+		value >>= 1;
+		if (withC && PS.Bits.C)
+			value |= BIT(7);
+		PS.Bits.C = setC ? 1 : 0;
+		SetZN(PS, value);
+		return value;
+	}
+
+	static inline BYTE Decrement(StatusFlags& PS, BYTE value)	{ value--; SetZN(PS, value); return value; }
+	static inline BYTE Increment(StatusFlags& PS, BYTE value)	{ value++; SetZN(PS, value); return value; }
+
+	static inline void TestBit(BYTE A, StatusFlags& PS, BYTE value)
+	{
+		PS.Bits.Z = (A & value) == 0;
+		PS.Bits.V = (value & BIT(6)) > 0;
+		PS.Bits.N = (value & BIT(7)) > 0;
+	}
+
+	static inline bool IsBranchTaken(Operation op, StatusFlags PS)
+	{
+		switch (op)
+		{
+			case Operation::BCC: return PS.Bits.C == 0;
+			case Operation::BCS: return PS.Bits.C == 1;
+			case Operation::BNE: return PS.Bits.Z == 0;
+			case Operation::BEQ: return PS.Bits.Z == 1;
+			case Operation::BPL: return PS.Bits.N == 0;
+			case Operation::BMI: return PS.Bits.N == 1;
+			case Operation::BVC: return PS.Bits.V == 0;
+			case Operation::BVS: return PS.Bits.V == 1;
+			default: return false;
+		}
+	}
+
+private:
+	static const ArithmeticTable s_Add;
+	static const ArithmeticTable s_Sub;
+};
@@ -4,5 +4,11 @@
 
 #define BIT(x) (1 << x)
 
+#ifdef _MSC_VER
+	#define FORCE_INLINE __forceinline
+#else
+	#define FORCE_INLINE inline __attribute__((always_inline))
+#endif
+
 using BYTE = uint8_t;
 using WORD = uint16_t;
\ No newline at end of file
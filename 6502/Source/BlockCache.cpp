@@ -0,0 +1,101 @@
+#include "BlockCache.h"
+
+namespace {
+
+	bool EndsBlock(Operation op)
+	{
+		switch (op)
+		{
+			case Operation::BCC: case Operation::BCS: case Operation::BNE: case Operation::BEQ:
+			case Operation::BPL: case Operation::BMI: case Operation::BVC: case Operation::BVS:
+			case Operation::BRK: case Operation::RTI: case Operation::JMP: case Operation::JSR: case Operation::RTS:
+				return true;
+			default:
+				return false;
+		}
+	}
+}
+
+const DecodedBlock* BlockCache::Find(WORD PC, const PageTable& pages)
+{
+	auto [it, inserted] = m_Blocks.try_emplace(PC);
+	DecodedBlock& block = it->second;
+
+	if (inserted)
+	{
+		Decode(PC, pages, block);
+	}
+	else if (!block.IsValid())
+	{
+		m_Invalidations++;
+		Decode(PC, pages, block);
+	}
+	else
+	{
+		m_Hits++;
+	}
+
+	return block.Instructions.empty() ? nullptr : &block;
+}
+
+void BlockCache::Clear()
+{
+	m_Blocks.clear();
+}
+
+void BlockCache::Decode(WORD start, const PageTable& pages, DecodedBlock& block)
+{
+	m_Decodes++;
+	block.Instructions.clear();
+	block.PageCount = 0;
+
+	WORD address = start;
+	while (block.Instructions.size() < BLOCK_MAX_INSTRUCTIONS)
+	{
+		const Page& page = pages.GetPage(address);
+		if (page.Data == nullptr || !AddPage(block, page))
+			break;
+
+		DecodedInstruction instruction;
+		instruction.Address = address;
+		instruction.Opcode = page.Data[address & 0xFF];
+		instruction.Program = &MicroCode::GetProgram(instruction.Opcode);
+		if (instruction.Program->Length == 0)
+			break;
+
+		// The whole instruction must come from cacheable pages
+		bool complete = true;
+		for (BYTE i = 1; i < instruction.Program->Bytes && complete; i++)
+		{
+			WORD operandAddress = address + i;
+			const Page& operandPage = pages.GetPage(operandAddress);
+			complete = operandPage.Data != nullptr && AddPage(block, operandPage);
+			if (complete && i <= instruction.Operand.size())
+				instruction.Operand[i - 1] = operandPage.Data[operandAddress & 0xFF];
+		}
+		if (!complete)
+			break;
+
+		block.Instructions.push_back(instruction);
+		address += instruction.Program->Bytes;
+
+		if (EndsBlock(instruction.Program->Op))
+			break;
+	}
+}
+
+bool BlockCache::AddPage(DecodedBlock& block, const Page& page)
+{
+	for (uint32_t i = 0; i < block.PageCount; i++)
+	{
+		if (block.Pages[i] == page.Generation)
+			return true;
+	}
+	if (block.PageCount == BLOCK_MAX_PAGES)
+		return false;
+
+	block.Pages[block.PageCount] = page.Generation;
+	block.Generations[block.PageCount] = *page.Generation;
+	block.PageCount++;
+	return true;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Base.h"
+#include "MicroCode.h"
+#include "PageTable.h"
+
+#include <array>
+#include <unordered_map>
+#include <vector>
+
+constexpr uint32_t BLOCK_MAX_INSTRUCTIONS = 32;
+constexpr uint32_t BLOCK_MAX_PAGES = 2;
+
+struct DecodedInstruction
+{
+	const MicroProgram* Program = nullptr;
+	WORD Address = 0;
+	BYTE Opcode = 0;
+	std::array<BYTE, 2> Operand = {};	// The bytes following the opcode
+};
+
+// A straight run of instructions ending at the first jump, branch, return or
+// interrupt. It stays valid as long as none of the pages it was decoded from
+// have been written to since.
+struct DecodedBlock
+{
+	std::vector<DecodedInstruction> Instructions;
+	std::array<const uint32_t*, BLOCK_MAX_PAGES> Pages = {};
+	std::array<uint32_t, BLOCK_MAX_PAGES> Generations = {};
+	uint32_t PageCount = 0;
+
+	inline bool IsValid() const
+	{
+		for (uint32_t i = 0; i < PageCount; i++)
+		{
+			if (*Pages[i] != Generations[i])
+				return false;
+		}
+		return true;
+	}
+};
+
+// Decodes the code the CPU runs into blocks once, keyed by their start address.
+// Only pages backed by a single memory are cached, device reads have side effects.
+class BlockCache
+{
+public:
+	BlockCache() = default;
+	~BlockCache() = default;
+
+	// Returns the block starting at PC, decoding it on a miss or when its pages changed (nullptr if PC cannot be cached)
+	const DecodedBlock* Find(WORD PC, const PageTable& pages);
+	// Must be called whenever the page table is remapped
+	void Clear();
+
+	inline uint64_t GetHits() const { return m_Hits; }
+	inline uint64_t GetDecodes() const { return m_Decodes; }
+	inline uint64_t GetInvalidations() const { return m_Invalidations; }
+
+private:
+	void Decode(WORD start, const PageTable& pages, DecodedBlock& block);
+	bool AddPage(DecodedBlock& block, const Page& page);
+
+	std::unordered_map<WORD, DecodedBlock> m_Blocks;
+
+	uint64_t m_Hits = 0;
+	uint64_t m_Decodes = 0;
+	uint64_t m_Invalidations = 0;
+};
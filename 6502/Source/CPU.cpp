@@ -1,7 +1,9 @@
 #include "CPU.h"
 
 #include "Log.h"
-#include "OperationCodes.h"
+#include "TraceFile.h"
+
+#include <algorithm>
 
 CPU::CPU()
 {
@@ -10,61 +12,399 @@ CPU::CPU()
 
 void CPU::Reset()
 {
-	ClearInstructionQueue();
-
-	m_InstructionQueue.push([&]()
-		{
-			PS.Bits.I = 1;
-			SP = 0x00;
-		});
-	m_InstructionQueue.push([&]() {});
-	m_InstructionQueue.push([&]() {});
-	m_InstructionQueue.push([&]()
-		{
-			AddressBus = BIT(8) | SP;
-			SetDataBusFromMemory();
-		});
-	m_InstructionQueue.push([&]()
-		{
-			AddressBus = BIT(8) | (SP - 1);
-			SetDataBusFromMemory();
-		});
-	m_InstructionQueue.push([&]()
-		{
-			AddressBus = BIT(8) | (SP - 2);
-			SetDataBusFromMemory();
-		});
-	m_InstructionQueue.push([&]()
-		{
-			SP = 0xFD;
-			PC = 0xFFFC;
-			AddressBus = PC++;
-			SetDataBusFromMemory();
-			m_ADL = DataBus;
-		});
-	m_InstructionQueue.push([&]()
-		{
-			AddressBus = PC;
-			SetDataBusFromMemory();
-			m_ADH = DataBus;
-			PC = ((WORD)m_ADH << 8) | m_ADL;
-		});
+	m_Program = &MicroCode::GetResetProgram();
+	m_Cycle = 0;
+	m_Decoded = nullptr;
+	m_Stepper = m_UseSteppedCore ? &CPU::StepReset : nullptr;
+	m_Resume = 0;
 }
 
 void CPU::RunCycle(Memory* SRAM, Memory* EEPROM)
+{
+	AttachMemory(SRAM, EEPROM);
+	RunCycle();
+	SyncFlags();
+}
+
+uint32_t CPU::RunInstruction(Memory* SRAM, Memory* EEPROM)
+{
+	AttachMemory(SRAM, EEPROM);
+	uint32_t cycles = RunInstruction();
+	SyncFlags();
+	return cycles;
+}
+
+void CPU::AttachMemory(Memory* SRAM, Memory* EEPROM)
 {
 	m_HandleSRAM = SRAM;
 	m_HandleEEPROM = EEPROM;
 
-	if (!m_InstructionQueue.empty())
+	if (m_PageTable.IsOutdated(SRAM, EEPROM, m_HandleIO))
+		RemapPages();
+}
+
+void CPU::RemapPages()
+{
+	m_PageTable.Map(m_HandleSRAM, m_HandleEEPROM, m_HandleIO);
+
+	// The cached blocks point into the pages of the old layout
+	m_BlockCache.Clear();
+	m_Block = nullptr;
+	m_Decoded = nullptr;
+	m_IdleLoops.Clear();
+	if (m_Jit)
+		m_Jit->Clear();
+	if (m_Static)
+		m_Static->Map(m_PageTable, m_HandleEEPROM);
+}
+
+void CPU::AttachDevices(DeviceBus* IO)
+{
+	m_HandleIO = IO;
+
+	// The pages tell the I/O apart from memory
+	if (m_HandleSRAM != nullptr && m_PageTable.IsOutdated(m_HandleSRAM, m_HandleEEPROM, m_HandleIO))
+		RemapPages();
+}
+
+void CPU::AttachMapper(Mapper* mapper)
+{
+	m_PageTable.AttachMapper(mapper);
+	if (m_HandleSRAM != nullptr)
+		RemapPages();
+}
+
+void CPU::DetachMapper(Mapper* mapper)
+{
+	m_PageTable.DetachMapper(mapper);
+	if (m_HandleSRAM != nullptr)
+		RemapPages();
+}
+
+inline void CPU::TraceCycle()
+{
+#ifndef DISTRIBUTION_6502
+	if (m_Trace)
+		m_Trace->Push(Cycles, AddressBus, DataBus, DataRead);
+	if (m_TraceWriter)
+	{
+		SyncFlags();
+		m_TraceWriter->Record(*this);
+	}
+#endif
+}
+
+void CPU::RunCycle()
+{
+	Cycles++;
+
+	if (!IsInstructionComplete())
 	{
-		m_InstructionQueue.front()();
-		m_InstructionQueue.pop();
+		m_Cycle++;
+		if (m_Stepper != nullptr)
+			(this->*m_Stepper)(m_Program->Op);
+		else
+			RunMicroOp(m_Program->Cycles[m_Cycle - 1], m_Program->Op);
 	}
 	else
+	{
 		LoadInstruction();
 
-	PRINT_CPU("{0} - {1} {2}", Log::WordToHexString(AddressBus), DataRead ? "\"r\"" : "\"W\"", Log::WordToHexString(DataBus));
+		// The loaded program is always the one of the opcode on the data bus
+		m_Stepper = m_UseSteppedCore ? s_Steppers[DataBus] : nullptr;
+		m_Resume = 0;
+	}
+
+	TraceCycle();
+	if (!m_UseLazyFlags)
+		SyncFlags();
+}
+
+template<Operation Op, AddressingMode Mode, size_t... Cycle>
+FORCE_INLINE void CPU::RunMicroProgram(std::index_sequence<Cycle...>)
+{
+	// Micro-ops ending the instruction early skip the cycles after them
+	([this]
+	{
+		constexpr MicroOp op = MicroCode::MakeProgram(Op, Mode).Cycles[Cycle];
+		if (m_Cycle != Cycle)
+			return;
+
+		Cycles++;
+		m_Cycle++;
+		RunMicroOp(op, Op);
+		TraceCycle();
+	}(), ...);
+}
+
+template<Operation Op, AddressingMode Mode>
+void CPU::RunInstructionBody()
+{
+	constexpr MicroProgram program = MicroCode::MakeProgram(Op, Mode);
+	RunMicroProgram<Op, Mode>(std::make_index_sequence<program.Length>{});
+}
+
+template<size_t... Opcode>
+constexpr std::array<CPU::InstructionHandler, 256> CPU::MakeHandlers(std::index_sequence<Opcode...>)
+{
+	return { &CPU::RunInstructionBody<OPCODE_TABLE[Opcode].Op, OPCODE_TABLE[Opcode].Mode>... };
+}
+
+const std::array<CPU::InstructionHandler, 256> CPU::s_Handlers = CPU::MakeHandlers(std::make_index_sequence<256>{});
+
+uint32_t CPU::RunInstruction()
+{
+	// Finishes an instruction left half-way by RunCycle, otherwise runs the next one
+	uint64_t start = Cycles;
+	m_Stepper = nullptr;
+	if (IsInstructionComplete())
+	{
+		Cycles++;
+		LoadInstruction();
+		TraceCycle();
+
+		// The loaded program is always the one of the opcode on the data bus
+		(this->*s_Handlers[DataBus])();
+	}
+
+	while (!IsInstructionComplete())
+	{
+		Cycles++;
+		RunMicroOp(m_Program->Cycles[m_Cycle++], m_Program->Op);
+		TraceCycle();
+	}
+
+	if (!m_UseLazyFlags)
+		SyncFlags();
+
+	return (uint32_t)(Cycles - start);
+}
+
+void CPU::EnableTrace(uint32_t capacity)
+{
+#ifdef DISTRIBUTION_6502
+	LOG_WARN("Tracing is not available in Distribution builds.");
+#else
+	m_Trace = std::make_unique<TraceBuffer>(capacity);
+#endif
+}
+
+void CPU::DisableTrace()
+{
+	m_Trace.reset();
+}
+
+void CPU::AttachTraceWriter(TraceWriter* writer)
+{
+#ifdef DISTRIBUTION_6502
+	if (writer)
+		LOG_WARN("Tracing is not available in Distribution builds.");
+#else
+	m_TraceWriter = writer;
+#endif
+}
+
+void CPU::EnableBlockCache(bool enable)
+{
+	m_UseBlockCache = enable;
+	m_BlockCache.Clear();
+	m_Block = nullptr;
+	m_Decoded = nullptr;
+}
+
+void CPU::EnableLazyFlags(bool enable)
+{
+	m_UseLazyFlags = enable;
+	SyncFlags();
+}
+
+bool CPU::EnableJit(bool enable)
+{
+	if (!enable)
+	{
+		m_Jit.reset();
+		return true;
+	}
+	if (!Jit::IsSupported())
+	{
+		LOG_WARN("The JIT is only available on x86-64 Linux, running interpreted.");
+		return false;
+	}
+
+	if (!m_Jit)
+		m_Jit = std::make_unique<Jit>();
+	if (!m_Jit->IsAvailable())
+	{
+		m_Jit.reset();
+		return false;
+	}
+	return true;
+}
+
+void CPU::AttachStaticProgram(const StaticProgram* program)
+{
+	if (program == nullptr)
+	{
+		m_Static.reset();
+		return;
+	}
+
+	m_Static = std::make_unique<StaticRunner>(*program);
+	if (m_HandleEEPROM != nullptr)
+		m_Static->Map(m_PageTable, m_HandleEEPROM);
+}
+
+uint64_t CPU::RunCompiled(uint64_t maxCycles)
+{
+	// Interrupts are taken by the interpreter, and traces need every cycle
+	if ((!m_Jit && !m_Static) || NMI || IRQ || !IsInstructionComplete() || m_Trace || m_TraceWriter)
+		return 0;
+
+	SyncFlags();
+
+	JitContext context;
+	context.Cycles = Cycles;
+	context.CycleLimit = Cycles + maxCycles;
+	context.PC = PC;
+	context.AddressBus = AddressBus;
+	context.A = A;
+	context.X = X;
+	context.Y = Y;
+	context.SP = SP;
+	context.PS = PS;
+	context.DataBus = DataBus;
+	context.DataRead = DataRead;
+
+	// Translated firmware first, the JIT picks up from code it does not cover
+	uint64_t cycles = m_Static ? m_Static->Run(context, m_PageTable) : 0;
+	if (m_Jit && context.Cycles < context.CycleLimit)
+		cycles += m_Jit->Run(context, m_BlockCache, m_PageTable);
+	if (cycles == 0)
+		return 0;
+
+	Cycles = context.Cycles;
+	PC = context.PC;
+	AddressBus = context.AddressBus;
+	A = context.A;
+	X = context.X;
+	Y = context.Y;
+	SP = context.SP;
+	PS = context.PS;
+	DataBus = context.DataBus;
+	DataRead = context.DataRead != 0;
+	m_Decoded = nullptr;
+	return cycles;
+}
+
+void CPU::EnableIdleSkip(bool enable)
+{
+	m_UseIdleSkip = enable;
+	m_IdleLoops.Clear();
+}
+
+uint64_t CPU::RunIdleLoop(uint64_t maxCycles)
+{
+	// Interrupts end idle loops, and traces need every cycle
+	if (NMI || IRQ || !IsInstructionComplete() || m_Trace || m_TraceWriter)
+		return 0;
+
+	const IdleLoop& loop = m_IdleLoops.Find(PC, m_PageTable);
+	switch (loop.Kind)
+	{
+	case IdleLoopKind::Idle:
+		return maxCycles >= 2 * IDLE_LOOP_MAX_CYCLES ? RunIdleIterations(loop.Instructions, maxCycles) : 0;
+	case IdleLoopKind::Countdown:
+	case IdleLoopKind::NestedCountdown:
+		return SkipCountdown(loop, maxCycles);
+	default:
+		return 0;
+	}
+}
+
+uint64_t CPU::RunIdleIterations(uint32_t instructions, uint64_t maxCycles)
+{
+	WORD head = PC;
+
+	auto getState = [this]()
+	{
+		SyncFlags();
+		return std::array<BYTE, 17>{ BYTE(PC), BYTE(PC >> 8), SP, PS.Byte, A, X, Y, BYTE(AddressBus), BYTE(AddressBus >> 8),
+			DataBus, BYTE(DataRead), m_BAL, m_BAH, m_ADL, m_ADH, m_IAL, m_IAH };
+	};
+
+	// The first iteration settles whatever the loop loads, the second one must then
+	// leave the CPU exactly as it found it. The loop writes nothing, so every later
+	// iteration would do the same until a device changes what it reads.
+	uint64_t start = Cycles;
+	if (!RunLoopIteration(head, instructions))
+		return Cycles - start;
+
+	auto state = getState();
+	uint64_t iterationStart = Cycles;
+	if (!RunLoopIteration(head, instructions))
+		return Cycles - start;
+
+	uint64_t period = Cycles - iterationStart;
+	if (getState() != state)
+	{
+		m_IdleLoops.Reject(head, m_PageTable);
+		return Cycles - start;
+	}
+
+	uint64_t limit = maxCycles - (Cycles - start);
+	if (m_HandleIO)
+		limit = std::min(limit, m_HandleIO->GetCyclesUntilEvent(Cycles));
+
+	// Devices touched by the probes, or ticked up to now, may have raised an interrupt,
+	// which must be taken at the next instruction rather than after the skip
+	if (NMI || IRQ)
+		return Cycles - start;
+
+	uint64_t skipped = limit / period * period;
+	Cycles += skipped;
+	m_IdleCycles += skipped;
+	return Cycles - start;
+}
+
+uint64_t CPU::SkipCountdown(const IdleLoop& loop, uint64_t maxCycles)
+{
+	bool countsX = loop.Step == Operation::DEX || loop.Step == Operation::INX;
+	BYTE& counter = countsX ? X : Y;
+
+	// Only right after the step and the branch back of the loop itself: the CPU is then
+	// as it will be after every iteration but the last, the counter and its flags aside.
+	// Nested, the inner loop has just counted its register down to 0.
+	SyncFlags();
+	StatusFlags flags = PS;
+	ALU::SetZN(flags, counter);
+	if (m_Program->Op != Operation::BNE || AddressBus != PC || DataBus != loop.BranchOffset || !DataRead || flags.Byte != PS.Byte
+		|| (loop.Kind == IdleLoopKind::NestedCountdown && (countsX ? Y : X) != 0))
+		return 0;
+
+	// The last iteration falls through the branch and is left to the interpreter
+	uint64_t iterations = std::min<uint64_t>(GetCountdownIterations(loop.Step, counter) - 1, maxCycles / loop.Cycles);
+	if (loop.Step == Operation::DEX || loop.Step == Operation::DEY)
+		counter -= (BYTE)iterations;
+	else
+		counter += (BYTE)iterations;
+	SetZN(counter);
+
+	uint64_t skipped = iterations * loop.Cycles;
+	Cycles += skipped;
+	m_IdleCycles += skipped;
+	return skipped;
+}
+
+bool CPU::RunLoopIteration(WORD head, uint32_t instructions)
+{
+	for (uint32_t i = 0; i < instructions; i++)
+	{
+		RunInstruction();
+		if (PC == head)
+			return true;
+	}
+
+	return false;
 }
 
 void CPU::InterruptNMI()
@@ -80,33 +420,63 @@ void CPU::InterruptIRQ()
 	IRQ = true;
 }
 
-void CPU::ClearInstructionQueue()
-{
-	std::queue<std::function<void()>> emptyQueue;
-	std::swap(m_InstructionQueue, emptyQueue);
-}
-
 void CPU::SetDataBusFromMemory()
 {
-	Memory* activeMemory = GetMemoryWithAddress(AddressBus);
+	const Page& page = m_PageTable.GetPage(AddressBus);
+	if (page.Data != nullptr)
+	{
+		DataBus = page.Data[AddressBus & 0xFF];
+		DataRead = true;
+		return;
+	}
+	if (page.Kind == PageKind::IO && m_HandleIO->IsAddressMapped(AddressBus))
+	{
+		DataBus = m_HandleIO->Read(AddressBus, Cycles);
+		DataRead = true;
+		return;
+	}
+
+	Memory* activeMemory = page.Owner != nullptr ? page.Owner : GetMemoryWithAddress(AddressBus);
 	if (activeMemory != nullptr)
 	{
-		DataBus = activeMemory->ReadByte(AddressBus);
+		DataBus = activeMemory->GetData()[AddressBus - activeMemory->GetZeroAddress()];
 		DataRead = true;
 	}
 }
 
 void CPU::WriteMemoryFromDataBus()
 {
-	Memory* activeMemory = GetMemoryWithAddress(AddressBus);
-	if (activeMemory != nullptr)
+	const Page& page = m_PageTable.GetPage(AddressBus);
+	if (page.WritableData != nullptr)
 	{
-		if (activeMemory->IsROM())
-			LOG_ERROR("Writing to read-only memory (address {0})", Log::WordToHexString(AddressBus));
+		page.WritableData[AddressBus & 0xFF] = DataBus;
+		(*page.Generation)++;
+		DataRead = false;
+		return;
+	}
+	if (page.Kind == PageKind::IO && m_HandleIO->IsAddressMapped(AddressBus))
+	{
+		m_HandleIO->Write(AddressBus, DataBus, Cycles);
+		DataRead = false;
+		return;
+	}
 
-		activeMemory->WriteByte(AddressBus, DataBus);
+	Memory* activeMemory = page.Owner != nullptr ? page.Owner : GetMemoryWithAddress(AddressBus);
+	if (activeMemory == nullptr)
+		return;
+	if (activeMemory->IsROM())
+	{
+		LOG_ERROR("Ignoring write to read-only memory (address {0})", Log::WordToHexString(AddressBus));
 		DataRead = false;
+		return;
 	}
+
+	// Writing to a shared image gives the memory its own copy, which the pages must point to
+	bool shared = activeMemory->IsShared();
+	activeMemory->WriteByte(AddressBus, DataBus);
+	if (shared)
+		RemapPages();
+	DataRead = false;
 }
 
 Memory* CPU::GetMemoryWithAddress(const WORD& address)
@@ -120,48 +490,20 @@ Memory* CPU::GetMemoryWithAddress(const WORD& address)
 	return nullptr;
 }
 
-#define EXTRA_CYCLE_CHECK(index, func)						\
-	if (WORD(m_BAL) + index > 0xFF)							\
-	{														\
-		m_InstructionQueue.push([&]()						\
-			{												\
-				m_ADL = m_BAL + index;						\
-				m_ADH = m_BAH + 1;							\
-				AddressBus = ((WORD)m_ADH << 8) | m_ADL;	\
-				##func;									\
-			});												\
-	}														\
-	else													\
-	{														\
-		m_ADL = m_BAL + index;								\
-		m_ADH = m_BAH;										\
-		AddressBus = ((WORD)m_ADH << 8) | m_ADL;			\
-		##func;											\
-	}
+void CPU::LoadInstruction()
+{
+	m_Decoded = !(NMI || IRQ) && m_UseBlockCache ? GetDecodedInstruction() : nullptr;
+	if (m_Decoded != nullptr)
+	{
+		AddressBus = PC++;
+		DataBus = m_Decoded->Opcode;
+		DataRead = true;
 
-#define BRANCH_CHECK(condition)										\
-	if (condition)													\
-	{																\
-		m_InstructionQueue.push([&]()								\
-			{														\
-				if ((PC >> 8) != ((PC + (int8_t)DataBus) >> 8))		\
-				{													\
-					m_InstructionQueue.push([&]()					\
-						{											\
-							PC += (int8_t)DataBus;					\
-							AddressBus = PC;						\
-						});											\
-				}													\
-				else												\
-				{													\
-					PC += (int8_t)DataBus;							\
-					AddressBus = PC;								\
-				}													\
-			});														\
+		m_Program = m_Decoded->Program;
+		m_Cycle = 0;
+		return;
 	}
 
-void CPU::LoadInstruction()
-{
 	if (NMI || IRQ)
 		AddressBus = 0x00;
 	else
@@ -169,1885 +511,525 @@ void CPU::LoadInstruction()
 	
 	SetDataBusFromMemory();
 
-	switch (DataBus)
-	{
-#pragma region Transfer_Instructions
-		case INS_LDA_IM:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC++;
-					SetRegister(A);
-				});
-		} break;
-		case INS_LDA_ZP:	// 3
-		{
-			PushZeroPage();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = m_ADL;
-					SetRegister(A);
-				});
-		} break;
-		case INS_LDA_ZPX:	// 4
-		{
-			PushZeroPageXY();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = (BYTE)(m_BAL + X);
-					SetRegister(A);
-				});
-		} break;
-		case INS_LDA_ABS:	// 4
-		{
-			PushAbsolute();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = ((WORD)m_ADH << 8) | m_ADL;
-					SetRegister(A);
-				});
-		} break;
-		case INS_LDA_ABSX:	// 4(5)
-		{
-			PushAbsoluteXY();
-			m_InstructionQueue.push([&]()
-				{
-					EXTRA_CYCLE_CHECK(X, SetRegister(A))
-				});
-		} break;
-		case INS_LDA_ABSY:	// 4(5)
-		{
-			PushAbsoluteXY();
-			m_InstructionQueue.push([&]()
-				{
-					EXTRA_CYCLE_CHECK(Y, SetRegister(A))
-				});
-		} break;
-		case INS_LDA_INDX:	// 6
-		{
-			PushIndirectX();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = ((WORD)m_ADH << 8) | m_ADL;
-					SetRegister(A);
-				});
-		} break;
-		case INS_LDA_INDY:	// 5(6)
-		{
-			PushIndirectY();
-			m_InstructionQueue.push([&]()
-				{
-					EXTRA_CYCLE_CHECK(Y, SetRegister(A))
-				});
-		} break;
-		case INS_STA_ZP:	// 3
-		{
-			PushZeroPage();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = m_ADL;
-					StoreRegister(A);
-				});
-		} break;
-		case INS_STA_ZPX:	// 4
-		{
-			PushZeroPageXY();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = (BYTE)(m_BAL + X);
-					StoreRegister(A);
-				});
-		} break;
-		case INS_STA_ABS:	// 4
-		{
-			PushAbsolute();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = ((WORD)m_ADH << 8) | m_ADL;
-					StoreRegister(A);
-				});
-		} break;
-		case INS_STA_ABSX:	// 5
-		{
-			PushAbsoluteXY();
-			m_InstructionQueue.push([&]()
-				{
-					m_ADL = m_BAL + X;
-					m_ADH = m_BAH + (WORD(m_BAL) + X > 0xFF ? 1 : 0);
-					AddressBus = ((WORD)m_ADH << 8) | m_ADL;
-				});
-			m_InstructionQueue.push([&]()
-				{
-					StoreRegister(A);
-				});
-		} break;
-		case INS_STA_ABSY:	// 5
-		{
-			PushAbsoluteXY();
-			m_InstructionQueue.push([&]()
-				{
-					m_ADL = m_BAL + Y;
-					m_ADH = m_BAH + (WORD(m_BAL) + Y > 0xFF ? 1 : 0);
-					AddressBus = ((WORD)m_ADH << 8) | m_ADL;
-				});
-			m_InstructionQueue.push([&]()
-				{
-					StoreRegister(A);
-				});
-		} break;
-		case INS_STA_INDX:	// 6
-		{
-			PushIndirectX();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = ((WORD)m_ADH << 8) | m_ADL;
-					StoreRegister(A);
-				});
-		} break;
-		case INS_STA_INDY:	// 6
-		{
-			PushIndirectY();
-			m_InstructionQueue.push([&]()
-				{
-					m_ADL = m_BAL + Y;
-					m_ADH = m_BAH + (WORD(m_BAL) + Y > 0xFF ? 1 : 0);
-					AddressBus = ((WORD)m_ADH << 8) | m_ADL;
-				});
-			m_InstructionQueue.push([&]()
-				{
-					StoreRegister(A);
-				});
-		} break;
-
-		case INS_LDX_IM:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC++;
-					SetRegister(X);
-				});
-		} break;
-		case INS_LDX_ZP:	// 3
-		{
-			PushZeroPage();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = m_ADL;
-					SetRegister(X);
-				});
-		} break;
-		case INS_LDX_ZPY:	// 4
-		{
-			PushZeroPageXY();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = (BYTE)(m_BAL + Y);
-					SetRegister(X);
-				});
-		} break;
-		case INS_LDX_ABS:	// 4
-		{
-			PushAbsolute();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = ((WORD)m_ADH << 8) | m_ADL;
-					SetRegister(X);
-				});
-		} break;
-		case INS_LDX_ABSY:	// 4(5)
-		{
-			PushAbsoluteXY();
-			m_InstructionQueue.push([&]()
-				{
-					EXTRA_CYCLE_CHECK(Y, SetRegister(X))
-				});
-		} break;
-		case INS_LDY_IM:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC++;
-					SetRegister(Y);
-				});
-		} break;
-		case INS_LDY_ZP:	// 3
-		{
-			PushZeroPage();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = m_ADL;
-					SetRegister(Y);
-				});
-		} break;
-		case INS_LDY_ZPX:	// 4
-		{
-			PushZeroPageXY();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = (BYTE)(m_BAL + X);
-					SetRegister(Y);
-				});
-		} break;
-		case INS_LDY_ABS:	// 4
-		{
-			PushAbsolute();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = ((WORD)m_ADH << 8) | m_ADL;
-					SetRegister(Y);
-				});
-		} break;
-		case INS_LDY_ABSX:	// 4(5)
-		{
-			PushAbsoluteXY();
-			m_InstructionQueue.push([&]()
-				{
-					EXTRA_CYCLE_CHECK(X, SetRegister(Y))
-				});
-		} break;
-		case INS_STX_ZP:	// 3
-		{
-			PushZeroPage();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = m_ADL;
-					StoreRegister(X);
-				});
-		} break;
-		case INS_STX_ZPY:	// 4
-		{
-			PushZeroPageXY();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = (BYTE)(m_BAL + Y);
-					StoreRegister(X);
-				});
-		} break;
-		case INS_STX_ABS:	// 4
-		{
-			PushAbsolute();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = ((WORD)m_ADH << 8) | m_ADL;
-					StoreRegister(X);
-				});
-		} break;
-		case INS_STY_ZP:	// 3
-		{
-			PushZeroPage();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = m_ADL;
-					StoreRegister(Y);
-				});
-		} break;
-		case INS_STY_ZPX:	// 4
-		{
-			PushZeroPageXY();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = (BYTE)(m_BAL + X);
-					StoreRegister(Y);
-				});
-		} break;
-		case INS_STY_ABS:	// 4
-		{
-			PushAbsolute();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = ((WORD)m_ADH << 8) | m_ADL;
-					StoreRegister(Y);
-				});
-		} break;
-
-		case INS_TAX_IMP:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC;
-					SetDataBusFromMemory();
-					X = A;
-					PS.Bits.Z = X == 0;
-					PS.Bits.N = (X & BIT(7)) > 0;
-				});
-		} break;
-		case INS_TAY_IMP:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC;
-					SetDataBusFromMemory();
-					Y = A;
-					PS.Bits.Z = Y == 0;
-					PS.Bits.N = (Y & BIT(7)) > 0;
-				});
-		} break;
-		case INS_TSX_IMP:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC;
-					SetDataBusFromMemory();
-					X = SP;
-					PS.Bits.Z = X == 0;
-					PS.Bits.N = (X & BIT(7)) > 0;
-				});
-		} break;
-		case INS_TXA_IMP:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC;
-					SetDataBusFromMemory();
-					A = X;
-					PS.Bits.Z = A == 0;
-					PS.Bits.N = (A & BIT(7)) > 0;
-				});
-		} break;
-		case INS_TXS_IMP:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC;
-					SetDataBusFromMemory();
-					SP = X;
-				});
-		} break;
-		case INS_TYA_IMP:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC;
-					SetDataBusFromMemory();
-					A = Y;
-					PS.Bits.Z = A == 0;
-					PS.Bits.N = (A & BIT(7)) > 0;
-				});
-		} break;
-#pragma endregion
-
-#pragma region PushPull_Instructions
-		case INS_PHA_IMP:	// 3
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC;
-					SetDataBusFromMemory();
-				});
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = BIT(8) | SP--;
-					DataBus = A;
-					WriteMemoryFromDataBus();
-				});
-		} break;
-		case INS_PHP_IMP:	// 3
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC;
-					SetDataBusFromMemory();
-				});
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = BIT(8) | SP--;
-					DataBus = PS.Byte;
-					WriteMemoryFromDataBus();
-				});
-		} break;
-		case INS_PLA_IMP:	// 4
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC;
-					SetDataBusFromMemory();
-				});
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = BIT(8) | SP++;
-					SetDataBusFromMemory();
-				});
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = BIT(8) | SP;
-					SetRegister(A);
-				});
-		} break;
-		case INS_PLP_IMP:	// 4
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC;
-					SetDataBusFromMemory();
-				});
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = BIT(8) | SP++;
-					SetDataBusFromMemory();
-				});
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = BIT(8) | SP;
-					SetDataBusFromMemory();
-					PS.Byte = DataBus;
-				});
-		} break;
-#pragma endregion
+	m_Program = &MicroCode::GetProgram(DataBus);
+	m_Cycle = 0;
 
-#pragma region DecInc_Instructions
-		case INS_DEC_ZP:	// 5
-		{
-			PushZeroPageModified();
-			m_InstructionQueue.push([&]()
-				{
-					DecDB();
-				});
-		} break;
-		case INS_DEC_ZPX:	// 6
-		{
-			PushZeroPageXModified();
-			m_InstructionQueue.push([&]()
-				{
-					DecDB();
-				});
-		} break;
-		case INS_DEC_ABS:	// 6
-		{
-			PushAbsoluteModified();
-			m_InstructionQueue.push([&]()
-				{
-					DecDB();
-				});
-		} break;
-		case INS_DEC_ABSX:	// 7
-		{
-			PushAbsoluteXModified();
-			m_InstructionQueue.push([&]()
-				{
-					DecDB();
-				});
-		} break;
-		case INS_INC_ZP:	// 5
-		{
-			PushZeroPageModified();
-			m_InstructionQueue.push([&]()
-				{
-					IncDB();
-				});
-		} break;
-		case INS_INC_ZPX:	// 6
-		{
-			PushZeroPageXModified();
-			m_InstructionQueue.push([&]()
-				{
-					IncDB();
-				});
-		} break;
-		case INS_INC_ABS:	// 6
-		{
-			PushAbsoluteModified();
-			m_InstructionQueue.push([&]()
-				{
-					IncDB();
-				});
-		} break;
-		case INS_INC_ABSX:	// 7
-		{
-			PushAbsoluteXModified();
-			m_InstructionQueue.push([&]()
-				{
-					IncDB();
-				});
-		} break;
-
-		case INS_DEX_IMP:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC;
-					SetDataBusFromMemory();
-					X--;
-					PS.Bits.Z = X == 0;
-					PS.Bits.N = (X & BIT(7)) > 0;
-				});
-		} break;
-		case INS_INX_IMP:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC;
-					SetDataBusFromMemory();
-					X++;
-					PS.Bits.Z = X == 0;
-					PS.Bits.N = (X & BIT(7)) > 0;
-				});
-		} break;
-		case INS_DEY_IMP:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC;
-					SetDataBusFromMemory();
-					Y--;
-					PS.Bits.Z = Y == 0;
-					PS.Bits.N = (Y & BIT(7)) > 0;
-				});
-		} break;
-		case INS_INY_IMP:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC;
-					SetDataBusFromMemory();
-					Y++;
-					PS.Bits.Z = Y == 0;
-					PS.Bits.N = (Y & BIT(7)) > 0;
-				});
-		} break;
-#pragma endregion
+	if (m_Program->Length == 0)
+		LOG_ERROR("Illegal Opcode ({0}), instruction not handled!", Log::WordToHexString(DataBus));
+}
 
-#pragma region Arithmetic_Instructions
-		case INS_ADC_IM:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC++;
-					AddA();
-				});
-		} break;
-		case INS_ADC_ZP:	// 3
-		{
-			PushZeroPage();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = m_ADL;
-					AddA();
-				});
-		} break;
-		case INS_ADC_ZPX:	// 4
-		{
-			PushZeroPageXY();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = (BYTE)(m_BAL + X);
-					AddA();
-				});
-		} break;
-		case INS_ADC_ABS:	// 4
-		{
-			PushAbsolute();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = ((WORD)m_ADH << 8) | m_ADL;
-					AddA();
-				});
-		} break;
-		case INS_ADC_ABSX:	// 4(5)
-		{
-			PushAbsoluteXY();
-			m_InstructionQueue.push([&]()
-				{
-					EXTRA_CYCLE_CHECK(X, AddA())
-				});
-		} break;
-		case INS_ADC_ABSY:	// 4(5)
-		{
-			PushAbsoluteXY();
-			m_InstructionQueue.push([&]()
-				{
-					EXTRA_CYCLE_CHECK(Y, AddA())
-				});
-		} break;
-		case INS_ADC_INDX:	// 6
-		{
-			PushIndirectX();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = ((WORD)m_ADH << 8) | m_ADL;
-					AddA();
-				});
-		} break;
-		case INS_ADC_INDY:	// 5(6)
-		{
-			PushIndirectY();
-			m_InstructionQueue.push([&]()
-				{
-					EXTRA_CYCLE_CHECK(Y, AddA())
-				});
-		} break;
-
-		case INS_SBC_IM:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC++;
-					SubA();
-				});
-		} break;
-		case INS_SBC_ZP:	// 3
-		{
-			PushZeroPage();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = m_ADL;
-					SubA();
-				});
-		} break;
-		case INS_SBC_ZPX:	// 4
-		{
-			PushZeroPageXY();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = (BYTE)(m_BAL + X);
-					SubA();
-				});
-		} break;
-		case INS_SBC_ABS:	// 4
-		{
-			PushAbsolute();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = ((WORD)m_ADH << 8) | m_ADL;
-					SubA();
-				});
-		} break;
-		case INS_SBC_ABSX:	// 4(5)
-		{
-			PushAbsoluteXY();
-			m_InstructionQueue.push([&]()
-				{
-					EXTRA_CYCLE_CHECK(X, SubA())
-				});
-		} break;
-		case INS_SBC_ABSY:	// 4(5)
-		{
-			PushAbsoluteXY();
-			m_InstructionQueue.push([&]()
-				{
-					EXTRA_CYCLE_CHECK(Y, SubA())
-				});
-		} break;
-		case INS_SBC_INDX:	// 6
-		{
-			PushIndirectX();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = ((WORD)m_ADH << 8) | m_ADL;
-					SubA();
-				});
-		} break;
-		case INS_SBC_INDY:	// 5(6)
-		{
-			PushIndirectY();
-			m_InstructionQueue.push([&]()
-				{
-					EXTRA_CYCLE_CHECK(Y, SubA())
-				});
-		} break;
-#pragma endregion
+const DecodedInstruction* CPU::GetDecodedInstruction()
+{
+	// Straight-line code continues in the block of the previous instruction
+	if (m_Block != nullptr && m_BlockIndex < m_Block->Instructions.size()
+		&& m_Block->Instructions[m_BlockIndex].Address == PC && m_Block->IsValid())
+		return &m_Block->Instructions[m_BlockIndex++];
 
-#pragma region Logical_Instructions
-		case INS_AND_IM:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC++;
-					AndA();
-				});
-		} break;
-		case INS_AND_ZP:	// 3
-		{
-			PushZeroPage();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = m_ADL;
-					AndA();
-				});
-		} break;
-		case INS_AND_ZPX:	// 4
-		{
-			PushZeroPageXY();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = (BYTE)(m_BAL + X);
-					AndA();
-				});
-		} break;
-		case INS_AND_ABS:	// 4
-		{
-			PushAbsolute();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = ((WORD)m_ADH << 8) | m_ADL;
-					AndA();
-				});
-		} break;
-		case INS_AND_ABSX:	// 4(5)
-		{
-			PushAbsoluteXY();
-			m_InstructionQueue.push([&]()
-				{
-					EXTRA_CYCLE_CHECK(X, AndA())
-				});
-		} break;
-		case INS_AND_ABSY:	// 4(5)
-		{
-			PushAbsoluteXY();
-			m_InstructionQueue.push([&]()
-				{
-					EXTRA_CYCLE_CHECK(Y, AndA())
-				});
-		} break;
-		case INS_AND_INDX:	// 6
-		{
-			PushIndirectX();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = ((WORD)m_ADH << 8) | m_ADL;
-					AndA();
-				});
-		} break;
-		case INS_AND_INDY:	// 5(6)
-		{
-			PushIndirectY();
-			m_InstructionQueue.push([&]()
-				{
-					EXTRA_CYCLE_CHECK(Y, AndA())
-				});
-		} break;
-
-		case INS_ORA_IM:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC++;
-					OrA();
-				});
-		} break;
-		case INS_ORA_ZP:	// 3
-		{
-			PushZeroPage();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = m_ADL;
-					OrA();
-				});
-		} break;
-		case INS_ORA_ZPX:	// 4
-		{
-			PushZeroPageXY();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = (BYTE)(m_BAL + X);
-					OrA();
-				});
-		} break;
-		case INS_ORA_ABS:	// 4
-		{
-			PushAbsolute();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = ((WORD)m_ADH << 8) | m_ADL;
-					OrA();
-				});
-		} break;
-		case INS_ORA_ABSX:	// 4(5)
-		{
-			PushAbsoluteXY();
-			m_InstructionQueue.push([&]()
-				{
-					EXTRA_CYCLE_CHECK(X, OrA())
-				});
-		} break;
-		case INS_ORA_ABSY:	// 4(5)
-		{
-			PushAbsoluteXY();
-			m_InstructionQueue.push([&]()
-				{
-					EXTRA_CYCLE_CHECK(Y, OrA())
-				});
-		} break;
-		case INS_ORA_INDX:	// 6
-		{
-			PushIndirectX();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = ((WORD)m_ADH << 8) | m_ADL;
-					OrA();
-				});
-		} break;
-		case INS_ORA_INDY:	// 5(6)
-		{
-			PushIndirectY();
-			m_InstructionQueue.push([&]()
-				{
-					EXTRA_CYCLE_CHECK(Y, OrA())
-				});
-		} break;
-
-		case INS_EOR_IM:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC++;
-					ExclusiveOrA();
-				});
-		} break;
-		case INS_EOR_ZP:	// 3
-		{
-			PushZeroPage();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = m_ADL;
-					ExclusiveOrA();
-				});
-		} break;
-		case INS_EOR_ZPX:	// 4
-		{
-			PushZeroPageXY();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = (BYTE)(m_BAL + X);
-					ExclusiveOrA();
-				});
-		} break;
-		case INS_EOR_ABS:	// 4
-		{
-			PushAbsolute();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = ((WORD)m_ADH << 8) | m_ADL;
-					ExclusiveOrA();
-				});
-		} break;
-		case INS_EOR_ABSX:	// 4(5)
-		{
-			PushAbsoluteXY();
-			m_InstructionQueue.push([&]()
-				{
-					EXTRA_CYCLE_CHECK(X, ExclusiveOrA())
-				});
-		} break;
-		case INS_EOR_ABSY:	// 4(5)
-		{
-			PushAbsoluteXY();
-			m_InstructionQueue.push([&]()
-				{
-					EXTRA_CYCLE_CHECK(Y, ExclusiveOrA())
-				});
-		} break;
-		case INS_EOR_INDX:	// 6
-		{
-			PushIndirectX();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = ((WORD)m_ADH << 8) | m_ADL;
-					ExclusiveOrA();
-				});
-		} break;
-		case INS_EOR_INDY:	// 5(6)
-		{
-			PushIndirectY();
-			m_InstructionQueue.push([&]()
-				{
-					EXTRA_CYCLE_CHECK(Y, ExclusiveOrA())
-				});
-		} break;
-	
-		case INS_ASL_ACC:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					bool setC = (A & BIT(7)) > 0;
-					A <<= 1;
-					PS.Bits.C = setC ? 1 : 0;
-					PS.Bits.Z = A == 0;
-					PS.Bits.N = (A & BIT(7)) > 0;	
-				});
-		} break;
-		case INS_ASL_ZP:	// 5
-		{
-			PushZeroPageModified();
-			m_InstructionQueue.push([&]()
-				{
-					ShiftLeftDB(false);
-				});
-		} break;
-		case INS_ASL_ZPX:	// 6
-		{
-			PushZeroPageXModified();
-			m_InstructionQueue.push([&]()
-				{
-					ShiftLeftDB(false);
-				});
-		} break;
-		case INS_ASL_ABS:	// 6
-		{
-			PushAbsoluteModified();
-			m_InstructionQueue.push([&]()
-				{
-					ShiftLeftDB(false);
-				});
-		} break;
-		case INS_ASL_ABSX:	// 7
-		{
-			PushAbsoluteXModified();
-			m_InstructionQueue.push([&]()
-				{
-					ShiftLeftDB(false);
-				});
-		} break;
-		case INS_LSR_ACC:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					bool setC = (A & BIT(0)) > 0;
-					A >>= 1;
-					PS.Bits.C = setC ? 1 : 0;
-					PS.Bits.Z = A == 0;
-					PS.Bits.N = (A & BIT(7)) > 0;
-				});
-		} break;
-		case INS_LSR_ZP:	// 5
-		{
-			PushZeroPageModified();
-			m_InstructionQueue.push([&]()
-				{
-					ShiftRightDB(false);
-				});
-		} break;
-		case INS_LSR_ZPX:	// 6
-		{
-			PushZeroPageXModified();
-			m_InstructionQueue.push([&]()
-				{
-					ShiftRightDB(false);
-				});
-		} break;
-		case INS_LSR_ABS:	// 6
-		{
-			PushAbsoluteModified();
-			m_InstructionQueue.push([&]()
-				{
-					ShiftRightDB(false);
-				});
-		} break;
-		case INS_LSR_ABSX:	// 7
-		{
-			PushAbsoluteXModified();
-			m_InstructionQueue.push([&]()
-				{
-					ShiftRightDB(false);
-				});
-		} break;
-	
-		case INS_ROL_ACC:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					bool setC = (A & BIT(7)) > 0;
-					A <<= 1;
-					if (PS.Bits.C)
-						A |= BIT(0);
-					PS.Bits.C = setC ? 1 : 0;
-					PS.Bits.Z = A == 0;
-					PS.Bits.N = (A & BIT(7)) > 0;
-				});
-		} break;
-		case INS_ROL_ZP:	// 5
-		{
-			PushZeroPageModified();
-			m_InstructionQueue.push([&]()
-				{
-					ShiftLeftDB(true);
-				});
-		} break;
-		case INS_ROL_ZPX:	// 6
-		{
-			PushZeroPageXModified();
-			m_InstructionQueue.push([&]()
-				{
-					ShiftLeftDB(true);
-				});
-		} break;
-		case INS_ROL_ABS:	// 6
-		{
-			PushAbsoluteModified();
-			m_InstructionQueue.push([&]()
-				{
-					ShiftLeftDB(true);
-				});
-		} break;
-		case INS_ROL_ABSX:	// 7
-		{
-			PushAbsoluteXModified();
-			m_InstructionQueue.push([&]()
-				{
-					ShiftLeftDB(true);
-				});
-		} break;
-		case INS_ROR_ACC:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					bool setC = (A & BIT(0)) > 0;
-					A >>= 1;
-					if (PS.Bits.C)
-						A |= BIT(7);
-					PS.Bits.C = setC ? 1 : 0;
-					PS.Bits.Z = A == 0;
-					PS.Bits.N = (A & BIT(7)) > 0;
-				});
-		} break;
-		case INS_ROR_ZP:	// 5
-		{
-			PushZeroPageModified();
-			m_InstructionQueue.push([&]()
-				{
-					ShiftRightDB(true);
-				});
-		} break;
-		case INS_ROR_ZPX:	// 6
-		{
-			PushZeroPageXModified();
-			m_InstructionQueue.push([&]()
-				{
-					ShiftRightDB(true);
-				});
-		} break;
-		case INS_ROR_ABS:	// 6
-		{
-			PushAbsoluteModified();
-			m_InstructionQueue.push([&]()
-				{
-					ShiftRightDB(true);
-				});
-		} break;
-		case INS_ROR_ABSX:	// 7
-		{
-			PushAbsoluteXModified();
-			m_InstructionQueue.push([&]()
-				{
-					ShiftRightDB(true);
-				});
-		} break;
-#pragma endregion
+	m_Block = m_BlockCache.Find(PC, m_PageTable);
+	m_BlockIndex = 0;
+	if (m_Block == nullptr)
+		return nullptr;
 
-#pragma region Flag_Instructions
-		case INS_CLC_IMP:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC;
-					SetDataBusFromMemory();
-					PS.Bits.C = 0;
-				});
-		} break;
-		case INS_CLD_IMP:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC;
-					SetDataBusFromMemory();
-					PS.Bits.D = 0;
-				});
-		} break;
-		case INS_CLI_IMP:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC;
-					SetDataBusFromMemory();
-					PS.Bits.I = 0;
-				});
-		} break;
-		case INS_CLV_IMP:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC;
-					SetDataBusFromMemory();
-					PS.Bits.V = 0;
-				});
-		} break;
-		case INS_SEC_IMP:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC;
-					SetDataBusFromMemory();
-					PS.Bits.C = 1;
-				});
-		} break;
-		case INS_SED_IMP:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC;
-					SetDataBusFromMemory();
-					PS.Bits.D = 1;
-				});
-		} break;
-		case INS_SEI_IMP:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC;
-					SetDataBusFromMemory();
-					PS.Bits.I = 1;
-				});
-		} break;
-#pragma endregion
+	return &m_Block->Instructions[m_BlockIndex++];
+}
 
-#pragma region Branch_Instructions
-		case INS_BCC_REL:	// 2/3(4)
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC++;
-					SetDataBusFromMemory();
-					BRANCH_CHECK(PS.Bits.C == 0);
-				});
-		} break;
-		case INS_BCS_REL:	// 2/3(4)
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC++;
-					SetDataBusFromMemory();
-					BRANCH_CHECK(PS.Bits.C == 1);
-				});
-		} break;
-		case INS_BNE_REL:	// 2/3(4)
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC++;
-					SetDataBusFromMemory();
-					BRANCH_CHECK(PS.Bits.Z == 0);
-				});
-		} break;
-		case INS_BEQ_REL:	// 2/3(4)
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC++;
-					SetDataBusFromMemory();
-					BRANCH_CHECK(PS.Bits.Z == 1);
-				});
-		} break;
-		case INS_BPL_REL:	// 2/3(4)
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC++;
-					SetDataBusFromMemory();
-					BRANCH_CHECK(PS.Bits.N == 0);
-				});
-		} break;
-		case INS_BMI_REL:	// 2/3(4)
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC++;
-					SetDataBusFromMemory();
-					BRANCH_CHECK(PS.Bits.N == 1);
-				});
-		} break;
-		case INS_BVC_REL:	// 2/3(4)
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC++;
-					SetDataBusFromMemory();
-					BRANCH_CHECK(PS.Bits.V == 0);
-				});
-		} break;
-		case INS_BVS_REL:	// 2/3(4)
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC++;
-					SetDataBusFromMemory();
-					BRANCH_CHECK(PS.Bits.V == 1);
-				});
-		} break;
-
-		case INS_CMP_IM:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC++;
-					CompareRegister(A);
-				});
-		} break;
-		case INS_CMP_ZP:	// 3
-		{
-			PushZeroPage();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = m_ADL;
-					CompareRegister(A);
-				});
-		} break;
-		case INS_CMP_ZPX:	// 4
-		{
-			PushZeroPageXY();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = (BYTE)(m_BAL + X);
-					CompareRegister(A);
-				});
-		} break;
-		case INS_CMP_ABS:	// 4
-		{
-			PushAbsolute();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = ((WORD)m_ADH << 8) | m_ADL;
-					CompareRegister(A);
-				});
-		} break;
-		case INS_CMP_ABSX:	// 4(5)
-		{
-			PushAbsoluteXY();
-			m_InstructionQueue.push([&]()
-				{
-					EXTRA_CYCLE_CHECK(X, CompareRegister(A))
-				});
-		} break;
-		case INS_CMP_ABSY:	// 4(5)
-		{
-			PushAbsoluteXY();
-			m_InstructionQueue.push([&]()
-				{
-					EXTRA_CYCLE_CHECK(Y, CompareRegister(A))
-				});
-		} break;
-		case INS_CMP_INDX:	// 6
-		{
-			PushIndirectX();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = ((WORD)m_ADH << 8) | m_ADL;
-					CompareRegister(A);
-				});
-		} break;
-		case INS_CMP_INDY:	// 5(6)
-		{
-			PushIndirectY();
-			m_InstructionQueue.push([&]()
-				{
-					EXTRA_CYCLE_CHECK(Y, CompareRegister(A))
-				});
-		} break;
-
-		case INS_CPX_IM:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC++;
-					CompareRegister(X);
-				});
-		} break;
-		case INS_CPX_ZP:	// 3
-		{
-			PushZeroPage();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = m_ADL;
-					CompareRegister(X);
-				});
-		} break;
-		case INS_CPX_ABS:	// 4
-		{
-			PushAbsolute();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = ((WORD)m_ADH << 8) | m_ADL;
-					CompareRegister(X);
-				});
-		} break;
-		case INS_CPY_IM:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC++;
-					CompareRegister(Y);
-				});
-		} break;
-		case INS_CPY_ZP:	// 3
-		{
-			PushZeroPage();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = m_ADL;
-					CompareRegister(Y);
-				});
-		} break;
-		case INS_CPY_ABS:	// 4
-		{
-			PushAbsolute();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = ((WORD)m_ADH << 8) | m_ADL;
-					CompareRegister(Y);
-				});
-		} break;
-#pragma endregion
+void CPU::FetchOperand(BYTE& destination)
+{
+	// Operands are fetched before the instruction writes anything, so the decoded ones are still current
+	AddressBus = PC++;
+	if (m_Decoded != nullptr)
+	{
+		DataBus = m_Decoded->Operand[AddressBus - m_Decoded->Address - 1];
+		DataRead = true;
+	}
+	else
+	{
+		SetDataBusFromMemory();
+	}
+	destination = DataBus;
+}
 
-#pragma region Jump_Instructions
-		case INS_BRK_IMP:	// 7
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC;
-					if (!(NMI || IRQ))
-						PC++;
-
-					SetDataBusFromMemory();
-				});
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = BIT(8) | SP--;
-					DataBus = PC >> 8;
-					WriteMemoryFromDataBus();
-				});
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = BIT(8) | SP--;
-					DataBus = (BYTE)PC;
-					WriteMemoryFromDataBus();
-				});
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = BIT(8) | SP--;
-					DataBus = PS.Byte;
-					WriteMemoryFromDataBus();
-				});
-			m_InstructionQueue.push([&]()
-				{
-					PS.Bits.I = 1;
-					if (NMI || IRQ)
-						PS.Bits.B = 0;
-					else
-						PS.Bits.B = 1;
-					
-					if (NMI)
-						PC = 0xFFFA;
-					else
-						PC = 0xFFFE;
-
-					IRQ = false;
-					NMI = false;
-
-					AddressBus = PC++;
-					SetDataBusFromMemory();
-					m_ADL = DataBus;
-				});
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC;
-					SetDataBusFromMemory();
-					m_ADH = DataBus;
-					PC = ((WORD)m_ADH << 8) | m_ADL;
-				});
-		} break;
-		case INS_RTI_IMP:	// 6
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC;
-					SetDataBusFromMemory();
-				});
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = BIT(8) | SP++;
-					SetDataBusFromMemory();
-				});
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = BIT(8) | SP++;
-					SetDataBusFromMemory();
-					PS.Byte = DataBus;
-					PS.Bits.B = 0;
-				});
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = BIT(8) | SP++;
-					SetDataBusFromMemory();
-					PC = DataBus;
-				});
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = BIT(8) | SP;
-					SetDataBusFromMemory();
-					PC |= (WORD)DataBus << 8;
-				});
-		} break;
-		case INS_JMP_ABS:	// 3
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC++;
-					SetDataBusFromMemory();
-					m_ADL = DataBus;
-				});
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC;
-					SetDataBusFromMemory();
-					m_ADH = DataBus;
-					PC = ((WORD)m_ADH << 8) | m_ADL;
-				});
-		} break;
-		case INS_JMP_IND:	// 5
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC++;
-					SetDataBusFromMemory();
-					m_IAL = DataBus;
-				});
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC;
-					SetDataBusFromMemory();
-					m_IAH = DataBus;
-				});
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = ((WORD)m_IAH << 8) | m_IAL;
-					SetDataBusFromMemory();
-					m_ADL = DataBus;
-				});
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = (((WORD)m_IAH << 8) | m_IAL) + 1;
-					SetDataBusFromMemory();
-					m_ADH = DataBus;
-					PC = ((WORD)m_ADH << 8) | m_ADL;
-				});
-		} break;
-		case INS_JSR_ABS:	// 6
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC++;
-					SetDataBusFromMemory();
-					m_ADL = DataBus;
-				});
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = BIT(8) | SP;
-					SetDataBusFromMemory();
-				});
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = BIT(8) | SP--;
-					DataBus = PC >> 8;
-					WriteMemoryFromDataBus();
-				});
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = BIT(8) | SP--;
-					DataBus = PC;
-					WriteMemoryFromDataBus();
-				});
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC;
-					SetDataBusFromMemory();
-					m_ADH = DataBus;
-					PC = ((WORD)m_ADH << 8) | m_ADL;
-				});
-		} break;
-		case INS_RTS_IMP:	// 6
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC;
-					SetDataBusFromMemory();
-				});
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = BIT(8) | SP++;
-					SetDataBusFromMemory();
-				});
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = BIT(8) | SP++;
-					SetDataBusFromMemory();
-					PC = DataBus;
-				});
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = BIT(8) | SP;
-					SetDataBusFromMemory();
-					PC |= (WORD)DataBus << 8;
-				});
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC++;
-					SetDataBusFromMemory();
-				});
-		} break;
-#pragma endregion
+void CPU::EndInstruction()
+{
+	m_Cycle = m_Program->Length;
+}
 
-#pragma region Other_Instructions
-		case INS_NOP_IMP:	// 2
-		{
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = PC;
-					SetDataBusFromMemory();
-				});
-		} break;
-		case INS_BIT_ZP:	// 3
-		{
-			PushZeroPage();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = m_ADL;
-					TestBit();	
-				});
-		} break;
-		case INS_BIT_ABS:	// 4
-		{
-			PushAbsolute();
-			m_InstructionQueue.push([&]()
-				{
-					AddressBus = ((WORD)m_ADH << 8) | m_ADL;				
-					TestBit();
-				});
-		} break;
-#pragma endregion
+FORCE_INLINE void CPU::RunMicroOp(MicroOp op, Operation operation)
+{
+	MicroOps<CPU>::Run(*this, op, operation);
+}
 
-		default:
-			LOG_ERROR("Illegal Opcode ({0}), instruction not handled!", Log::WordToHexString(DataBus));
-			break;
-	}
+FORCE_INLINE void CPU::RunOperation(Operation operation)
+{
+	MicroOps<CPU>::RunOperation(*this, operation);
 }
 
-void CPU::PushZeroPage()
+FORCE_INLINE void CPU::RunAccumulatorOperation(Operation operation)
 {
-	m_InstructionQueue.push([&]()
-		{
-			AddressBus = PC++;
-			SetDataBusFromMemory();
-			m_ADL = DataBus;
-		});
+	MicroOps<CPU>::RunAccumulatorOperation(*this, operation);
 }
 
-void CPU::PushZeroPageXY()
+FORCE_INLINE bool CPU::IsBranchTaken(Operation operation)
 {
-	m_InstructionQueue.push([&]()
-		{
-			AddressBus = PC++;
-			SetDataBusFromMemory();
-			m_BAL = DataBus;
-		});
-	m_InstructionQueue.push([&]()
-		{
-			AddressBus = m_BAL;
-		});
+	return MicroOps<CPU>::IsBranchTaken(*this, operation);
 }
 
-void CPU::PushAbsolute()
+#pragma region Stepped_Core
+// Each form is straight-line code with one bus cycle between STEP_CYCLE marks. It
+// returns at a mark and resumes right after it on its next call, from the case label
+// kept in m_Resume: a stackless coroutine, with no frame to allocate. The cycles are
+// those of the micro-op programs and m_Cycle follows them, so RunInstruction can
+// finish an instruction the stepped core started.
+#define STEP_BEGIN() switch (m_Resume) { case 0:
+#define STEP_CYCLE() do { m_Resume = __LINE__; return; case __LINE__:; } while (false)
+#define STEP_END() }
+
+void CPU::EnableSteppedCore(bool enable)
 {
-	m_InstructionQueue.push([&]()
-		{
-			AddressBus = PC++;
-			SetDataBusFromMemory();
-			m_ADL = DataBus;
-		});
-	m_InstructionQueue.push([&]()
-		{
-			AddressBus = PC++;
-			SetDataBusFromMemory();
-			m_ADH = DataBus;
-		});
+	m_UseSteppedCore = enable;
 }
 
-void CPU::PushAbsoluteXY()
+FORCE_INLINE void CPU::ReadBus(WORD address)
 {
-	m_InstructionQueue.push([&]()
-		{
-			AddressBus = PC++;
-			SetDataBusFromMemory();
-			m_BAL = DataBus;
-		});
-	m_InstructionQueue.push([&]()
-		{
-			AddressBus = PC++;
-			SetDataBusFromMemory();
-			m_BAH = DataBus;
-		});
+	AddressBus = address;
+	SetDataBusFromMemory();
 }
 
-void CPU::PushIndirectX()
+FORCE_INLINE void CPU::PushBus(BYTE value)
 {
-	m_InstructionQueue.push([&]()
-		{
-			AddressBus = PC++;
-			SetDataBusFromMemory();
-			m_BAL = DataBus;
-		});
-	m_InstructionQueue.push([&]()
-		{
-			AddressBus = m_BAL;
-		});
-	m_InstructionQueue.push([&]()
-		{
-			AddressBus = (BYTE)(m_BAL + X);
-			SetDataBusFromMemory();
-			m_ADL = DataBus;
-		});
-	m_InstructionQueue.push([&]()
-		{
-			AddressBus = (BYTE)(m_BAL + X) + 1;
-			SetDataBusFromMemory();
-			m_ADH = DataBus;
-		});
+	AddressBus = BIT(8) | SP--;
+	DataBus = value;
+	WriteMemoryFromDataBus();
 }
 
-void CPU::PushIndirectY()
+void CPU::StepReset(Operation)
 {
-	m_InstructionQueue.push([&]()
-		{
-			AddressBus = PC++;
-			SetDataBusFromMemory();
-			m_IAL = DataBus;
-		});
-	m_InstructionQueue.push([&]()
-		{
-			AddressBus = m_IAL;
-			SetDataBusFromMemory();
-			m_BAL = DataBus;
-		});
-	m_InstructionQueue.push([&]()
-		{
-			AddressBus = m_IAL + 1;
-			SetDataBusFromMemory();
-			m_BAH = DataBus;
-		});
+	STEP_BEGIN();
+	PS.Bits.I = 1;
+	SP = 0x00;
+	STEP_CYCLE();
+	STEP_CYCLE();
+	STEP_CYCLE();
+	ReadBus(BIT(8) | SP);
+	STEP_CYCLE();
+	ReadBus(BIT(8) | (SP - 1));
+	STEP_CYCLE();
+	ReadBus(BIT(8) | (SP - 2));
+	STEP_CYCLE();
+	SP = 0xFD;
+	PC = 0xFFFC;
+	ReadBus(PC++);
+	m_ADL = DataBus;
+	STEP_CYCLE();
+	ReadBus(PC);
+	m_ADH = DataBus;
+	PC = ((WORD)m_ADH << 8) | m_ADL;
+	STEP_END();
 }
 
-void CPU::PushZeroPageModified()
+void CPU::StepImplied(Operation operation)
 {
-	m_InstructionQueue.push([&]()
-		{
-			AddressBus = PC++;
-			SetDataBusFromMemory();
-			m_ADL = DataBus;
-		});
-	m_InstructionQueue.push([&]()
-		{
-			AddressBus = m_ADL;
-			SetDataBusFromMemory();
-		});
-	m_InstructionQueue.push([&]()
-		{
-			DataRead = false;
-		});
+	ReadBus(PC);
+	RunOperation(operation);
 }
 
-void CPU::PushZeroPageXModified()
+void CPU::StepAccumulator(Operation operation)
 {
-	m_InstructionQueue.push([&]()
-		{
-			AddressBus = PC++;
-			SetDataBusFromMemory();
-			m_BAL = DataBus;
-		});
-	m_InstructionQueue.push([&]()
-		{
-			AddressBus = m_BAL;
-		});
-	m_InstructionQueue.push([&]()
-		{
-			AddressBus = (BYTE)(m_BAL + X);
-			SetDataBusFromMemory();
-		});
-	m_InstructionQueue.push([&]()
-		{
-			DataRead = false;
-		});
+	RunAccumulatorOperation(operation);
 }
 
-void CPU::PushAbsoluteModified()
+void CPU::StepImmediate(Operation operation)
 {
-	m_InstructionQueue.push([&]()
-		{
-			AddressBus = PC++;
-			SetDataBusFromMemory();
-			m_ADL = DataBus;
-		});
-	m_InstructionQueue.push([&]()
-		{
-			AddressBus = PC++;
-			SetDataBusFromMemory();
-			m_ADH = DataBus;
-		});
-	m_InstructionQueue.push([&]()
-		{
-			AddressBus = ((WORD)m_ADH << 8) | m_ADL;
-			SetDataBusFromMemory();
-		});
-	m_InstructionQueue.push([&]()
-		{
-			DataRead = false;
-		});
+	AddressBus = PC++;
+	RunOperation(operation);
 }
 
-void CPU::PushAbsoluteXModified()
+void CPU::StepBranch(Operation operation)
 {
-	m_InstructionQueue.push([&]()
-		{
-			AddressBus = PC++;
-			SetDataBusFromMemory();
-			m_BAL = DataBus;
-		});
-	m_InstructionQueue.push([&]()
-		{
-			AddressBus = PC++;
-			SetDataBusFromMemory();
-			m_BAH = DataBus;
-		});
-	m_InstructionQueue.push([&]()
-		{
-			m_ADL = m_BAL + X;
-			m_ADH = m_BAH + (WORD(m_BAL) + X > 0xFF ? 1 : 0);
-			AddressBus = ((WORD)m_ADH << 8) | m_ADL;
-		});
-	m_InstructionQueue.push([&]()
-		{
-			SetDataBusFromMemory();
-		});
-	m_InstructionQueue.push([&]()
-		{
-			DataRead = false;
-		});
+	STEP_BEGIN();
+	ReadBus(PC++);
+	if (!IsBranchTaken(operation))
+	{
+		EndInstruction();
+		return;
+	}
+	STEP_CYCLE();
+	// Landing on another page takes one more cycle
+	if ((PC >> 8) == ((PC + (int8_t)DataBus) >> 8))
+	{
+		PC += (int8_t)DataBus;
+		AddressBus = PC;
+		EndInstruction();
+		return;
+	}
+	STEP_CYCLE();
+	PC += (int8_t)DataBus;
+	AddressBus = PC;
+	STEP_END();
 }
 
-void CPU::SetRegister(BYTE& reg)
+// Read-modify-write forms read the operand, spend a cycle with RWB low and write it back modified
+template<AccessClass Access>
+void CPU::StepZeroPage(Operation operation)
 {
-	SetDataBusFromMemory();
-	reg = DataBus;
-	PS.Bits.Z = reg == 0;
-	PS.Bits.N = (reg & BIT(7)) > 0;
+	STEP_BEGIN();
+	FetchOperand(m_ADL);
+	STEP_CYCLE();
+	AddressBus = m_ADL;
+	if (Access == AccessClass::ReadModifyWrite)
+	{
+		SetDataBusFromMemory();
+		STEP_CYCLE();
+		DataRead = false;
+		STEP_CYCLE();
+	}
+	RunOperation(operation);
+	STEP_END();
 }
 
-void CPU::StoreRegister(BYTE& reg)
+template<AccessClass Access>
+void CPU::StepZeroPageX(Operation operation)
 {
-	DataBus = reg;
-	WriteMemoryFromDataBus();
+	STEP_BEGIN();
+	FetchOperand(m_BAL);
+	STEP_CYCLE();
+	AddressBus = m_BAL;
+	STEP_CYCLE();
+	AddressBus = (BYTE)(m_BAL + X);
+	if (Access == AccessClass::ReadModifyWrite)
+	{
+		SetDataBusFromMemory();
+		STEP_CYCLE();
+		DataRead = false;
+		STEP_CYCLE();
+	}
+	RunOperation(operation);
+	STEP_END();
 }
 
-void CPU::CompareRegister(BYTE& reg)
+void CPU::StepZeroPageY(Operation operation)
 {
-	SetDataBusFromMemory();
-	int16_t result = reg - DataBus;
+	STEP_BEGIN();
+	FetchOperand(m_BAL);
+	STEP_CYCLE();
+	AddressBus = m_BAL;
+	STEP_CYCLE();
+	AddressBus = (BYTE)(m_BAL + Y);
+	RunOperation(operation);
+	STEP_END();
+}
 
-	PS.Bits.C = (result & BIT(8)) > 0;
-	PS.Bits.Z = BYTE(result) == 0;
-	PS.Bits.N = (result & BIT(7)) > 0;
+template<AccessClass Access>
+void CPU::StepAbsolute(Operation operation)
+{
+	STEP_BEGIN();
+	FetchOperand(m_ADL);
+	STEP_CYCLE();
+	FetchOperand(m_ADH);
+	STEP_CYCLE();
+	AddressBus = ((WORD)m_ADH << 8) | m_ADL;
+	if (Access == AccessClass::ReadModifyWrite)
+	{
+		SetDataBusFromMemory();
+		STEP_CYCLE();
+		DataRead = false;
+		STEP_CYCLE();
+	}
+	RunOperation(operation);
+	STEP_END();
 }
 
-void CPU::AddA()
+// Reads only spend the page cross cycle when indexing crosses a page, writes always do
+template<AccessClass Access, BYTE CPU::*Index>
+void CPU::StepAbsoluteIndexed(Operation operation)
 {
-	// TODO: Handle if decimal flag is set
-	SetDataBusFromMemory();
-	int16_t result = A + PS.Bits.C + DataBus;
+	STEP_BEGIN();
+	FetchOperand(m_BAL);
+	STEP_CYCLE();
+	FetchOperand(m_BAH);
+	STEP_CYCLE();
+	if (Access == AccessClass::Read)
+	{
+		if (WORD(m_BAL) + this->*Index <= 0xFF)
+		{
+			m_ADL = m_BAL + this->*Index;
+			m_ADH = m_BAH;
+			AddressBus = ((WORD)m_ADH << 8) | m_ADL;
+			RunOperation(operation);
+			EndInstruction();
+			return;
+		}
+		STEP_CYCLE();
+		m_ADL = m_BAL + this->*Index;
+		m_ADH = m_BAH + 1;
+		AddressBus = ((WORD)m_ADH << 8) | m_ADL;
+		RunOperation(operation);
+		return;
+	}
 
-	PS.Bits.V = ((A ^ result) & (DataBus ^ result) & BIT(7)) > 0;
-	A = (result & 0xFF);
-	PS.Bits.C = (result & 0xFF00) > 0;
-	PS.Bits.Z = A == 0;
-	PS.Bits.N = (A & BIT(7)) > 0;
+	m_ADL = m_BAL + this->*Index;
+	m_ADH = m_BAH + (WORD(m_BAL) + this->*Index > 0xFF ? 1 : 0);
+	AddressBus = ((WORD)m_ADH << 8) | m_ADL;
+	STEP_CYCLE();
+	if (Access == AccessClass::ReadModifyWrite)
+	{
+		SetDataBusFromMemory();
+		STEP_CYCLE();
+		DataRead = false;
+		STEP_CYCLE();
+	}
+	RunOperation(operation);
+	STEP_END();
 }
 
-void CPU::SubA()
+void CPU::StepIndirectX(Operation operation)
 {
-	// TODO: Handle if decimal flag is set
-	SetDataBusFromMemory();
-	int16_t result = (A | (PS.Bits.C & BIT(8))) - DataBus;
-	
-	PS.Bits.V = ((A ^ result) & ((0xFF - DataBus) ^ result) & BIT(7)) > 0;
-	A = (result & 0xFF);
-	PS.Bits.C = (result & BIT(8)) > 0;
-	PS.Bits.Z = A == 0;
-	PS.Bits.N = (A & BIT(7)) > 0;
+	STEP_BEGIN();
+	FetchOperand(m_BAL);
+	STEP_CYCLE();
+	AddressBus = m_BAL;
+	STEP_CYCLE();
+	ReadBus((BYTE)(m_BAL + X));
+	m_ADL = DataBus;
+	STEP_CYCLE();
+	ReadBus((BYTE)(m_BAL + X) + 1);
+	m_ADH = DataBus;
+	STEP_CYCLE();
+	AddressBus = ((WORD)m_ADH << 8) | m_ADL;
+	RunOperation(operation);
+	STEP_END();
 }
 
-void CPU::AndA()
+template<AccessClass Access>
+void CPU::StepIndirectY(Operation operation)
 {
-	SetDataBusFromMemory();
-	A &= DataBus;
-	PS.Bits.Z = A == 0;
-	PS.Bits.N = (A & BIT(7)) > 0;
+	STEP_BEGIN();
+	FetchOperand(m_IAL);
+	STEP_CYCLE();
+	ReadBus(m_IAL);
+	m_BAL = DataBus;
+	STEP_CYCLE();
+	ReadBus(m_IAL + 1);
+	m_BAH = DataBus;
+	STEP_CYCLE();
+	if (Access == AccessClass::Read)
+	{
+		if (WORD(m_BAL) + Y <= 0xFF)
+		{
+			m_ADL = m_BAL + Y;
+			m_ADH = m_BAH;
+			AddressBus = ((WORD)m_ADH << 8) | m_ADL;
+			RunOperation(operation);
+			EndInstruction();
+			return;
+		}
+		STEP_CYCLE();
+		m_ADL = m_BAL + Y;
+		m_ADH = m_BAH + 1;
+		AddressBus = ((WORD)m_ADH << 8) | m_ADL;
+		RunOperation(operation);
+		return;
+	}
+
+	m_ADL = m_BAL + Y;
+	m_ADH = m_BAH + (WORD(m_BAL) + Y > 0xFF ? 1 : 0);
+	AddressBus = ((WORD)m_ADH << 8) | m_ADL;
+	STEP_CYCLE();
+	RunOperation(operation);
+	STEP_END();
 }
 
-void CPU::OrA()
+void CPU::StepPush(Operation operation)
 {
-	SetDataBusFromMemory();
-	A |= DataBus;
-	PS.Bits.Z = A == 0;
-	PS.Bits.N = (A & BIT(7)) > 0;
+	STEP_BEGIN();
+	ReadBus(PC);
+	STEP_CYCLE();
+	AddressBus = BIT(8) | SP--;
+	RunOperation(operation);
+	STEP_END();
 }
 
-void CPU::ExclusiveOrA()
+void CPU::StepPull(Operation operation)
 {
-	SetDataBusFromMemory();
-	A ^= DataBus;
-	PS.Bits.Z = A == 0;
-	PS.Bits.N = (A & BIT(7)) > 0;
+	STEP_BEGIN();
+	ReadBus(PC);
+	STEP_CYCLE();
+	ReadBus(BIT(8) | SP++);
+	STEP_CYCLE();
+	AddressBus = BIT(8) | SP;
+	RunOperation(operation);
+	STEP_END();
 }
 
-void CPU::ShiftLeftDB(bool withC)
+void CPU::StepJump(Operation)
 {
-	bool setC = (DataBus & BIT(7)) > 0;
-	DataBus <<= 1;
-	if (withC && PS.Bits.C)
-		DataBus |= BIT(0);
-	WriteMemoryFromDataBus();
-	PS.Bits.C = setC ? 1 : 0;
-	PS.Bits.Z = DataBus == 0;
-	PS.Bits.N = (DataBus & BIT(7)) > 0;
+	STEP_BEGIN();
+	FetchOperand(m_ADL);
+	STEP_CYCLE();
+	ReadBus(PC);
+	m_ADH = DataBus;
+	PC = ((WORD)m_ADH << 8) | m_ADL;
+	STEP_END();
 }
 
-void CPU::ShiftRightDB(bool withC)
+void CPU::StepJumpIndirect(Operation)
 {
-	bool setC = (DataBus & BIT(0)) > 0;
-	DataBus >>= 1;
-	if (withC && PS.Bits.C)
-		DataBus |= BIT(7);
-	WriteMemoryFromDataBus();
-	PS.Bits.C = setC ? 1 : 0;
-	PS.Bits.Z = DataBus == 0;
-	PS.Bits.N = (DataBus & BIT(7)) > 0;
+	STEP_BEGIN();
+	FetchOperand(m_IAL);
+	STEP_CYCLE();
+	ReadBus(PC);
+	m_IAH = DataBus;
+	STEP_CYCLE();
+	ReadBus(((WORD)m_IAH << 8) | m_IAL);
+	m_ADL = DataBus;
+	STEP_CYCLE();
+	ReadBus((((WORD)m_IAH << 8) | m_IAL) + 1);
+	m_ADH = DataBus;
+	PC = ((WORD)m_ADH << 8) | m_ADL;
+	STEP_END();
 }
 
-void CPU::DecDB()
+void CPU::StepJumpToSubroutine(Operation)
 {
-	DataBus--;
-	WriteMemoryFromDataBus();
-	PS.Bits.Z = DataBus == 0;
-	PS.Bits.N = (DataBus & BIT(7)) > 0;
+	STEP_BEGIN();
+	FetchOperand(m_ADL);
+	STEP_CYCLE();
+	ReadBus(BIT(8) | SP);
+	STEP_CYCLE();
+	PushBus(PC >> 8);
+	STEP_CYCLE();
+	PushBus((BYTE)PC);
+	STEP_CYCLE();
+	ReadBus(PC);
+	m_ADH = DataBus;
+	PC = ((WORD)m_ADH << 8) | m_ADL;
+	STEP_END();
 }
 
-void CPU::IncDB()
+void CPU::StepReturnFromSubroutine(Operation)
 {
-	DataBus++;
-	WriteMemoryFromDataBus();
-	PS.Bits.Z = DataBus == 0;
-	PS.Bits.N = (DataBus & BIT(7)) > 0;
+	STEP_BEGIN();
+	ReadBus(PC);
+	STEP_CYCLE();
+	ReadBus(BIT(8) | SP++);
+	STEP_CYCLE();
+	ReadBus(BIT(8) | SP++);
+	PC = DataBus;
+	STEP_CYCLE();
+	ReadBus(BIT(8) | SP);
+	PC |= (WORD)DataBus << 8;
+	STEP_CYCLE();
+	ReadBus(PC++);
+	STEP_END();
+}
+
+void CPU::StepReturnFromInterrupt(Operation)
+{
+	STEP_BEGIN();
+	ReadBus(PC);
+	STEP_CYCLE();
+	ReadBus(BIT(8) | SP++);
+	STEP_CYCLE();
+	ReadBus(BIT(8) | SP++);
+	m_FlagsPending = false;
+	PS.Byte = DataBus;
+	PS.Bits.B = 0;
+	STEP_CYCLE();
+	ReadBus(BIT(8) | SP++);
+	PC = DataBus;
+	STEP_CYCLE();
+	ReadBus(BIT(8) | SP);
+	PC |= (WORD)DataBus << 8;
+	STEP_END();
 }
 
-void CPU::TestBit()
+// Interrupts run as a BRK loaded from address 0, which neither skips the byte after it nor sets B
+void CPU::StepBreak(Operation)
 {
+	STEP_BEGIN();
+	AddressBus = PC;
+	if (!(NMI || IRQ))
+		PC++;
 	SetDataBusFromMemory();
-	PS.Bits.Z = (A & DataBus) == 0;
-	PS.Bits.V = (DataBus & BIT(6)) > 0;
-	PS.Bits.N = (DataBus & BIT(7)) > 0;
+	STEP_CYCLE();
+	PushBus(PC >> 8);
+	STEP_CYCLE();
+	PushBus((BYTE)PC);
+	STEP_CYCLE();
+	SyncFlags();
+	PushBus(PS.Byte);
+	STEP_CYCLE();
+	PS.Bits.I = 1;
+	PS.Bits.B = NMI || IRQ ? 0 : 1;
+	PC = NMI ? 0xFFFA : 0xFFFE;
+	IRQ = false;
+	NMI = false;
+	ReadBus(PC++);
+	m_ADL = DataBus;
+	STEP_CYCLE();
+	ReadBus(PC);
+	m_ADH = DataBus;
+	PC = ((WORD)m_ADH << 8) | m_ADL;
+	STEP_END();
+}
+
+#undef STEP_BEGIN
+#undef STEP_CYCLE
+#undef STEP_END
+
+template<AccessClass Access>
+constexpr CPU::CycleStepper CPU::GetAddressedStepper(AddressingMode mode)
+{
+	using A = AddressingMode;
+	switch (mode)
+	{
+		case A::Implied:		return &CPU::StepImplied;
+		case A::Accumulator:	return &CPU::StepAccumulator;
+		case A::Immediate:		return &CPU::StepImmediate;
+		case A::Relative:		return &CPU::StepBranch;
+		case A::ZeroPage:		return &CPU::StepZeroPage<Access>;
+		case A::ZeroPageX:		return &CPU::StepZeroPageX<Access>;
+		case A::ZeroPageY:		return &CPU::StepZeroPageY;
+		case A::Absolute:		return &CPU::StepAbsolute<Access>;
+		case A::AbsoluteX:		return &CPU::StepAbsoluteIndexed<Access, &CPU::X>;
+		case A::AbsoluteY:		return &CPU::StepAbsoluteIndexed<Access, &CPU::Y>;
+		case A::IndirectX:		return &CPU::StepIndirectX;
+		case A::IndirectY:		return &CPU::StepIndirectY<Access>;
+		default:				return nullptr;
+	}
 }
+
+constexpr CPU::CycleStepper CPU::GetStepper(const OpcodeInfo& info)
+{
+	using O = Operation;
+	switch (info.Op)
+	{
+		case O::None: return nullptr;
+		case O::BRK: return &CPU::StepBreak;
+		case O::RTI: return &CPU::StepReturnFromInterrupt;
+		case O::JSR: return &CPU::StepJumpToSubroutine;
+		case O::RTS: return &CPU::StepReturnFromSubroutine;
+		case O::JMP: return info.Mode == AddressingMode::Indirect ? &CPU::StepJumpIndirect : &CPU::StepJump;
+		case O::PHA: case O::PHP: return &CPU::StepPush;
+		case O::PLA: case O::PLP: return &CPU::StepPull;
+		default: break;
+	}
+
+	switch (info.Access)
+	{
+		case AccessClass::Write:			return GetAddressedStepper<AccessClass::Write>(info.Mode);
+		case AccessClass::ReadModifyWrite:	return GetAddressedStepper<AccessClass::ReadModifyWrite>(info.Mode);
+		default:							return GetAddressedStepper<AccessClass::Read>(info.Mode);
+	}
+}
+
+constexpr std::array<CPU::CycleStepper, 256> CPU::MakeSteppers()
+{
+	std::array<CycleStepper, 256> steppers = {};
+	for (size_t opcode = 0; opcode < steppers.size(); opcode++)
+		steppers[opcode] = GetStepper(OPCODE_TABLE[opcode]);
+	return steppers;
+}
+
+const std::array<CPU::CycleStepper, 256> CPU::s_Steppers = CPU::MakeSteppers();
+#pragma endregion
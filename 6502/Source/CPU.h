@@ -1,53 +1,81 @@
 #pragma once
 
+#include "ALU.h"
 #include "Base.h"
+#include "BlockCache.h"
+#include "IdleLoop.h"
+#include "Jit.h"
 #include "Memory.h"
+#include "MicroCode.h"
+#include "MicroOps.h"
+#include "PageTable.h"
+#include "StaticCode.h"
+#include "Trace.h"
 
-#include <functional>
-#include <queue>
+#include <array>
+#include <memory>
+#include <utility>
 
-struct BitFlags
-{
-	BYTE C : 1;		// Carry (0)
-	BYTE Z : 1;		// Zero (1)
-	BYTE I : 1;		// Interrupt disable (2)
-	BYTE D : 1;		// Decimal (3)
-	BYTE B : 1;		// Break commnd (4)
-	BYTE UB : 1;	// Unused (5)
-	BYTE V : 1;		// Overflow (6)
-	BYTE N : 1;		// Negative (7)
-};
-
-union StatusFlags
-{
-	BitFlags Bits;
-	BYTE Byte;
-};
+class TraceWriter;
 
 class CPU
 {
 public:
-	WORD PC;			// Program counter
-	BYTE SP;			// Stack pointer
-	StatusFlags PS;		// Program status
-	BYTE A, X, Y;		// Registers (Accumulator, X/Y index)
-
-	WORD AddressBus;
-	BYTE DataBus;
-	bool DataRead;		// Read/Write bit (RWB)
+	WORD PC = 0;			// Program counter
+	BYTE SP = 0;			// Stack pointer
+	StatusFlags PS = {};	// Program status
+	BYTE A = 0, X = 0, Y = 0;	// Registers (Accumulator, X/Y index)
+
+	WORD AddressBus = 0;
+	BYTE DataBus = 0;
+	bool DataRead = true;	// Read/Write bit (RWB)
 	bool NMI = false;
 	bool IRQ = false;
 
+	uint64_t Cycles = 0;	// Cycles run since power on
+
 private:
 	friend class ComputerTest;
+	friend class MicroOps<CPU>;
+
+	BYTE m_BAL = 0, m_BAH = 0;
+	BYTE m_ADL = 0, m_ADH = 0;
+	BYTE m_IAL = 0, m_IAH = 0;
 
-	BYTE m_BAL, m_BAH;
-	BYTE m_ADL, m_ADH;
-	BYTE m_IAL, m_IAH;
-	std::queue<std::function<void()>> m_InstructionQueue;
+	const MicroProgram* m_Program = nullptr;	// Micro-ops of the current instruction
+	BYTE m_Cycle = 0;							// Index of the next micro-op to run
+
+	// Straight-line form of the current instruction when the stepped core loaded it
+	using CycleStepper = void (CPU::*)(Operation);
+	CycleStepper m_Stepper = nullptr;
+	uint32_t m_Resume = 0;						// Where m_Stepper resumes on its next cycle
+	bool m_UseSteppedCore = false;
+
+	// N and Z are kept as the result that last set them until something reads PS
+	BYTE m_FlagsResult = 0;
+	bool m_FlagsPending = false;
+	bool m_UseLazyFlags = false;
 
 	Memory* m_HandleSRAM = nullptr;
 	Memory* m_HandleEEPROM = nullptr;
+	DeviceBus* m_HandleIO = nullptr;
+	PageTable m_PageTable;
+
+	BlockCache m_BlockCache;
+	bool m_UseBlockCache = true;
+	const DecodedBlock* m_Block = nullptr;		// Block the last instruction came from
+	uint32_t m_BlockIndex = 0;					// Index of the next instruction in that block
+	const DecodedInstruction* m_Decoded = nullptr;	// The current instruction when it came from the cache
+
+	IdleLoopFinder m_IdleLoops;
+	bool m_UseIdleSkip = true;
+	uint64_t m_IdleCycles = 0;	// Skipped in idle and delay loops since power on
+
+	std::unique_ptr<Jit> m_Jit;	// Only set while compiling
+	std::unique_ptr<StaticRunner> m_Static;	// Only set while a static program is attached
+
+	std::unique_ptr<TraceBuffer> m_Trace;	// Only set while tracing
+	TraceWriter* m_TraceWriter = nullptr;
 
 public:
 	CPU();
@@ -55,41 +83,135 @@ public:
 
 	void Reset();
 	void RunCycle(Memory* SRAM, Memory* EEPROM);
+	uint32_t RunInstruction(Memory* SRAM, Memory* EEPROM);	// Returns the number of cycles run
+
+	// Batched runs attach the memory once and then step without it
+	void AttachMemory(Memory* SRAM, Memory* EEPROM);
+	void AttachDevices(DeviceBus* IO);
+	void AttachMapper(Mapper* mapper);
+	void DetachMapper(Mapper* mapper);
+	void RunCycle();
+	uint32_t RunInstruction();
+
+	// Lets the batched RunCycle and RunInstruction above leave N and Z pending in PS, to be
+	// worked out only when an instruction reads them. Whoever runs the batch calls SyncFlags
+	// before PS is looked at from outside the CPU. Off by default, Computer turns it on as
+	// its runs sync before returning.
+	void EnableLazyFlags(bool enable);
+	// Runs RunCycle through straight-line code per instruction form instead of the
+	// micro-op programs, cycle for cycle the same on the bus. Takes effect from the next
+	// instruction, RunInstruction always runs the unrolled micro-op programs.
+	void EnableSteppedCore(bool enable);
+	inline void SyncFlags()
+	{
+		if (!m_FlagsPending)
+			return;
+		ALU::SetZN(PS, m_FlagsResult);
+		m_FlagsPending = false;
+	}
 
 	void InterruptNMI();
 	void InterruptIRQ();
 
-private:
-	void ClearInstructionQueue();
+	inline bool IsInstructionComplete() const { return m_Cycle >= m_Program->Length; }
+
+	// Replays instructions from predecoded blocks instead of decoding them on every fetch
+	void EnableBlockCache(bool enable);
+	inline const BlockCache& GetBlockCache() const { return m_BlockCache; }
+
+	// Runs hot blocks as native code in runs bounded by cycles only, returns false if
+	// the JIT is not available and the CPU stays interpreted
+	bool EnableJit(bool enable);
+	inline const Jit* GetJit() const { return m_Jit.get(); }
+	// Runs the blocks of a program translated ahead of time by the recompiler whenever the
+	// EEPROM holds the image it was translated from (nullptr detaches it)
+	void AttachStaticProgram(const StaticProgram* program);
+	inline const StaticRunner* GetStaticRunner() const { return m_Static.get(); }
+	// Runs compiled code from an instruction boundary for at most maxCycles, returns the cycles run
+	uint64_t RunCompiled(uint64_t maxCycles);
+
+	// Skips whole iterations of a loop starting at PC when running one more would not
+	// change anything, or of a delay loop counting down an index register, whose
+	// iterations are worked out instead of run. Bounded by maxCycles and, for loops
+	// that read, by the next device event. Called at an instruction boundary, it
+	// returns the cycles run or skipped (0 if not idle).
+	// Only runs bounded by cycles may call it, as nothing is checked in between.
+	void EnableIdleSkip(bool enable);
+	inline uint64_t SkipIdleLoop(uint64_t maxCycles)
+	{
+		// Loops are only looked for where a jump or a branch lands
+		if (!m_UseIdleSkip || (m_Program->Op != Operation::JMP && (m_Program->Op < Operation::BCC || m_Program->Op > Operation::BVS)))
+			return 0;
+		return RunIdleLoop(maxCycles);
+	}
+	inline uint64_t GetIdleCycles() const { return m_IdleCycles; }
+
+	// Records every bus cycle into a ring buffer holding the latest capacity cycles (compiled out in Distribution)
+	void EnableTrace(uint32_t capacity);
+	void DisableTrace();
+	inline TraceBuffer* GetTrace() const { return m_Trace.get(); }
+	// Streams every bus cycle to a trace file, the writer is not owned (nullptr detaches it)
+	void AttachTraceWriter(TraceWriter* writer);
 
+private:
 	void SetDataBusFromMemory();
 	void WriteMemoryFromDataBus();
 	Memory* GetMemoryWithAddress(const WORD& address);
 
-	void LoadInstruction();
+	void TraceCycle();
+	uint64_t RunIdleLoop(uint64_t maxCycles);
+	uint64_t RunIdleIterations(uint32_t instructions, uint64_t maxCycles);
+	uint64_t SkipCountdown(const IdleLoop& loop, uint64_t maxCycles);
+	bool RunLoopIteration(WORD head, uint32_t instructions);
+	void RemapPages();
+	const DecodedInstruction* GetDecodedInstruction();
+	void FetchOperand(BYTE& destination);
 
-	void PushZeroPage();
-	void PushZeroPageXY();
-	void PushAbsolute();
-	void PushAbsoluteXY();
-	void PushIndirectX();
-	void PushIndirectY();
-	void PushZeroPageModified();
-	void PushZeroPageXModified();
-	void PushAbsoluteModified();
-	void PushAbsoluteXModified();
-
-	void SetRegister(BYTE& reg);
-	void StoreRegister(BYTE& reg);
-	void CompareRegister(BYTE& reg);
-	void AddA();
-	void SubA();
-	void AndA();
-	void OrA();
-	void ExclusiveOrA();
-	void ShiftLeftDB(bool withC);
-	void ShiftRightDB(bool withC);
-	void DecDB();
-	void IncDB();
-	void TestBit();
+	void LoadInstruction();
+	void RunMicroOp(MicroOp op, Operation operation);
+	void RunOperation(Operation operation);
+	void RunAccumulatorOperation(Operation operation);
+	void EndInstruction();
+	bool IsBranchTaken(Operation operation);
+	inline void SetZN(BYTE value) { m_FlagsResult = value; m_FlagsPending = true; }
+	inline void DiscardFlags() { m_FlagsPending = false; }	// PS is about to be set as a whole or by the ALU
+
+	// One handler per opcode, each running the micro-program of its opcode unrolled
+	using InstructionHandler = void (CPU::*)();
+	template<Operation Op, AddressingMode Mode>
+	void RunInstructionBody();
+	template<Operation Op, AddressingMode Mode, size_t... Cycle>
+	void RunMicroProgram(std::index_sequence<Cycle...>);
+	template<size_t... Opcode>
+	static constexpr std::array<InstructionHandler, 256> MakeHandlers(std::index_sequence<Opcode...>);
+	static const std::array<InstructionHandler, 256> s_Handlers;
+
+	// The stepped core, one bus cycle per call of a form
+	void StepReset(Operation operation);
+	void StepImplied(Operation operation);
+	void StepAccumulator(Operation operation);
+	void StepImmediate(Operation operation);
+	void StepBranch(Operation operation);
+	template<AccessClass Access> void StepZeroPage(Operation operation);
+	template<AccessClass Access> void StepZeroPageX(Operation operation);
+	void StepZeroPageY(Operation operation);
+	template<AccessClass Access> void StepAbsolute(Operation operation);
+	template<AccessClass Access, BYTE CPU::*Index> void StepAbsoluteIndexed(Operation operation);
+	void StepIndirectX(Operation operation);
+	template<AccessClass Access> void StepIndirectY(Operation operation);
+	void StepPush(Operation operation);
+	void StepPull(Operation operation);
+	void StepJump(Operation operation);
+	void StepJumpIndirect(Operation operation);
+	void StepJumpToSubroutine(Operation operation);
+	void StepReturnFromSubroutine(Operation operation);
+	void StepReturnFromInterrupt(Operation operation);
+	void StepBreak(Operation operation);
+	void ReadBus(WORD address);
+	void PushBus(BYTE value);
+	template<AccessClass Access>
+	static constexpr CycleStepper GetAddressedStepper(AddressingMode mode);
+	static constexpr CycleStepper GetStepper(const OpcodeInfo& info);
+	static constexpr std::array<CycleStepper, 256> MakeSteppers();
+	static const std::array<CycleStepper, 256> s_Steppers;
 };
\ No newline at end of file
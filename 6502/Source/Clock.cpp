@@ -1,5 +1,8 @@
 #include "Clock.h"
 
+#include <algorithm>
+#include <cmath>
+
 void Clock::Start()
 {
 	m_Running = true;
@@ -20,18 +23,57 @@ void Clock::Step()
 	m_Step = true;
 }
 
-void Clock::WaitForNextCycle()
+uint64_t Clock::WaitForNextQuantum(uint64_t maxCycles)
 {
+	if (!m_Running || maxCycles == 0)
+		return 0;
+
+	uint64_t quantum;
 	if (m_Step)
 	{
 		m_Running = false;
 		m_Step = false;
+		quantum = 1;
+	}
+	else if (m_CycleNS == 0)
+	{
+		quantum = std::min(maxCycles, CLOCK_MAX_SPEED_QUANTUM);
 	}
-	else if (m_Speed != 0)
+	else
 	{
-		std::this_thread::sleep_until(m_NextCycleTime);
-		m_NextCycleTime += std::chrono::microseconds((uint32_t)(m_Speed * 1000));
+		quantum = std::min(maxCycles, m_QuantumCycles);
+
+		std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - m_Epoch;
+		uint64_t due = elapsed.count() > 0 ? (uint64_t)(elapsed.count() / m_CycleNS) : 0;
+
+		if (due < m_Cycles + quantum)
+		{
+			std::this_thread::sleep_until(GetCycleTime(m_Cycles + quantum));
+		}
+		else
+		{
+			// Behind schedule, hand out everything that is due
+			uint64_t behind = due - m_Cycles;
+			if (behind > m_MaxCatchUpCycles)
+			{
+				m_DroppedCycles += behind - m_MaxCatchUpCycles;
+				m_Epoch = GetCycleTime(behind - m_MaxCatchUpCycles);	// Moves the schedule forward
+				behind = m_MaxCatchUpCycles;
+			}
+			quantum = std::min(maxCycles, behind);
+		}
 	}
+
+	m_Cycles += quantum;
+	m_StatsCycles += quantum;
+	return quantum;
+}
+
+void Clock::ReturnCycles(uint64_t cycles)
+{
+	cycles = std::min(cycles, m_Cycles);
+	m_Cycles -= cycles;
+	m_StatsCycles -= std::min(cycles, m_StatsCycles);
 }
 
 void Clock::SetSpeedHZ(uint32_t speed)
@@ -41,7 +83,7 @@ void Clock::SetSpeedHZ(uint32_t speed)
 		LOG_ERROR("Can't set clock speed to 0 Hz. Use the \"Stop\" function if you desire to stop the clock.");
 		return;
 	}
-	SetSpeedMS((float)1000 / speed);
+	SetCyclePeriod(1e9 / speed);
 }
 
 void Clock::SetSpeedMS(float speed)
@@ -51,18 +93,51 @@ void Clock::SetSpeedMS(float speed)
 		LOG_ERROR("The clock speed in MS must be a positive number.");
 		return;
 	}
+	SetCyclePeriod((double)speed * 1000000);
+}
 
-	m_Speed = speed;
-	if (m_Speed != 0)
-	{
-		UpdateClock();
-		LOG_INFO("Clock speed set to {0} Hz ({1} ms per cycle).", (uint32_t)(1000 / m_Speed), m_Speed);
-	}
+double Clock::GetAchievedHZ() const
+{
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - m_StatsStart;
+	return elapsed.count() > 0 ? m_StatsCycles / elapsed.count() : 0;
+}
+
+void Clock::ReportSpeed() const
+{
+	if (m_CycleNS != 0)
+		LOG_INFO("Clock running at {0} Hz of the requested {1} Hz ({2} cycles dropped).", (uint64_t)GetAchievedHZ(), (uint64_t)std::round(GetRequestedHZ()), m_DroppedCycles);
+	else
+		LOG_INFO("Clock running at {0} Hz (max speed).", (uint64_t)GetAchievedHZ());
+}
+
+void Clock::SetCyclePeriod(double nanoseconds)
+{
+	m_CycleNS = nanoseconds;
+	UpdateClock();
+
+	if (m_CycleNS != 0)
+		LOG_INFO("Clock speed set to {0} Hz ({1} ms per cycle).", (uint32_t)std::round(GetRequestedHZ()), m_CycleNS / 1000000);
 	else
 		LOG_INFO("Clock speed set to max speed.");
 }
 
 void Clock::UpdateClock()
 {
-	m_NextCycleTime = std::chrono::high_resolution_clock::now() + std::chrono::microseconds((uint32_t)(m_Speed * 1000));
-}
\ No newline at end of file
+	// Starts a new schedule, the first quantum is due one quantum from now
+	m_Epoch = std::chrono::steady_clock::now();
+	m_Cycles = 0;
+	m_StatsStart = m_Epoch;
+	m_StatsCycles = 0;
+	m_DroppedCycles = 0;
+
+	if (m_CycleNS != 0)
+	{
+		m_QuantumCycles = std::max<uint64_t>(1, (uint64_t)std::llround(CLOCK_QUANTUM_NS / m_CycleNS));
+		m_MaxCatchUpCycles = std::max<uint64_t>(m_QuantumCycles, (uint64_t)std::llround(CLOCK_MAX_CATCH_UP_NS / m_CycleNS));
+	}
+}
+
+Clock::TimePoint Clock::GetCycleTime(uint64_t cycle) const
+{
+	return m_Epoch + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::nano>(cycle * m_CycleNS));
+}
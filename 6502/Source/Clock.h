@@ -6,13 +6,30 @@
 #include <chrono>
 #include <thread>
 
+constexpr uint64_t CLOCK_QUANTUM_NS = 1000000;			// Time worth of cycles handed out per wakeup
+constexpr uint64_t CLOCK_MAX_CATCH_UP_NS = 100000000;	// Larger overruns are dropped instead of caught up
+constexpr uint64_t CLOCK_MAX_SPEED_QUANTUM = 1 << 20;	// Cycles handed out per call when running at max speed
+
+// Paces the emulation against a cycle counter. Each wakeup hands out a quantum
+// of cycles to run at once, and falls behind schedule are caught up by handing
+// out everything that is due.
 class Clock
 {
 private:
+	using TimePoint = std::chrono::steady_clock::time_point;
+
 	bool m_Running = false;
 	bool m_Step = false;
-	float m_Speed = 0;	// In ms
-	std::chrono::steady_clock::time_point m_NextCycleTime;
+	double m_CycleNS = 0;				// Cycle period, 0 for max speed
+	uint64_t m_QuantumCycles = 1;
+	uint64_t m_MaxCatchUpCycles = 1;
+
+	TimePoint m_Epoch;					// When cycle 0 of the schedule was due
+	uint64_t m_Cycles = 0;				// Cycles handed out since the epoch
+
+	TimePoint m_StatsStart;
+	uint64_t m_StatsCycles = 0;			// Cycles handed out since the stats start
+	uint64_t m_DroppedCycles = 0;		// Cycles given up after too large overruns
 
 public:
 	Clock() { UpdateClock(); }
@@ -23,12 +40,24 @@ public:
 	void Step();
 
 	inline bool IsRunning() { return m_Running; }
+	inline bool IsThrottled() { return m_Step || m_CycleNS != 0; }	// False when running at max speed
 
-	void WaitForNextCycle();
+	// Blocks until the next quantum is due and returns its number of cycles (at most maxCycles), 0 if stopped
+	uint64_t WaitForNextQuantum(uint64_t maxCycles = UINT64_MAX);
+	void ReturnCycles(uint64_t cycles);		// Hands back cycles of a quantum that were not run
+	inline void WaitForNextCycle() { WaitForNextQuantum(1); }
+	inline uint64_t GetQuantumCycles() const { return m_CycleNS != 0 ? m_QuantumCycles : CLOCK_MAX_SPEED_QUANTUM; }
 
 	void SetSpeedHZ(uint32_t speed);
 	void SetSpeedMS(float speed);
 
+	inline double GetRequestedHZ() const { return m_CycleNS != 0 ? 1e9 / m_CycleNS : 0; }	// 0 for max speed
+	double GetAchievedHZ() const;
+	inline uint64_t GetDroppedCycles() const { return m_DroppedCycles; }
+	void ReportSpeed() const;
+
 private:
+	void SetCyclePeriod(double nanoseconds);
 	void UpdateClock();
-};
\ No newline at end of file
+	TimePoint GetCycleTime(uint64_t cycle) const;
+};
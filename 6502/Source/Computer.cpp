@@ -2,14 +2,21 @@
 
 #include "Log.h"
 
-Computer::Computer(uint32_t sizeSRAM, uint32_t sizeEEPROM)
+#include <algorithm>
+
+Computer::Computer(uint32_t sizeSRAM, uint32_t sizeEEPROM, bool quiet)
 	: CPU(), clock()
 {
 	SRAM = new Memory(sizeSRAM, 0x0000, false);
 	EEPROM = new Memory(sizeEEPROM, (WORD)(MAX_MEMORY - sizeEEPROM), true);
+	CPU.AttachDevices(&IO);
+	CPU.EnableLazyFlags(true);	// Every run syncs the flags before it returns
 
-	LOG_INFO("SRAM initialized with address {0} -> {1} ({2} KB)", Log::WordToHexString((WORD)0), Log::WordToHexString((WORD)(sizeSRAM-1)), sizeSRAM / 1024);
-	LOG_INFO("EEPROM initialized with address {0} -> {1} ({2} KB)", Log::WordToHexString((WORD)(MAX_MEMORY - sizeEEPROM)), Log::WordToHexString((WORD)(MAX_MEMORY-1)), sizeEEPROM / 1024);
+	if (!quiet)
+	{
+		LOG_INFO("SRAM initialized with address {0} -> {1} ({2} KB)", Log::WordToHexString((WORD)0), Log::WordToHexString((WORD)(sizeSRAM-1)), sizeSRAM / 1024);
+		LOG_INFO("EEPROM initialized with address {0} -> {1} ({2} KB)", Log::WordToHexString((WORD)(MAX_MEMORY - sizeEEPROM)), Log::WordToHexString((WORD)(MAX_MEMORY-1)), sizeEEPROM / 1024);
+	}
 	
 	if (sizeSRAM + sizeEEPROM > MAX_MEMORY)
 		LOG_WARN("SRAM and EEPROM have shared memory addresses. This may result in unwanted behaviour.");
@@ -27,5 +34,135 @@ void Computer::RunCycle()
 		return;
 	clock.WaitForNextCycle();
 
+	RunEvents();
 	CPU.RunCycle(SRAM, EEPROM);
 }
+
+uint64_t Computer::RunInstructions(uint64_t quantity)
+{
+	// Runs at max speed, the clock is only checked for being stopped
+	if (!clock.IsRunning())
+		return 0;
+
+	CPU.AttachMemory(SRAM, EEPROM);
+
+	uint64_t cycles = 0;
+	for (uint64_t i = 0; i < quantity; i++)
+	{
+		// Events due in the middle of an instruction wait for its end
+		RunEvents();
+		cycles += CPU.RunInstruction();
+	}
+
+	CPU.SyncFlags();
+	IO.CatchUp(CPU.Cycles);
+	return cycles;
+}
+
+uint64_t Computer::RunCycles(uint64_t quantity)
+{
+	return RunUntil(NeverStop(), quantity);
+}
+
+uint64_t Computer::RunUntilPC(WORD address, uint64_t maxCycles)
+{
+	return RunUntil([address](Computer& computer) { return computer.CPU.PC == address; }, maxCycles);
+}
+
+uint64_t Computer::RunUntilOpcode(BYTE opcode, uint64_t maxCycles)
+{
+	return RunUntil([opcode](Computer& computer) { return computer.ReadByte(computer.CPU.PC) == opcode; }, maxCycles);
+}
+
+BYTE Computer::ReadByte(WORD address)
+{
+	// The last mapper attached wins where windows overlap, as on the bus
+	for (auto mapper = m_Mappers.rbegin(); mapper != m_Mappers.rend(); mapper++)
+	{
+		if ((*mapper)->IsInWindow(address))
+			return (*mapper)->GetSelectedMemory()->ReadByte(address);
+	}
+
+	if (SRAM->IsAddressOk(address))
+		return SRAM->ReadByte(address);
+
+	return EEPROM->ReadByte(address);
+}
+
+void Computer::TakeSnapshot(ComputerSnapshot& snapshot)
+{
+	CPU.SyncFlags();
+	snapshot.Cycles = CPU.Cycles;
+	snapshot.IdleCycles = CPU.GetIdleCycles();
+	snapshot.PC = CPU.PC;
+	snapshot.SP = CPU.SP;
+	snapshot.PS = CPU.PS.Byte;
+	snapshot.A = CPU.A;
+	snapshot.X = CPU.X;
+	snapshot.Y = CPU.Y;
+
+	snapshot.AddressBus = CPU.AddressBus;
+	snapshot.DataBus = CPU.DataBus;
+	snapshot.DataRead = CPU.DataRead;
+
+	snapshot.Running = clock.IsRunning();
+	snapshot.AchievedHZ = clock.GetAchievedHZ();
+
+	// EEPROM first so SRAM wins where they overlap, as on the bus
+	snapshot.Memory.fill(0);
+	for (Memory* memory : { EEPROM, SRAM })
+	{
+		uint32_t size = std::min<uint32_t>(memory->GetSize(), MAX_MEMORY - memory->GetZeroAddress());
+		std::copy_n(memory->GetData(), size, snapshot.Memory.begin() + memory->GetZeroAddress());
+	}
+
+	// Then the selected banks over them
+	snapshot.MapperCount = (uint32_t)m_Mappers.size();
+	for (uint32_t i = 0; i < snapshot.MapperCount; i++)
+	{
+		Memory* bank = m_Mappers[i]->GetSelectedMemory();
+		std::copy_n(bank->GetData(), bank->GetSize(), snapshot.Memory.begin() + bank->GetZeroAddress());
+		snapshot.Banks[i] = m_Mappers[i]->GetSelectedBank();
+	}
+}
+
+bool Computer::AttachDevice(Device* device, WORD first, WORD last)
+{
+	if (!IO.Attach(device, first, last, CPU.Cycles))
+		return false;
+
+	device->Connect(Events, CPU.Cycles);
+	return true;
+}
+
+void Computer::DetachDevice(Device* device)
+{
+	IO.CatchUp(CPU.Cycles);
+	IO.Detach(device);
+	Events.CancelAll(device);
+}
+
+bool Computer::AttachMapper(Mapper* mapper)
+{
+	if (m_Mappers.size() >= MAX_MAPPERS)
+	{
+		LOG_ERROR("A computer takes at most {0} mappers.", MAX_MAPPERS);
+		return false;
+	}
+	if (std::find(m_Mappers.begin(), m_Mappers.end(), mapper) != m_Mappers.end())
+		return false;
+
+	m_Mappers.push_back(mapper);
+	CPU.AttachMapper(mapper);
+	return true;
+}
+
+void Computer::DetachMapper(Mapper* mapper)
+{
+	auto it = std::find(m_Mappers.begin(), m_Mappers.end(), mapper);
+	if (it == m_Mappers.end())
+		return;
+
+	m_Mappers.erase(it);
+	CPU.DetachMapper(mapper);
+}
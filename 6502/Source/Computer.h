@@ -3,10 +3,25 @@
 #include "Base.h"
 #include "CPU.h"
 #include "Clock.h"
+#include "DeviceBus.h"
+#include "Mapper.h"
 #include "Memory.h"
+#include "Scheduler.h"
+#include "Snapshot.h"
+
+#include <algorithm>
+#include <type_traits>
+#include <vector>
 
 constexpr uint32_t MAX_MEMORY = 64 * 1024;
 
+// Stop condition of runs bounded by cycles only, which may run compiled code
+struct NeverStop
+{
+	template<typename T>
+	constexpr bool operator()(T&) const { return false; }
+};
+
 // Little endian (least-significant byte at the smallest address)
 // 0x0200 -> 0xFFFA	: General purpose or I/O
 // 
@@ -19,6 +34,19 @@ constexpr uint32_t MAX_MEMORY = 64 * 1024;
 //    0xFFFA/B : Non-Maskable Interrupt (NMI)
 //    0xFFFC/D : Reset (RES)
 //    0xFFFE/F : Interrupt Request (IRQ)
+//
+// --- I/O ------------------------------------------------------------------
+// Devices can be attached on any address range (usually 0x8000 -> 0xBFFF) and
+// take priority over SRAM and EEPROM.
+//
+// --- Banks ----------------------------------------------------------------
+// Mappers lie over SRAM and EEPROM in windows of whole pages, backed by the
+// bank they have selected. Devices keep priority over them.
+//
+// --- Events ---------------------------------------------------------------
+// Devices and the host schedule events (raising interrupts, changing device
+// state) on Events. Runs stop at each deadline to run its events, and the CPU
+// runs uninterrupted in between.
 
 class Computer
 {
@@ -27,13 +55,114 @@ public:
 	Clock clock;
 	Memory* SRAM;
 	Memory* EEPROM;
-
-	// TODO: I/O
-	// Display display;
+	DeviceBus IO;
+	Scheduler Events;
 
 public:
-	Computer(uint32_t sizeSRAM, uint32_t sizeEEPROM);
+	// Quiet computers do not log their memory layout, for fleets building many at once
+	Computer(uint32_t sizeSRAM, uint32_t sizeEEPROM, bool quiet = false);
 	~Computer();
 
 	void RunCycle();
+	uint64_t RunInstructions(uint64_t quantity);	// Returns the number of cycles run
+
+	// Batched runs, returning the number of cycles run. Stop conditions are only
+	// checked at instruction boundaries.
+	uint64_t RunCycles(uint64_t quantity);
+	uint64_t RunUntilPC(WORD address, uint64_t maxCycles = UINT64_MAX);
+	uint64_t RunUntilOpcode(BYTE opcode, uint64_t maxCycles = UINT64_MAX);
+	template<typename Predicate>
+	uint64_t RunUntil(Predicate stop, uint64_t maxCycles = UINT64_MAX);
+
+	BYTE ReadByte(WORD address);	// Reads memory without driving the CPU buses
+	void TakeSnapshot(ComputerSnapshot& snapshot);
+
+	bool AttachDevice(Device* device, WORD first, WORD last);	// The device is not owned by the computer
+	void DetachDevice(Device* device);
+
+	// The mapper is not owned by the computer, attach it as a device as well to give it a bank register
+	bool AttachMapper(Mapper* mapper);
+	void DetachMapper(Mapper* mapper);
+	inline const std::vector<Mapper*>& GetMappers() const { return m_Mappers; }
+
+private:
+	std::vector<Mapper*> m_Mappers;
+
+	// Runs the events due, which see the CPU as between runs
+	inline void RunEvents()
+	{
+		if (CPU.Cycles < Events.GetNextCycle())
+			return;
+		CPU.SyncFlags();
+		Events.Run(CPU.Cycles);
+	}
 };
+
+template<typename Predicate>
+uint64_t Computer::RunUntil(Predicate stop, uint64_t maxCycles)
+{
+	CPU.AttachMemory(SRAM, EEPROM);
+
+	// The clock hands out quanta of cycles, paced when throttled
+	uint64_t cycles = 0;
+	while (cycles < maxCycles)
+	{
+		uint64_t quantum = clock.WaitForNextQuantum(maxCycles - cycles);
+		if (quantum == 0)
+			break;
+
+		uint64_t run = 0;
+		bool stopped = false;
+		while (run < quantum && !stopped)
+		{
+			// The CPU runs uninterrupted up to the next event
+			RunEvents();
+			uint64_t end = run + std::min(quantum - run, Events.GetNextCycle() - CPU.Cycles);
+
+			while (run < end)
+			{
+				if (CPU.IsInstructionComplete())
+				{
+					if constexpr (std::is_same_v<Predicate, NeverStop>)
+					{
+						run += CPU.SkipIdleLoop(end - run);
+						run += CPU.RunCompiled(end - run);
+						if (run == end)
+							break;
+					}
+					else
+					{
+						// The predicate may look at the flags
+						CPU.SyncFlags();
+						if (stop(*this))
+						{
+							stopped = true;
+							break;
+						}
+					}
+
+					// Whole instructions run through their unrolled handlers while they fit before the deadline
+					if (end - run >= MAX_INSTRUCTION_CYCLES)
+					{
+						run += CPU.RunInstruction();
+						continue;
+					}
+				}
+
+				CPU.RunCycle();
+				run++;
+			}
+		}
+
+		cycles += run;
+		if (run < quantum)
+		{
+			clock.ReturnCycles(quantum - run);
+			break;
+		}
+	}
+
+	CPU.SyncFlags();
+	IO.CatchUp(CPU.Cycles);
+	return cycles;
+}
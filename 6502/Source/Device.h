@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Base.h"
+#include "Scheduler.h"
+
+// Memory-mapped peripheral. Addresses passed to Read/Write are absolute bus addresses.
+class Device
+{
+public:
+	virtual ~Device() = default;
+
+	virtual BYTE Read(WORD address) = 0;
+	virtual void Write(WORD address, BYTE value) = 0;
+
+	// Ticking is lazy: it happens right before the device is accessed and at the
+	// end of each batched run, with all the cycles elapsed since the last tick.
+	virtual void Tick(uint64_t) {}
+
+	// Cycles from the last tick until what the device reads back may change on its own.
+	// Until then reading it again must give the same values, so idle loops polling it
+	// can be skipped. Devices only changed by writes keep the default.
+	virtual uint64_t GetCyclesUntilEvent() { return UINT64_MAX; }
+
+	// Called once attached to a computer, at the given cycle. Devices keeping time
+	// (timers, serial, video) schedule their events there with themselves as owner,
+	// so they are cancelled along with the device when it is detached.
+	virtual void Connect(Scheduler&, uint64_t) {}
+};
@@ -0,0 +1,116 @@
+#include "DeviceBus.h"
+
+#include "Log.h"
+
+#include <algorithm>
+
+bool DeviceBus::Attach(Device* device, WORD first, WORD last, uint64_t cycle)
+{
+	if (first > last)
+	{
+		LOG_ERROR("Invalid device address range {0} -> {1}.", Log::WordToHexString(first), Log::WordToHexString(last));
+		return false;
+	}
+	if (m_Mappings.size() >= NO_DEVICE)
+	{
+		LOG_ERROR("Can't attach more than {0} devices.", NO_DEVICE);
+		return false;
+	}
+
+	for (const Mapping& mapping : m_Mappings)
+	{
+		if (first <= mapping.Last && mapping.First <= last)
+		{
+			LOG_ERROR("Device address range {0} -> {1} overlaps an attached device.", Log::WordToHexString(first), Log::WordToHexString(last));
+			return false;
+		}
+	}
+
+	m_Mappings.push_back({ device, first, last, cycle });
+	RebuildPages();
+
+	LOG_INFO("Device attached with address {0} -> {1}", Log::WordToHexString(first), Log::WordToHexString(last));
+	return true;
+}
+
+void DeviceBus::Detach(Device* device)
+{
+	for (auto it = m_Mappings.begin(); it != m_Mappings.end();)
+	{
+		if (it->Handle == device)
+			it = m_Mappings.erase(it);
+		else
+			it++;
+	}
+
+	RebuildPages();
+}
+
+BYTE DeviceBus::Read(WORD address, uint64_t cycle)
+{
+	return GetMapping(address, cycle).Handle->Read(address);
+}
+
+void DeviceBus::Write(WORD address, BYTE value, uint64_t cycle)
+{
+	GetMapping(address, cycle).Handle->Write(address, value);
+}
+
+void DeviceBus::CatchUp(uint64_t cycle)
+{
+	for (Mapping& mapping : m_Mappings)
+		TickMapping(mapping, cycle);
+}
+
+uint64_t DeviceBus::GetCyclesUntilEvent(uint64_t cycle)
+{
+	uint64_t cycles = UINT64_MAX;
+	for (Mapping& mapping : m_Mappings)
+	{
+		TickMapping(mapping, cycle);
+		cycles = std::min(cycles, mapping.Handle->GetCyclesUntilEvent());
+	}
+
+	return cycles;
+}
+
+DeviceBus::Mapping& DeviceBus::GetMapping(WORD address, uint64_t cycle)
+{
+	Mapping& mapping = m_Mappings[(*m_Pages[address >> 8])[address & 0xFF]];
+	TickMapping(mapping, cycle);
+
+	return mapping;
+}
+
+void DeviceBus::TickMapping(Mapping& mapping, uint64_t cycle)
+{
+	if (cycle <= mapping.LastTick)
+		return;
+
+	mapping.Handle->Tick(cycle - mapping.LastTick);
+	mapping.LastTick = cycle;
+}
+
+void DeviceBus::RebuildPages()
+{
+	for (auto& page : m_Pages)
+		page.reset();
+
+	for (size_t i = 0; i < m_Mappings.size(); i++)
+	{
+		const Mapping& mapping = m_Mappings[i];
+		for (uint32_t address = mapping.First; address <= mapping.Last; address++)
+		{
+			auto& page = m_Pages[address >> 8];
+			if (page == nullptr)
+			{
+				page = std::make_unique<PageSlots>();
+				page->fill(NO_DEVICE);
+			}
+
+			(*page)[address & 0xFF] = (BYTE)i;
+		}
+	}
+
+	m_Generation++;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Base.h"
+#include "Device.h"
+
+#include <array>
+#include <memory>
+#include <vector>
+
+// Address ranges claimed by devices. Devices are not owned by the bus.
+class DeviceBus
+{
+private:
+	struct Mapping
+	{
+		Device* Handle;
+		WORD First, Last;
+		uint64_t LastTick;
+	};
+
+	static constexpr BYTE NO_DEVICE = 0xFF;
+	using PageSlots = std::array<BYTE, 256>;	// Mapping index per address in a page
+
+	std::vector<Mapping> m_Mappings;
+	std::array<std::unique_ptr<PageSlots>, 256> m_Pages;
+	uint32_t m_Generation = 0;
+
+public:
+	DeviceBus() = default;
+	~DeviceBus() = default;
+
+	bool Attach(Device* device, WORD first, WORD last, uint64_t cycle = 0);
+	void Detach(Device* device);
+
+	inline bool IsPageMapped(WORD address) const { return m_Pages[address >> 8] != nullptr; }
+	inline bool IsAddressMapped(WORD address) const { return IsPageMapped(address) && (*m_Pages[address >> 8])[address & 0xFF] != NO_DEVICE; }
+	inline uint32_t GetGeneration() const { return m_Generation; }	// Changes whenever a device is attached or detached
+
+	BYTE Read(WORD address, uint64_t cycle);
+	void Write(WORD address, BYTE value, uint64_t cycle);
+
+	void CatchUp(uint64_t cycle);
+	uint64_t GetCyclesUntilEvent(uint64_t cycle);	// Catches up, then returns the cycles until the first device event
+
+private:
+	Mapping& GetMapping(WORD address, uint64_t cycle);
+	void TickMapping(Mapping& mapping, uint64_t cycle);
+	void RebuildPages();
+};
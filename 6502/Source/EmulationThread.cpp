@@ -0,0 +1,132 @@
+#include "EmulationThread.h"
+
+#include "Log.h"
+#include "ProgramLoader.h"
+
+#include <chrono>
+
+constexpr std::chrono::milliseconds SNAPSHOT_INTERVAL(10);
+constexpr std::chrono::milliseconds IDLE_POLL_INTERVAL(1);
+
+#pragma region CommandQueue
+
+bool CommandQueue::Push(Command command)
+{
+	uint32_t head = m_Head.load(std::memory_order_relaxed);
+	if (head - m_Tail.load(std::memory_order_acquire) == CAPACITY)
+		return false;
+
+	m_Commands[head % CAPACITY] = std::move(command);
+	m_Head.store(head + 1, std::memory_order_release);
+	return true;
+}
+
+bool CommandQueue::Pop(Command& command)
+{
+	uint32_t tail = m_Tail.load(std::memory_order_relaxed);
+	if (tail == m_Head.load(std::memory_order_acquire))
+		return false;
+
+	command = std::move(m_Commands[tail % CAPACITY]);
+	m_Tail.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+#pragma endregion
+
+#pragma region EmulationThread
+
+EmulationThread::EmulationThread(Computer* computer)
+	: m_Computer(computer)
+{
+	PublishSnapshot();
+	m_Thread = std::thread(&EmulationThread::Run, this);
+}
+
+EmulationThread::~EmulationThread()
+{
+	m_Quit.store(true, std::memory_order_release);
+	m_Thread.join();
+}
+
+bool EmulationThread::Send(Command command)
+{
+	if (!m_Commands.Push(std::move(command)))
+	{
+		LOG_WARN("Emulation command queue is full, command dropped.");
+		return false;
+	}
+
+	return true;
+}
+
+void EmulationThread::Run()
+{
+	auto lastSnapshot = std::chrono::steady_clock::now();
+	bool changed = false;
+
+	while (!m_Quit.load(std::memory_order_acquire))
+	{
+		Command command;
+		while (m_Commands.Pop(command))
+		{
+			Execute(command);
+			changed = true;
+		}
+
+		if (m_Computer->clock.IsRunning())
+		{
+			// One quantum at a time so commands are picked up between them
+			m_Computer->RunCycles(m_Computer->clock.GetQuantumCycles());
+			changed = true;
+
+			if (std::chrono::steady_clock::now() - lastSnapshot < SNAPSHOT_INTERVAL)
+				continue;
+		}
+		else if (!changed)
+		{
+			std::this_thread::sleep_for(IDLE_POLL_INTERVAL);
+			continue;
+		}
+
+		PublishSnapshot();
+		lastSnapshot = std::chrono::steady_clock::now();
+		changed = false;
+	}
+
+	m_Computer->clock.Stop();
+}
+
+void EmulationThread::Execute(const Command& command)
+{
+	switch (command.Type)
+	{
+	case CommandType::Start:
+		m_Computer->clock.Start();
+		break;
+	case CommandType::Stop:
+		m_Computer->clock.Stop();
+		break;
+	case CommandType::Step:
+		m_Computer->clock.Step();
+		break;
+	case CommandType::SetSpeed:
+		if (command.Value == 0)
+			m_Computer->clock.SetSpeedMS(0);
+		else
+			m_Computer->clock.SetSpeedHZ(command.Value);
+		break;
+	case CommandType::Load:
+		ProgramLoader(m_Computer->SRAM, m_Computer->EEPROM).Load(command.Filepath);
+		m_Computer->CPU.Reset();
+		break;
+	}
+}
+
+void EmulationThread::PublishSnapshot()
+{
+	m_Computer->TakeSnapshot(m_Snapshots.GetBack());
+	m_Snapshots.Publish();
+}
+
+#pragma endregion
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Base.h"
+#include "Computer.h"
+#include "Snapshot.h"
+
+#include <array>
+#include <atomic>
+#include <string>
+#include <thread>
+
+enum class CommandType : BYTE
+{
+	Start,
+	Stop,
+	Step,
+	SetSpeed,	// Value in Hz, 0 for max speed
+	Load		// Loads the program file at Filepath (any ProgramFormat) and resets the CPU
+};
+
+struct Command
+{
+	CommandType Type = CommandType::Stop;
+	uint32_t Value = 0;
+	std::string Filepath = "";
+};
+
+// Single producer, single consumer queue that never blocks
+class CommandQueue
+{
+private:
+	static constexpr uint32_t CAPACITY = 64;
+
+	std::array<Command, CAPACITY> m_Commands;
+	std::atomic<uint32_t> m_Head = 0;	// Next slot to push, written by the producer
+	std::atomic<uint32_t> m_Tail = 0;	// Next slot to pop, written by the consumer
+
+public:
+	CommandQueue() = default;
+	~CommandQueue() = default;
+
+	bool Push(Command command);		// False if the queue is full
+	bool Pop(Command& command);		// False if the queue is empty
+};
+
+// Runs a computer on its own thread. Once launched the computer must only be
+// touched through the commands, and its state read through the snapshots.
+class EmulationThread
+{
+private:
+	Computer* m_Computer;
+	CommandQueue m_Commands;
+	SnapshotBuffer m_Snapshots;
+
+	std::thread m_Thread;
+	std::atomic<bool> m_Quit = false;
+
+public:
+	EmulationThread(Computer* computer);	// The computer is not owned
+	~EmulationThread();						// Stops the clock and joins the thread
+
+	inline bool Start() { return Send({ CommandType::Start }); }
+	inline bool Stop() { return Send({ CommandType::Stop }); }
+	inline bool Step() { return Send({ CommandType::Step }); }
+	inline bool SetSpeedHZ(uint32_t speed) { return Send({ CommandType::SetSpeed, speed }); }
+	inline bool LoadProgram(const std::string& filepath) { return Send({ CommandType::Load, 0, filepath }); }
+	bool Send(Command command);
+
+	// Latest snapshot, only to be called from one thread (usually the GUI)
+	inline const ComputerSnapshot& ReadSnapshot() { return m_Snapshots.Read(); }
+
+private:
+	void Run();
+	void Execute(const Command& command);
+	void PublishSnapshot();
+};
@@ -0,0 +1,188 @@
+#include "Fleet.h"
+
+#include "Log.h"
+
+#include <algorithm>
+#include <chrono>
+
+Fleet::Fleet(uint32_t machines, uint32_t sizeSRAM, MemoryImage ROM, uint32_t threads)
+{
+	if (!ROM)
+	{
+		LOG_ERROR("A fleet needs a ROM image.");
+		return;
+	}
+
+	m_Machines.reserve(machines);
+	for (uint32_t i = 0; i < machines; i++)
+	{
+		auto computer = std::make_unique<Computer>(sizeSRAM, ROM.GetSize(), true);	// The fleet logs one line for all
+		computer->EEPROM->ShareImage(ROM);
+		computer->clock.Start();	// Max speed
+		m_Machines.push_back(std::move(computer));
+	}
+
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+
+	for (uint32_t i = 0; i < threads; i++)
+		m_Workers.push_back(std::make_unique<Worker>());
+	for (uint32_t i = 0; i < threads; i++)
+		m_Workers[i]->Thread = std::thread(&Fleet::WorkerLoop, this, i);
+
+	LOG_INFO("Fleet of {0} machines ({1} KB SRAM, {2} KB EEPROM) running on {3} threads", machines, sizeSRAM / 1024, ROM.GetSize() / 1024, threads);
+}
+
+Fleet::~Fleet()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_RunLock);
+		m_Quit = true;
+	}
+	m_RunStarted.notify_all();
+
+	for (auto& worker : m_Workers)
+		worker->Thread.join();
+}
+
+uint64_t Fleet::Run(uint64_t cycles, uint64_t quantum)
+{
+	if (m_Machines.empty() || m_Workers.empty() || cycles == 0)
+		return 0;
+
+	// Deal the machines out evenly, stealing evens out the rest
+	for (uint32_t i = 0; i < m_Machines.size(); i++)
+	{
+		Worker& worker = *m_Workers[i % m_Workers.size()];
+		std::lock_guard<std::mutex> lock(worker.Lock);
+		worker.Tasks.push_back({ i, cycles });
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	{
+		std::unique_lock<std::mutex> lock(m_RunLock);
+		m_Quantum = std::max<uint64_t>(1, quantum);
+		m_RunCycles = 0;
+		m_PendingMachines = (uint32_t)m_Machines.size();
+		m_Run++;
+		m_RunStarted.notify_all();
+
+		m_RunFinished.wait(lock, [this] { return m_PendingMachines == 0; });
+	}
+
+	m_LastRunSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	m_LastRunCycles = m_RunCycles;
+	return m_LastRunCycles;
+}
+
+void Fleet::ReportSpeed() const
+{
+	uint64_t idleCycles = 0;
+	for (const auto& machine : m_Machines)
+		idleCycles += machine->CPU.GetIdleCycles();
+
+	LOG_INFO("Fleet ran {0} cycles at {1:.2f} MHz ({2} machines, {3} threads, {4} cycles skipped idle since power on)",
+		m_LastRunCycles, GetEmulatedMHz(), GetSize(), GetThreadCount(), idleCycles);
+}
+
+void Fleet::WorkerLoop(uint32_t index)
+{
+	uint64_t seenRun = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_RunLock);
+			m_RunStarted.wait(lock, [this, seenRun] { return m_Quit || m_Run != seenRun; });
+			if (m_Quit)
+				return;
+			seenRun = m_Run;
+		}
+
+		Task task;
+		while (m_PendingMachines.load(std::memory_order_acquire) != 0)
+		{
+			if (!TakeTask(index, task))
+			{
+				WaitForTask();
+				continue;
+			}
+
+			uint64_t cycles = m_Machines[task.Machine]->RunCycles(std::min(task.Cycles, m_Quantum.load(std::memory_order_relaxed)));
+			m_RunCycles.fetch_add(cycles, std::memory_order_relaxed);
+
+			// A machine that ran short has its clock stopped, it is done for this run
+			task.Cycles = cycles != 0 ? task.Cycles - cycles : 0;
+			if (task.Cycles != 0)
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_Workers[index]->Lock);
+					m_Workers[index]->Tasks.push_back(task);
+				}
+
+				// Idle workers check the queues under the run lock, so taking it cannot miss one going to sleep
+				if (m_IdleWorkers.load() != 0)
+				{
+					std::lock_guard<std::mutex> lock(m_RunLock);
+					m_TaskQueued.notify_one();
+				}
+			}
+			else if (m_PendingMachines.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			{
+				std::lock_guard<std::mutex> lock(m_RunLock);
+				m_RunFinished.notify_all();
+				m_TaskQueued.notify_all();
+			}
+		}
+	}
+}
+
+bool Fleet::TakeTask(uint32_t index, Task& task)
+{
+	{
+		Worker& own = *m_Workers[index];
+		std::lock_guard<std::mutex> lock(own.Lock);
+		if (!own.Tasks.empty())
+		{
+			task = own.Tasks.back();
+			own.Tasks.pop_back();
+			return true;
+		}
+	}
+
+	// Steal from the others, starting with the next worker
+	for (uint32_t i = 1; i < m_Workers.size(); i++)
+	{
+		Worker& victim = *m_Workers[(index + i) % m_Workers.size()];
+		std::lock_guard<std::mutex> lock(victim.Lock);
+		if (!victim.Tasks.empty())
+		{
+			task = victim.Tasks.front();
+			victim.Tasks.pop_front();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool Fleet::HasTask() const
+{
+	for (const auto& worker : m_Workers)
+	{
+		std::lock_guard<std::mutex> lock(worker->Lock);
+		if (!worker->Tasks.empty())
+			return true;
+	}
+
+	return false;
+}
+
+void Fleet::WaitForTask()
+{
+	// The machines left are running on other workers, and are queued again after their quantum
+	std::unique_lock<std::mutex> lock(m_RunLock);
+	m_IdleWorkers++;
+	m_TaskQueued.wait(lock, [this] { return m_PendingMachines.load() == 0 || HasTask(); });
+	m_IdleWorkers--;
+}
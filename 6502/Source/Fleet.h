@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Base.h"
+#include "Computer.h"
+#include "Memory.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+constexpr uint64_t FLEET_QUANTUM = 10000;	// Cycles a machine runs before going back to the queue
+
+// Runs many independent computers sharing one ROM image on a pool of worker
+// threads. Every worker has its own queue of machines and steals from the
+// others once it runs dry, so uneven machines still keep all cores busy.
+// Images from Memory::LoadImage are mapped, so the machines all run on the
+// page cache copy of the firmware file.
+class Fleet
+{
+private:
+	struct Task
+	{
+		uint32_t Machine;
+		uint64_t Cycles;	// Left to run
+	};
+
+	struct Worker
+	{
+		std::thread Thread;
+		std::mutex Lock;
+		std::deque<Task> Tasks;	// The owner takes from the back, thieves from the front
+	};
+
+	std::vector<std::unique_ptr<Computer>> m_Machines;
+	std::vector<std::unique_ptr<Worker>> m_Workers;
+	std::atomic<uint64_t> m_Quantum = FLEET_QUANTUM;
+
+	std::mutex m_RunLock;
+	std::condition_variable m_RunStarted;
+	std::condition_variable m_RunFinished;
+	std::condition_variable m_TaskQueued;	// Wakes idle workers when a machine is queued again or the run ends
+	uint64_t m_Run = 0;					// Bumped for every run, wakes the workers
+	bool m_Quit = false;
+	std::atomic<uint32_t> m_IdleWorkers = 0;
+	std::atomic<uint32_t> m_PendingMachines = 0;
+	std::atomic<uint64_t> m_RunCycles = 0;
+
+	double m_LastRunSeconds = 0;
+	uint64_t m_LastRunCycles = 0;
+
+public:
+	// Threads default to the number of cores
+	Fleet(uint32_t machines, uint32_t sizeSRAM, MemoryImage ROM, uint32_t threads = 0);
+	~Fleet();
+
+	// Runs every machine for the given number of cycles and returns the total run
+	uint64_t Run(uint64_t cycles, uint64_t quantum = FLEET_QUANTUM);
+
+	inline Computer& GetComputer(uint32_t index) { return *m_Machines[index]; }
+	inline uint32_t GetSize() const { return (uint32_t)m_Machines.size(); }
+	inline uint32_t GetThreadCount() const { return (uint32_t)m_Workers.size(); }
+
+	// Emulated cycles per second of all machines together during the last run
+	inline double GetEmulatedMHz() const { return m_LastRunSeconds > 0 ? m_LastRunCycles / m_LastRunSeconds / 1000000 : 0; }
+	void ReportSpeed() const;
+
+private:
+	void WorkerLoop(uint32_t index);
+	bool TakeTask(uint32_t index, Task& task);
+	bool HasTask() const;
+	void WaitForTask();	// Until a machine is queued or none is left to run
+};
@@ -0,0 +1,147 @@
+#include "IdleLoop.h"
+
+static bool IsBranch(Operation op)
+{
+	return op >= Operation::BCC && op <= Operation::BVS;
+}
+
+static bool IsIndexStep(Operation op)
+{
+	return op == Operation::DEX || op == Operation::DEY || op == Operation::INX || op == Operation::INY;
+}
+
+static bool IsStepOfX(Operation op)
+{
+	return op == Operation::DEX || op == Operation::INX;
+}
+
+static const IdleLoop NO_LOOP;
+
+const IdleLoop& IdleLoopFinder::Find(WORD head, const PageTable& pages)
+{
+	const Page& page = pages.GetPage(head);
+	if (page.Data == nullptr)
+		return NO_LOOP;
+
+	Verdict& verdict = GetVerdict(head);
+	if (verdict.Page != page.Generation || verdict.Generation != *page.Generation || verdict.Head != head)
+	{
+		verdict.Page = page.Generation;
+		verdict.Generation = *page.Generation;
+		verdict.Head = head;
+		verdict.Loop = Decode(head, page);
+	}
+
+	return verdict.Loop;
+}
+
+void IdleLoopFinder::Reject(WORD head, const PageTable& pages)
+{
+	const Page& page = pages.GetPage(head);
+	if (page.Data == nullptr)
+		return;
+
+	Verdict& verdict = GetVerdict(head);
+	verdict.Page = page.Generation;
+	verdict.Generation = *page.Generation;
+	verdict.Head = head;
+	verdict.Loop = {};
+}
+
+void IdleLoopFinder::Clear()
+{
+	m_Verdicts.fill({});
+}
+
+IdleLoop IdleLoopFinder::Decode(WORD head, const Page& page) const
+{
+	IdleLoop countdown = DecodeCountdown(head, page);
+	if (countdown.Kind != IdleLoopKind::None)
+		return countdown;
+
+	// The whole loop must sit in the page of its head
+	uint32_t offset = head & 0xFF;
+	for (BYTE i = 1; i <= IDLE_LOOP_MAX_INSTRUCTIONS; i++)
+	{
+		BYTE opcode = page.Data[offset];
+		const OpcodeInfo& info = MicroCode::GetInfo(opcode);
+		const MicroProgram& program = MicroCode::GetProgram(opcode);
+		if (program.Length == 0 || offset + program.Bytes > 256)
+			return {};
+
+		switch (info.Op)
+		{
+		case Operation::None:
+		case Operation::PHA: case Operation::PHP: case Operation::PLA: case Operation::PLP:
+		case Operation::BRK: case Operation::RTI: case Operation::JSR: case Operation::RTS:
+		case Operation::DEX: case Operation::DEY: case Operation::INX: case Operation::INY:
+			return {};
+
+		case Operation::JMP:
+		{
+			WORD target = page.Data[offset + 1] | (page.Data[offset + 2] << 8);
+			if (info.Mode != AddressingMode::Absolute || target != head)
+				return {};
+			return { IdleLoopKind::Idle, i };
+		}
+
+		default:
+			if (info.Access == AccessClass::Write || info.Access == AccessClass::ReadModifyWrite)
+				return {};
+			break;
+		}
+
+		offset += program.Bytes;
+		// Branches elsewhere leave the loop, which running it will tell
+		if (IsBranch(info.Op) && WORD((head & 0xFF00) + offset + (int8_t)page.Data[offset - 1]) == head)
+			return { IdleLoopKind::Idle, i };
+	}
+
+	return {};
+}
+
+IdleLoop IdleLoopFinder::DecodeCountdown(WORD head, const Page& page) const
+{
+	// Up to LDY #n / DEY / BNE / DEX / BNE, all in the page of the head
+	uint32_t offset = head & 0xFF;
+	std::array<Operation, IDLE_LOOP_MAX_INSTRUCTIONS + 1> ops = {};
+	std::array<WORD, IDLE_LOOP_MAX_INSTRUCTIONS + 1> ends = {};		// Address following each instruction
+	std::array<BYTE, IDLE_LOOP_MAX_INSTRUCTIONS + 1> operands = {};
+	for (size_t i = 0; i < ops.size() && offset < 256; i++)
+	{
+		const OpcodeInfo& info = MicroCode::GetInfo(page.Data[offset]);
+		const MicroProgram& program = MicroCode::GetProgram(page.Data[offset]);
+		if (program.Length == 0 || offset + program.Bytes > 256)
+			break;
+
+		bool immediate = info.Mode == AddressingMode::Immediate;
+		if (!(IsIndexStep(info.Op) || info.Op == Operation::BNE || (immediate && (info.Op == Operation::LDX || info.Op == Operation::LDY))))
+			break;
+
+		ops[i] = info.Op;
+		operands[i] = program.Bytes > 1 ? page.Data[offset + 1] : 0;
+		offset += program.Bytes;
+		ends[i] = (head & 0xFF00) + offset;
+	}
+
+	// Taken branches spend one more cycle when landing on another page
+	auto getTarget = [&](size_t i) { return WORD(ends[i] + (int8_t)operands[i]); };
+	auto getTakenCycles = [&](size_t i) { return 3u + ((ends[i] >> 8) != (getTarget(i) >> 8)); };
+
+	if (IsIndexStep(ops[0]) && ops[1] == Operation::BNE && getTarget(1) == head)
+		return { IdleLoopKind::Countdown, 2, ops[0], 2 + getTakenCycles(1), operands[1] };
+
+	// The inner register is reloaded, the outer one is the other index register
+	bool reloadsX = ops[0] == Operation::LDX;
+	if ((ops[0] == Operation::LDX || ops[0] == Operation::LDY) && IsIndexStep(ops[1]) && IsStepOfX(ops[1]) == reloadsX
+		&& ops[2] == Operation::BNE && getTarget(2) == ends[0]
+		&& IsIndexStep(ops[3]) && IsStepOfX(ops[3]) != reloadsX && ops[4] == Operation::BNE && getTarget(4) == head)
+	{
+		// LD #n, the inner iterations taking the branch and the last one, then the outer step and branch
+		uint32_t inner = GetCountdownIterations(ops[1], operands[0]);
+		uint32_t cycles = 2 + (inner - 1) * (2 + getTakenCycles(2)) + (2 + 2) + 2 + getTakenCycles(4);
+		return { IdleLoopKind::NestedCountdown, 5, ops[3], cycles, operands[4] };
+	}
+
+	return {};
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Base.h"
+#include "MicroCode.h"
+#include "PageTable.h"
+
+#include <array>
+
+constexpr uint32_t IDLE_LOOP_MAX_INSTRUCTIONS = 4;
+constexpr uint32_t IDLE_LOOP_MAX_CYCLES = IDLE_LOOP_MAX_INSTRUCTIONS * MAX_INSTRUCTION_CYCLES;	// Of one iteration
+constexpr uint32_t IDLE_LOOP_CACHE_SIZE = 64;
+
+enum class IdleLoopKind : BYTE
+{
+	None,
+	Idle,				// Only reads memory, whether it idles is seen by running it (JMP *, LDA status / BEQ)
+	Countdown,			// Steps an index register until it wraps to 0 (DEX / BNE)
+	NestedCountdown		// Reloads and counts down an inner register, then steps the outer one (LDY #n / DEY / BNE / DEX / BNE)
+};
+
+struct IdleLoop
+{
+	IdleLoopKind Kind = IdleLoopKind::None;
+	BYTE Instructions = 0;				// Of one iteration
+	Operation Step = Operation::None;	// DEX, DEY, INX or INY of countdowns, the outer one when nested
+	uint32_t Cycles = 0;				// Of an iteration taking the branch back, for countdowns
+	BYTE BranchOffset = 0;				// Of the branch back of countdowns, left on the data bus
+};
+
+// Iterations of a countdown stepping value, the one ending at 0 included
+inline uint32_t GetCountdownIterations(Operation step, BYTE value)
+{
+	bool decrement = step == Operation::DEX || step == Operation::DEY;
+	return value == 0 ? 256 : decrement ? value : 256 - value;
+}
+
+// Finds the loops that may spin without side effects: a few instructions that
+// never write memory nor touch the stack, closed by a branch or an absolute jump
+// back to the first one. Countdowns only step registers, so their iterations can
+// be worked out without running them. Verdicts are kept until the page holding
+// the loop is written to.
+class IdleLoopFinder
+{
+public:
+	IdleLoopFinder() = default;
+	~IdleLoopFinder() = default;
+
+	// Returns the loop starting at head, of kind None if there is none
+	const IdleLoop& Find(WORD head, const PageTable& pages);
+	// Records that the loop starting at head was seen not to idle
+	void Reject(WORD head, const PageTable& pages);
+	// Must be called whenever the page table is remapped
+	void Clear();
+
+private:
+	struct Verdict
+	{
+		const uint32_t* Page = nullptr;	// Generation counter of the page of the loop, nullptr if unused
+		uint32_t Generation = 0;
+		WORD Head = 0;
+		IdleLoop Loop;
+	};
+
+	IdleLoop Decode(WORD head, const Page& page) const;
+	IdleLoop DecodeCountdown(WORD head, const Page& page) const;
+	inline Verdict& GetVerdict(WORD head) { return m_Verdicts[head % IDLE_LOOP_CACHE_SIZE]; }
+
+	std::array<Verdict, IDLE_LOOP_CACHE_SIZE> m_Verdicts;
+};
@@ -0,0 +1,852 @@
+#include "Jit.h"
+
+#include "Log.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+
+#if defined(__x86_64__) && defined(__linux__)
+	#define JIT_X86_64
+	#include <sys/mman.h>
+#endif
+
+namespace {
+
+	// Zero and negative flags of every value
+	struct FlagTable
+	{
+		BYTE ZN[256];
+
+		FlagTable()
+		{
+			for (uint32_t i = 0; i < 256; i++)
+				ZN[i] = (i == 0 ? 0x02 : 0x00) | (i & 0x80);
+		}
+	};
+	const FlagTable s_Flags;
+
+	enum Reg : BYTE { EAX = 0, ECX = 1, EDX = 2, ESI = 6 };
+	enum Condition : BYTE { JE = 0x4, JNE = 0x5, JA = 0x7, JMP = 0xFF };
+
+	constexpr BYTE CTX_CYCLES		= offsetof(JitContext, Cycles);
+	constexpr BYTE CTX_CYCLE_LIMIT	= offsetof(JitContext, CycleLimit);
+	constexpr BYTE CTX_PC			= offsetof(JitContext, PC);
+	constexpr BYTE CTX_ADDRESS_BUS	= offsetof(JitContext, AddressBus);
+	constexpr BYTE CTX_A			= offsetof(JitContext, A);
+	constexpr BYTE CTX_X			= offsetof(JitContext, X);
+	constexpr BYTE CTX_Y			= offsetof(JitContext, Y);
+	constexpr BYTE CTX_SP			= offsetof(JitContext, SP);
+	constexpr BYTE CTX_PS			= offsetof(JitContext, PS);
+	constexpr BYTE CTX_DATA_BUS		= offsetof(JitContext, DataBus);
+	constexpr BYTE CTX_DATA_READ	= offsetof(JitContext, DataRead);
+
+	// Emits the handful of x86-64 instructions the compiler needs. The context is
+	// in rdi, the flag table in r8 and host memory is always addressed through rdx.
+	class Assembler
+	{
+	public:
+		std::vector<BYTE> Code;
+
+		inline uint32_t GetPosition() const { return (uint32_t)Code.size(); }
+		inline void Truncate(uint32_t position) { Code.resize(position); }
+
+		void Emit(std::initializer_list<BYTE> bytes) { Code.insert(Code.end(), bytes); }
+		void Emit32(uint32_t value) { for (int i = 0; i < 4; i++) Code.push_back(BYTE(value >> (8 * i))); }
+		void Emit64(uint64_t value) { for (int i = 0; i < 8; i++) Code.push_back(BYTE(value >> (8 * i))); }
+
+		// Context fields, [rdi + offset]
+		void Load(Reg reg, BYTE offset)					{ Emit({ 0x0F, 0xB6, ContextModRM(reg), offset }); }
+		void Store(BYTE offset, Reg reg)				{ ByteRex(reg); Emit({ 0x88, ContextModRM(reg), offset }); }
+		void StoreImm(BYTE offset, BYTE value)			{ Emit({ 0xC6, 0x47, offset, value }); }
+		void StoreWord(BYTE offset, Reg reg)			{ Emit({ 0x66, 0x89, ContextModRM(reg), offset }); }
+		void StoreWordImm(BYTE offset, WORD value)		{ Emit({ 0x66, 0xC7, 0x47, offset, BYTE(value), BYTE(value >> 8) }); }
+		void AndImm(BYTE offset, BYTE value)			{ Emit({ 0x80, 0x67, offset, value }); }
+		void OrImm(BYTE offset, BYTE value)				{ Emit({ 0x80, 0x4F, offset, value }); }
+		void Or(BYTE offset, Reg reg)					{ ByteRex(reg); Emit({ 0x08, ContextModRM(reg), offset }); }
+		void TestImm(BYTE offset, BYTE value)			{ Emit({ 0xF6, 0x47, offset, value }); }
+		void AddCycles(BYTE cycles)						{ Emit({ 0x48, 0x83, 0x47, CTX_CYCLES, cycles }); }
+		void AddCycles(Reg reg)							{ Emit({ 0x48, 0x01, ContextModRM(reg), CTX_CYCLES }); }
+
+		// Leaves through the returned jump unless cycles more cycles fit under the limit
+		uint32_t CheckCycles(BYTE cycles)
+		{
+			Emit({ 0x48, 0x8B, 0x47, CTX_CYCLES });			// mov rax, [rdi + Cycles]
+			Emit({ 0x48, 0x83, 0xC0, cycles });				// add rax, cycles
+			Emit({ 0x48, 0x3B, 0x47, CTX_CYCLE_LIMIT });	// cmp rax, [rdi + CycleLimit]
+			return Jump(JA);
+		}
+
+		// 32-bit register operations
+		void Op(BYTE opcode, Reg dst, Reg src)			{ Emit({ opcode, BYTE(0xC0 | (src << 3) | dst) }); }
+		void Move(Reg dst, Reg src)						{ Op(0x89, dst, src); }
+		void Add(Reg dst, Reg src)						{ Op(0x01, dst, src); }
+		void Sub(Reg dst, Reg src)						{ Op(0x29, dst, src); }
+		void OrReg(Reg dst, Reg src)					{ Op(0x09, dst, src); }
+		void AndReg(Reg dst, Reg src)					{ Op(0x21, dst, src); }
+		void XorReg(Reg dst, Reg src)					{ Op(0x31, dst, src); }
+		void OpImm(BYTE digit, Reg reg, uint32_t value)	{ Emit({ 0x81, BYTE(0xC0 | (digit << 3) | reg) }); Emit32(value); }
+		void AddImm(Reg reg, uint32_t value)			{ OpImm(0, reg, value); }
+		void OrRegImm(Reg reg, uint32_t value)			{ OpImm(1, reg, value); }
+		void AndRegImm(Reg reg, uint32_t value)			{ OpImm(4, reg, value); }
+		void SubImm(Reg reg, uint32_t value)			{ OpImm(5, reg, value); }
+		void XorImm(Reg reg, uint32_t value)			{ OpImm(6, reg, value); }
+		void ShiftLeft(Reg reg, BYTE count)				{ Emit({ 0xC1, BYTE(0xE0 | reg), count }); }
+		void ShiftRight(Reg reg, BYTE count)			{ Emit({ 0xC1, BYTE(0xE8 | reg), count }); }
+		void MoveImm(Reg reg, uint32_t value)			{ Emit({ BYTE(0xB8 | reg) }); Emit32(value); }
+		void MovePointer(Reg reg, const void* pointer)	{ Emit({ 0x48, BYTE(0xB8 | reg) }); Emit64((uint64_t)pointer); }
+
+		// Host memory
+		void HostAddress()								{ Emit({ 0x48, 0x8D, 0x14, 0x0A }); }	// lea rdx, [rdx + rcx]
+		void LoadHost(Reg reg)							{ Emit({ 0x0F, 0xB6, BYTE((reg << 3) | EDX) }); }
+		void StoreHost(Reg reg)							{ ByteRex(reg); Emit({ 0x88, BYTE((reg << 3) | EDX) }); }
+		void LookupFlags(Reg dst, Reg value)			{ Emit({ 0x41, 0x0F, 0xB6, BYTE((dst << 3) | 4), BYTE(value << 3) }); }	// movzx dst, [r8 + value]
+		void LookupWord(Reg dst, Reg index)				{ Emit({ 0x0F, 0xB7, BYTE((dst << 3) | 4), BYTE(0x40 | (index << 3) | ESI) }); }	// movzx dst, word [rsi + index * 2]
+
+		// Page write counters, through rsi
+		void IncrementCounter(const uint32_t* counter)	{ MovePointer(ESI, counter); Emit({ 0xFF, 0x06 }); }
+		void IncrementCounter(const uint32_t* counter, Reg index)
+		{
+			MovePointer(ESI, counter);
+			Emit({ 0xFF, 0x04, BYTE(0x80 | (index << 3) | ESI) });	// inc dword [rsi + index * 4]
+		}
+		void CompareCounter(const uint32_t* counter, uint32_t value)
+		{
+			MovePointer(ESI, counter);
+			Emit({ 0x81, 0x3E });
+			Emit32(value);
+		}
+
+		uint32_t Jump(Condition condition)
+		{
+			if (condition == JMP)
+				Emit({ 0xE9 });
+			else
+				Emit({ 0x0F, BYTE(0x80 | condition) });
+
+			Emit32(0);
+			return GetPosition() - 4;
+		}
+		void Bind(uint32_t jump, uint32_t target)
+		{
+			uint32_t relative = target - (jump + 4);
+			std::memcpy(&Code[jump], &relative, 4);
+		}
+		void Return()									{ Emit({ 0xC3 }); }
+
+	private:
+		static BYTE ContextModRM(Reg reg)				{ return BYTE(0x40 | (reg << 3) | 7); }
+		void ByteRex(Reg reg)							{ if (reg >= 4) Emit({ 0x40 }); }	// sil instead of dh
+	};
+
+	// Translates the instructions of one block, stopping at the first it cannot
+	class BlockCompiler
+	{
+	public:
+		BlockCompiler(const DecodedBlock& block, const PageTable& pages)
+			: m_Block(block), m_Pages(pages) {}
+
+		const std::vector<BYTE>& Compile(uint32_t& compiled)
+		{
+			m_Asm.MovePointer(EDX, s_Flags.ZN);
+			m_Asm.Emit({ 0x49, 0x89, 0xD0 });	// mov r8, rdx
+			m_Start = m_Asm.GetPosition();
+
+			WORD next = m_Block.Instructions[0].Address;
+			compiled = 0;
+			for (const DecodedInstruction& instruction : m_Block.Instructions)
+			{
+				uint32_t position = m_Asm.GetPosition();
+				size_t exits = m_Exits.size();
+				if (!CompileInstruction(instruction))
+				{
+					m_Asm.Truncate(position);
+					m_Exits.resize(exits);
+					break;
+				}
+
+				compiled++;
+				next = instruction.Address + instruction.Program->Bytes;
+				if (m_Ended)
+					break;
+			}
+
+			if (!m_Ended)
+				ExitTo(next);
+
+			// Exits taken in the middle of the block
+			for (auto& [jump, PC] : m_Exits)
+			{
+				m_Asm.Bind(jump, m_Asm.GetPosition());
+				ExitTo(PC);
+			}
+			return m_Asm.Code;
+		}
+
+	private:
+		struct Target
+		{
+			const Page* First = nullptr;
+			const Page* Second = nullptr;	// Page an indexed access crosses into
+		};
+
+		void ExitTo(WORD PC)
+		{
+			m_Asm.StoreWordImm(CTX_PC, PC);
+			m_Asm.Return();
+		}
+
+		void JumpTo(WORD PC)
+		{
+			// Loops back to the start of the block stay in native code
+			if (PC == m_Block.Instructions[0].Address)
+				m_Asm.Bind(m_Asm.Jump(JMP), m_Start);
+			else
+				ExitTo(PC);
+		}
+
+		void SetBus(BYTE dataRead)
+		{
+			m_Asm.Store(CTX_DATA_BUS, EAX);
+			m_Asm.StoreImm(CTX_DATA_READ, dataRead);
+		}
+
+		void SetZN(Reg value, Reg temp)
+		{
+			m_Asm.AndImm(CTX_PS, 0x7D);
+			m_Asm.LookupFlags(temp, value);
+			m_Asm.Or(CTX_PS, temp);
+		}
+
+		bool IsUsable(const Page& page, AccessClass access) const
+		{
+			// The pointer into a bank is only kept while the block's own pages are unchanged
+			if (page.IsBanked && std::find(m_Block.Pages.begin(), m_Block.Pages.begin() + m_Block.PageCount, page.Generation) == m_Block.Pages.begin() + m_Block.PageCount)
+				return false;
+
+			return access == AccessClass::Read ? page.Data != nullptr : page.WritableData != nullptr;
+		}
+
+		// Emits the effective address into rdx and AddressBus
+		bool CompileAddress(AddressingMode mode, const DecodedInstruction& instruction, AccessClass access, Target& target)
+		{
+			BYTE low = instruction.Operand[0];
+			WORD absolute = ((WORD)instruction.Operand[1] << 8) | low;
+
+			switch (mode)
+			{
+				case AddressingMode::ZeroPage:
+				case AddressingMode::Absolute:
+				{
+					WORD address = mode == AddressingMode::ZeroPage ? low : absolute;
+					target.First = &m_Pages.GetPage(address);
+					if (!IsUsable(*target.First, access))
+						return false;
+
+					m_Asm.StoreWordImm(CTX_ADDRESS_BUS, address);
+					m_Asm.MovePointer(EDX, target.First->Data + (address & 0xFF));
+				} break;
+				case AddressingMode::ZeroPageX:
+				case AddressingMode::ZeroPageY:
+				{
+					target.First = &m_Pages.GetPage(0x0000);
+					if (!IsUsable(*target.First, access))
+						return false;
+
+					m_Asm.Load(ECX, mode == AddressingMode::ZeroPageX ? CTX_X : CTX_Y);
+					m_Asm.AddImm(ECX, low);
+					m_Asm.AndRegImm(ECX, 0xFF);
+					m_Asm.StoreWord(CTX_ADDRESS_BUS, ECX);
+					m_Asm.MovePointer(EDX, target.First->Data);
+					m_Asm.HostAddress();
+				} break;
+				case AddressingMode::AbsoluteX:
+				case AddressingMode::AbsoluteY:
+				{
+					// Both pages the index can reach must be one run of host memory
+					WORD base = absolute & 0xFF00;
+					if (base == 0xFF00)
+						return false;
+
+					target.First = &m_Pages.GetPage(base);
+					target.Second = &m_Pages.GetPage(base + PAGE_SIZE);
+					if (!IsUsable(*target.First, access) || !IsUsable(*target.Second, access)
+						|| target.Second->Data != target.First->Data + PAGE_SIZE
+						|| target.Second->Generation != target.First->Generation + 1)
+						return false;
+
+					m_Asm.Load(ECX, mode == AddressingMode::AbsoluteX ? CTX_X : CTX_Y);
+					m_Asm.AddImm(ECX, low);
+					m_Asm.Move(EAX, ECX);
+					m_Asm.AddImm(EAX, base);
+					m_Asm.StoreWord(CTX_ADDRESS_BUS, EAX);
+
+					// Reads spend the page cross cycle only when crossing
+					if (access == AccessClass::Read)
+					{
+						m_Asm.Move(EAX, ECX);
+						m_Asm.ShiftRight(EAX, 8);
+						m_Asm.AddCycles(EAX);
+					}
+					m_Asm.MovePointer(EDX, target.First->Data);
+					m_Asm.HostAddress();
+				} break;
+				default:
+					return false;
+			}
+			return true;
+		}
+
+		// Emits the stack address pushed to or pulled from into rdx and AddressBus
+		bool CompileStackAddress(bool push, Target& target)
+		{
+			target.First = &m_Pages.GetPage(0x0100);
+			if (!IsUsable(*target.First, push ? AccessClass::Write : AccessClass::Read))
+				return false;
+
+			m_Asm.Load(ECX, CTX_SP);
+			if (!push)
+			{
+				m_Asm.AddImm(ECX, 1);
+				m_Asm.AndRegImm(ECX, 0xFF);
+				m_Asm.Store(CTX_SP, ECX);
+			}
+			m_Asm.Move(EAX, ECX);
+			m_Asm.OrRegImm(EAX, 0x100);
+			m_Asm.StoreWord(CTX_ADDRESS_BUS, EAX);
+			m_Asm.MovePointer(EDX, target.First->Data);
+			m_Asm.HostAddress();
+			return true;
+		}
+
+		// Bumps the write counter of the page written and leaves if it holds this block
+		void CompileWrite(const Target& target, AddressingMode mode, WORD next)
+		{
+			if (target.Second != nullptr)
+			{
+				m_Asm.Load(EAX, mode == AddressingMode::AbsoluteX ? CTX_X : CTX_Y);
+				m_Asm.AddImm(EAX, m_CurrentLow);
+				m_Asm.ShiftRight(EAX, 8);
+				m_Asm.IncrementCounter(target.First->Generation, EAX);
+			}
+			else
+			{
+				m_Asm.IncrementCounter(target.First->Generation);
+			}
+
+			for (uint32_t i = 0; i < m_Block.PageCount; i++)
+			{
+				if (m_Block.Pages[i] != target.First->Generation && (target.Second == nullptr || m_Block.Pages[i] != target.Second->Generation))
+					continue;
+
+				m_Asm.CompareCounter(m_Block.Pages[i], m_Block.Generations[i]);
+				m_Exits.push_back({ m_Asm.Jump(JNE), next });
+			}
+		}
+
+		// The operation on a value read into eax, with rdx still addressing it
+		bool CompileRead(Operation op)
+		{
+			switch (op)
+			{
+				case Operation::LDA: case Operation::LDX: case Operation::LDY:
+				{
+					m_Asm.Store(op == Operation::LDA ? CTX_A : (op == Operation::LDX ? CTX_X : CTX_Y), EAX);
+					SetZN(EAX, ECX);
+				} break;
+				case Operation::AND: case Operation::ORA: case Operation::EOR:
+				{
+					m_Asm.Load(ECX, CTX_A);
+					m_Asm.Op(op == Operation::AND ? 0x21 : (op == Operation::ORA ? 0x09 : 0x31), ECX, EAX);
+					m_Asm.Store(CTX_A, ECX);
+					SetZN(ECX, EDX);
+				} break;
+				case Operation::ADC:
+				case Operation::SBC:
+				{
+					// Index of the ALU tables, see ALU::GetArithmeticIndex
+					m_Asm.Load(ECX, CTX_PS);
+					m_Asm.Move(EDX, ECX);
+					m_Asm.AndRegImm(ECX, 0x01);
+					m_Asm.ShiftLeft(ECX, 16);
+					m_Asm.AndRegImm(EDX, 0x08);
+					m_Asm.ShiftLeft(EDX, 14);
+					m_Asm.OrReg(ECX, EDX);
+					m_Asm.Load(EDX, CTX_A);
+					m_Asm.ShiftLeft(EDX, 8);
+					m_Asm.OrReg(ECX, EDX);
+					m_Asm.OrReg(ECX, EAX);
+
+					m_Asm.MovePointer(ESI, op == Operation::ADC ? ALU::GetAddTable() : ALU::GetSubTable());
+					m_Asm.LookupWord(ECX, ECX);
+					m_Asm.Store(CTX_A, ECX);
+					m_Asm.ShiftRight(ECX, 8);
+					m_Asm.AndImm(CTX_PS, BYTE(~ARITHMETIC_FLAGS));
+					m_Asm.Or(CTX_PS, ECX);
+				} break;
+				case Operation::CMP: case Operation::CPX: case Operation::CPY:
+				{
+					m_Asm.Load(ECX, op == Operation::CMP ? CTX_A : (op == Operation::CPX ? CTX_X : CTX_Y));
+					m_Asm.Sub(ECX, EAX);
+					m_Asm.Move(EDX, ECX);
+					m_Asm.ShiftRight(EDX, 8);
+					m_Asm.AndRegImm(EDX, 0x01);
+					m_Asm.AndImm(CTX_PS, 0xFE);
+					m_Asm.Or(CTX_PS, EDX);
+					m_Asm.AndRegImm(ECX, 0xFF);
+					SetZN(ECX, EDX);
+				} break;
+				case Operation::BIT:
+				{
+					m_Asm.Load(ECX, CTX_A);
+					m_Asm.AndReg(ECX, EAX);
+					m_Asm.AndImm(CTX_PS, 0x3D);
+					m_Asm.AndRegImm(EAX, 0xC0);
+					m_Asm.Or(CTX_PS, EAX);
+					m_Asm.LookupFlags(EDX, ECX);
+					m_Asm.AndRegImm(EDX, 0x02);
+					m_Asm.Or(CTX_PS, EDX);
+				} break;
+				case Operation::NOP:
+					break;
+				default:
+					return false;
+			}
+			return true;
+		}
+
+		// Shifts, increments and decrements of the value in eax, rdx must be left alone
+		bool CompileModify(Operation op)
+		{
+			switch (op)
+			{
+				case Operation::ASL:
+				case Operation::ROL:
+				{
+					if (op == Operation::ROL)
+					{
+						m_Asm.Load(ESI, CTX_PS);
+						m_Asm.AndRegImm(ESI, 0x01);
+					}
+					m_Asm.Move(ECX, EAX);
+					m_Asm.ShiftRight(ECX, 7);
+					m_Asm.ShiftLeft(EAX, 1);
+					if (op == Operation::ROL)
+						m_Asm.OrReg(EAX, ESI);
+					m_Asm.AndRegImm(EAX, 0xFF);
+				} break;
+				case Operation::LSR:
+				case Operation::ROR:
+				{
+					if (op == Operation::ROR)
+					{
+						m_Asm.Load(ESI, CTX_PS);
+						m_Asm.AndRegImm(ESI, 0x01);
+						m_Asm.ShiftLeft(ESI, 7);
+					}
+					m_Asm.Move(ECX, EAX);
+					m_Asm.AndRegImm(ECX, 0x01);
+					m_Asm.ShiftRight(EAX, 1);
+					if (op == Operation::ROR)
+						m_Asm.OrReg(EAX, ESI);
+				} break;
+				case Operation::INC:
+				case Operation::DEC:
+				{
+					if (op == Operation::INC)
+						m_Asm.AddImm(EAX, 1);
+					else
+						m_Asm.SubImm(EAX, 1);
+					m_Asm.AndRegImm(EAX, 0xFF);
+					SetZN(EAX, ESI);
+					return true;
+				}
+				default:
+					return false;
+			}
+
+			m_Asm.AndImm(CTX_PS, 0xFE);
+			m_Asm.Or(CTX_PS, ECX);
+			SetZN(EAX, ESI);
+			return true;
+		}
+
+		bool CompileImplied(Operation op)
+		{
+			auto transfer = [this](BYTE from, BYTE to, bool flags)
+			{
+				m_Asm.Load(EAX, from);
+				m_Asm.Store(to, EAX);
+				if (flags)
+					SetZN(EAX, ECX);
+			};
+			auto step = [this](BYTE reg, bool increment)
+			{
+				m_Asm.Load(EAX, reg);
+				if (increment)
+					m_Asm.AddImm(EAX, 1);
+				else
+					m_Asm.SubImm(EAX, 1);
+				m_Asm.AndRegImm(EAX, 0xFF);
+				m_Asm.Store(reg, EAX);
+				SetZN(EAX, ECX);
+			};
+
+			switch (op)
+			{
+				case Operation::TAX: transfer(CTX_A, CTX_X, true); break;
+				case Operation::TAY: transfer(CTX_A, CTX_Y, true); break;
+				case Operation::TSX: transfer(CTX_SP, CTX_X, true); break;
+				case Operation::TXA: transfer(CTX_X, CTX_A, true); break;
+				case Operation::TXS: transfer(CTX_X, CTX_SP, false); break;
+				case Operation::TYA: transfer(CTX_Y, CTX_A, true); break;
+
+				case Operation::DEX: step(CTX_X, false); break;
+				case Operation::INX: step(CTX_X, true); break;
+				case Operation::DEY: step(CTX_Y, false); break;
+				case Operation::INY: step(CTX_Y, true); break;
+
+				case Operation::CLC: m_Asm.AndImm(CTX_PS, 0xFE); break;
+				case Operation::CLD: m_Asm.AndImm(CTX_PS, 0xF7); break;
+				case Operation::CLI: m_Asm.AndImm(CTX_PS, 0xFB); break;
+				case Operation::CLV: m_Asm.AndImm(CTX_PS, 0xBF); break;
+				case Operation::SEC: m_Asm.OrImm(CTX_PS, 0x01); break;
+				case Operation::SED: m_Asm.OrImm(CTX_PS, 0x08); break;
+				case Operation::SEI: m_Asm.OrImm(CTX_PS, 0x04); break;
+
+				case Operation::NOP: break;
+				default:
+					return false;
+			}
+			return true;
+		}
+
+		bool CompileBranch(const DecodedInstruction& instruction)
+		{
+			BYTE flag = 0;
+			bool whenSet = false;
+			switch (instruction.Program->Op)
+			{
+				case Operation::BCC: flag = 0x01; whenSet = false; break;
+				case Operation::BCS: flag = 0x01; whenSet = true; break;
+				case Operation::BNE: flag = 0x02; whenSet = false; break;
+				case Operation::BEQ: flag = 0x02; whenSet = true; break;
+				case Operation::BPL: flag = 0x80; whenSet = false; break;
+				case Operation::BMI: flag = 0x80; whenSet = true; break;
+				case Operation::BVC: flag = 0x40; whenSet = false; break;
+				case Operation::BVS: flag = 0x40; whenSet = true; break;
+				default: return false;
+			}
+
+			WORD next = instruction.Address + 2;
+			WORD target = next + (int8_t)instruction.Operand[0];
+
+			m_Asm.StoreImm(CTX_DATA_BUS, instruction.Operand[0]);
+			m_Asm.StoreImm(CTX_DATA_READ, 1);
+			m_Asm.TestImm(CTX_PS, flag);
+			uint32_t taken = m_Asm.Jump(whenSet ? JNE : JE);
+
+			m_Asm.StoreWordImm(CTX_ADDRESS_BUS, WORD(instruction.Address + 1));
+			m_Asm.AddCycles(2);
+			ExitTo(next);
+
+			m_Asm.Bind(taken, m_Asm.GetPosition());
+			m_Asm.StoreWordImm(CTX_ADDRESS_BUS, target);
+			m_Asm.AddCycles((next >> 8) == (target >> 8) ? 3 : 4);
+			JumpTo(target);
+
+			m_Ended = true;
+			return true;
+		}
+
+		bool CompileInstruction(const DecodedInstruction& instruction)
+		{
+			const MicroProgram& program = *instruction.Program;
+			const OpcodeInfo& info = MicroCode::GetInfo(instruction.Opcode);
+			bool stack = info.Op == Operation::PHA || info.Op == Operation::PHP || info.Op == Operation::PLA || info.Op == Operation::PLP;
+
+			// Interrupts, subroutines and indirect addressing are left to the interpreter
+			switch (info.Op)
+			{
+				case Operation::None:
+				case Operation::BRK: case Operation::RTI: case Operation::JSR: case Operation::RTS:
+					return false;
+				default:
+					break;
+			}
+			if (info.Mode == AddressingMode::Indirect || info.Mode == AddressingMode::IndirectX || info.Mode == AddressingMode::IndirectY)
+				return false;
+
+			// The dummy read of implied instructions must not reach a device
+			WORD next = instruction.Address + program.Bytes;
+			const Page& nextPage = m_Pages.GetPage(instruction.Address + 1);
+			if (info.Mode == AddressingMode::Implied && !stack && !IsUsable(nextPage, AccessClass::Read))
+				return false;
+
+			m_Exits.push_back({ m_Asm.CheckCycles(program.Length + 1), instruction.Address });
+			m_CurrentLow = instruction.Operand[0];
+
+			switch (info.Op)
+			{
+				case Operation::PHA:
+				case Operation::PHP:
+				{
+					Target target;
+					if (!CompileStackAddress(true, target))
+						return false;
+
+					m_Asm.Load(EAX, info.Op == Operation::PHA ? CTX_A : CTX_PS);
+					m_Asm.StoreHost(EAX);
+					SetBus(0);
+					m_Asm.Load(ECX, CTX_SP);
+					m_Asm.SubImm(ECX, 1);
+					m_Asm.Store(CTX_SP, ECX);
+					m_Asm.AddCycles(program.Length + 1);
+					CompileWrite(target, info.Mode, next);
+					return true;
+				}
+				case Operation::PLA:
+				case Operation::PLP:
+				{
+					Target target;
+					if (!CompileStackAddress(false, target))
+						return false;
+
+					m_Asm.LoadHost(EAX);
+					SetBus(1);
+					if (info.Op == Operation::PLA)
+					{
+						m_Asm.Store(CTX_A, EAX);
+						SetZN(EAX, ECX);
+					}
+					else
+					{
+						m_Asm.Store(CTX_PS, EAX);
+					}
+					m_Asm.AddCycles(program.Length + 1);
+					return true;
+				}
+				case Operation::JMP:
+				{
+					WORD target = ((WORD)instruction.Operand[1] << 8) | instruction.Operand[0];
+					m_Asm.StoreWordImm(CTX_ADDRESS_BUS, WORD(instruction.Address + 2));
+					m_Asm.StoreImm(CTX_DATA_BUS, instruction.Operand[1]);
+					m_Asm.StoreImm(CTX_DATA_READ, 1);
+					m_Asm.AddCycles(program.Length + 1);
+					JumpTo(target);
+					m_Ended = true;
+					return true;
+				}
+				default:
+					break;
+			}
+
+			switch (info.Mode)
+			{
+				case AddressingMode::Implied:
+				{
+					m_Asm.StoreWordImm(CTX_ADDRESS_BUS, WORD(instruction.Address + 1));
+					m_Asm.MovePointer(EDX, nextPage.Data + ((instruction.Address + 1) & 0xFF));
+					m_Asm.LoadHost(EAX);
+					SetBus(1);
+					if (!CompileImplied(program.Op))
+						return false;
+					m_Asm.AddCycles(program.Length + 1);
+				} break;
+				case AddressingMode::Accumulator:
+				{
+					m_Asm.StoreWordImm(CTX_ADDRESS_BUS, instruction.Address);
+					m_Asm.StoreImm(CTX_DATA_BUS, instruction.Opcode);
+					m_Asm.StoreImm(CTX_DATA_READ, 1);
+					m_Asm.Load(EAX, CTX_A);
+					if (!CompileModify(program.Op))
+						return false;
+					m_Asm.Store(CTX_A, EAX);
+					m_Asm.AddCycles(program.Length + 1);
+				} break;
+				case AddressingMode::Immediate:
+				{
+					m_Asm.StoreWordImm(CTX_ADDRESS_BUS, WORD(instruction.Address + 1));
+					m_Asm.MoveImm(EAX, instruction.Operand[0]);
+					SetBus(1);
+					if (!CompileRead(program.Op))
+						return false;
+					m_Asm.AddCycles(program.Length + 1);
+				} break;
+				case AddressingMode::ZeroPage: case AddressingMode::ZeroPageX: case AddressingMode::ZeroPageY:
+				case AddressingMode::Absolute: case AddressingMode::AbsoluteX: case AddressingMode::AbsoluteY:
+				{
+					AccessClass access = info.Access;
+					Target target;
+					if (access == AccessClass::None || !CompileAddress(info.Mode, instruction, access, target))
+						return false;
+
+					// Indexed reads add their page cross cycle on their own
+					bool indexedRead = (info.Mode == AddressingMode::AbsoluteX || info.Mode == AddressingMode::AbsoluteY) && access == AccessClass::Read;
+					m_Asm.AddCycles(indexedRead ? program.Length : program.Length + 1);
+
+					if (access == AccessClass::Read)
+					{
+						m_Asm.LoadHost(EAX);
+						SetBus(1);
+						if (!CompileRead(program.Op))
+							return false;
+					}
+					else if (access == AccessClass::Write)
+					{
+						m_Asm.Load(EAX, program.Op == Operation::STA ? CTX_A : (program.Op == Operation::STX ? CTX_X : CTX_Y));
+						m_Asm.StoreHost(EAX);
+						SetBus(0);
+						CompileWrite(target, info.Mode, next);
+					}
+					else
+					{
+						m_Asm.LoadHost(EAX);
+						if (!CompileModify(program.Op))
+							return false;
+						m_Asm.StoreHost(EAX);
+						SetBus(0);
+						CompileWrite(target, info.Mode, next);
+					}
+				} break;
+				case AddressingMode::Relative:
+					return CompileBranch(instruction);
+				default:
+					return false;
+			}
+			return true;
+		}
+
+		const DecodedBlock& m_Block;
+		const PageTable& m_Pages;
+		Assembler m_Asm;
+		uint32_t m_Start = 0;
+		BYTE m_CurrentLow = 0;
+		bool m_Ended = false;
+		std::vector<std::pair<uint32_t, WORD>> m_Exits;	// Jump to patch and PC to leave with
+	};
+}
+
+bool Jit::CompiledBlock::IsValid() const
+{
+	for (uint32_t i = 0; i < PageCount; i++)
+	{
+		if (*Pages[i] != Generations[i])
+			return false;
+	}
+	return true;
+}
+
+Jit::Jit()
+{
+#ifdef JIT_X86_64
+	void* arena = mmap(nullptr, JIT_ARENA_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (arena == MAP_FAILED)
+	{
+		LOG_WARN("Could not map the JIT arena, running interpreted.");
+		return;
+	}
+	m_Arena = (BYTE*)arena;
+
+	m_Entries.resize(64 * 1024, nullptr);
+	m_Heat.resize(64 * 1024, 0);
+#else
+	LOG_WARN("The JIT is only available on x86-64 Linux, running interpreted.");
+#endif
+}
+
+Jit::~Jit()
+{
+#ifdef JIT_X86_64
+	if (m_Arena != nullptr)
+		munmap(m_Arena, JIT_ARENA_SIZE);
+#endif
+}
+
+bool Jit::IsSupported()
+{
+#ifdef JIT_X86_64
+	return true;
+#else
+	return false;
+#endif
+}
+
+uint64_t Jit::Run(JitContext& context, BlockCache& cache, const PageTable& pages)
+{
+	if (m_Arena == nullptr)
+		return 0;
+
+	uint64_t start = context.Cycles;
+	while (context.Cycles < context.CycleLimit)
+	{
+		CompiledBlock* block = m_Entries[context.PC];
+		if (block != nullptr && !block->IsValid())
+		{
+			m_Invalidations++;
+			block = m_Entries[context.PC] = nullptr;
+			m_Heat[context.PC] = 0;
+		}
+
+		if (block == nullptr)
+		{
+			if (++m_Heat[context.PC] < JIT_HOT_THRESHOLD)
+				break;
+
+			m_Heat[context.PC] = 0;
+			const DecodedBlock* decoded = cache.Find(context.PC, pages);
+			if (decoded == nullptr)
+				break;
+
+			block = m_Entries[context.PC] = Compile(*decoded, pages);
+		}
+		if (block->Code == nullptr)
+			break;
+
+		uint64_t cycles = context.Cycles;
+		block->Code(&context);
+		m_CompiledRuns++;
+
+		// Not even the first instruction fit under the limit
+		if (context.Cycles == cycles)
+			break;
+	}
+	return context.Cycles - start;
+}
+
+void Jit::Clear()
+{
+	m_Blocks.clear();
+	std::fill(m_Entries.begin(), m_Entries.end(), nullptr);
+	std::fill(m_Heat.begin(), m_Heat.end(), 0);
+	m_ArenaUsed = 0;
+}
+
+Jit::CompiledBlock* Jit::Compile(const DecodedBlock& block, const PageTable& pages)
+{
+	uint32_t instructions = 0;
+	BlockCompiler compiler(block, pages);
+	const std::vector<BYTE>& code = compiler.Compile(instructions);
+
+	if (instructions > 0 && m_ArenaUsed + code.size() > JIT_ARENA_SIZE)
+	{
+		LOG_INFO("JIT arena full, dropping {0} compiled blocks", m_Blocks.size());
+		Clear();
+	}
+
+	auto compiled = std::make_unique<CompiledBlock>();
+	compiled->Pages = block.Pages;
+	compiled->Generations = block.Generations;
+	compiled->PageCount = block.PageCount;
+	if (instructions > 0)
+	{
+		std::memcpy(m_Arena + m_ArenaUsed, code.data(), code.size());
+		compiled->Code = (BlockFunction)(m_Arena + m_ArenaUsed);
+		m_ArenaUsed += (uint32_t)((code.size() + 15) & ~15);
+		m_CompiledBlocks++;
+	}
+
+	m_Blocks.push_back(std::move(compiled));
+	return m_Blocks.back().get();
+}
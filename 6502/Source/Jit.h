@@ -0,0 +1,81 @@
+#pragma once
+
+#include "ALU.h"
+#include "Base.h"
+#include "BlockCache.h"
+#include "PageTable.h"
+
+#include <memory>
+#include <vector>
+
+constexpr uint32_t JIT_ARENA_SIZE = 4 * 1024 * 1024;
+constexpr uint32_t JIT_HOT_THRESHOLD = 16;	// Runs of a block before it gets compiled
+
+// The CPU state compiled code works on, copied in and out around each run
+struct JitContext
+{
+	uint64_t Cycles = 0;
+	uint64_t CycleLimit = 0;	// No instruction is started that could end past it
+	WORD PC = 0;
+	WORD AddressBus = 0;
+	BYTE A = 0, X = 0, Y = 0;
+	BYTE SP = 0;
+	StatusFlags PS = {};
+	BYTE DataBus = 0;
+	BYTE DataRead = 0;
+};
+
+// Translates hot blocks into x86-64 code (Linux only) placed in an executable
+// arena. A compiled block runs whole instructions, ends with the CPU buses as
+// the last cycle of its last instruction left them, and counts the exact
+// cycles the interpreter would have.
+//
+// Only instructions whose memory accesses stay within pages backed by a single
+// memory are compiled, so devices never see an access out of their cycle. A
+// block is dropped when a page it was built from is written, and compiled code
+// storing into its own pages leaves right after the store.
+class Jit
+{
+public:
+	Jit();
+	~Jit();
+
+	static bool IsSupported();
+	inline bool IsAvailable() const { return m_Arena != nullptr; }
+
+	// Runs compiled blocks from context.PC until it reaches code that is not compiled or
+	// the cycle limit. Returns the number of cycles run.
+	uint64_t Run(JitContext& context, BlockCache& cache, const PageTable& pages);
+	// Must be called whenever the page table is remapped
+	void Clear();
+
+	inline uint64_t GetCompiledBlocks() const { return m_CompiledBlocks; }
+	inline uint64_t GetCompiledRuns() const { return m_CompiledRuns; }
+	inline uint64_t GetInvalidations() const { return m_Invalidations; }
+
+private:
+	using BlockFunction = void(*)(JitContext* context);
+
+	struct CompiledBlock
+	{
+		BlockFunction Code = nullptr;	// nullptr when the first instruction cannot be compiled
+		std::array<const uint32_t*, BLOCK_MAX_PAGES> Pages = {};
+		std::array<uint32_t, BLOCK_MAX_PAGES> Generations = {};
+		uint32_t PageCount = 0;
+
+		bool IsValid() const;
+	};
+
+	CompiledBlock* Compile(const DecodedBlock& block, const PageTable& pages);
+
+	BYTE* m_Arena = nullptr;
+	uint32_t m_ArenaUsed = 0;
+
+	std::vector<std::unique_ptr<CompiledBlock>> m_Blocks;
+	std::vector<CompiledBlock*> m_Entries;		// Compiled block per PC
+	std::vector<uint16_t> m_Heat;				// Runs per PC before compiling
+
+	uint64_t m_CompiledBlocks = 0;
+	uint64_t m_CompiledRuns = 0;
+	uint64_t m_Invalidations = 0;
+};
@@ -0,0 +1,188 @@
+#include "Lockstep.h"
+
+#include "Log.h"
+
+#include <algorithm>
+
+LockstepCPU::LockstepCPU(uint32_t lanes, uint32_t sizeSRAM, MemoryImage ROM)
+{
+	if (lanes == 0 || lanes > LOCKSTEP_MAX_LANES)
+	{
+		LOG_ERROR("A lockstep CPU runs 1 to {0} lanes, not {1}.", LOCKSTEP_MAX_LANES, lanes);
+		lanes = std::min(std::max(lanes, 1u), LOCKSTEP_MAX_LANES);
+	}
+	if (!ROM || ROM.GetSize() > LOCKSTEP_LANE_MEMORY)
+	{
+		LOG_ERROR("A lockstep CPU needs a ROM image of at most 64 KB.");
+		ROM = std::make_shared<std::vector<BYTE>>();
+	}
+
+	m_Lanes = lanes;
+	m_SizeSRAM = std::min(sizeSRAM, LOCKSTEP_LANE_MEMORY);
+	m_ROMStart = LOCKSTEP_LANE_MEMORY - ROM.GetSize();
+
+	// SRAM has priority where the two overlap, and starts out cleared
+	m_Memory.resize(m_Lanes * LOCKSTEP_LANE_MEMORY);
+	for (uint32_t lane = 0; lane < m_Lanes; lane++)
+	{
+		BYTE* memory = &m_Memory[lane * LOCKSTEP_LANE_MEMORY];
+		std::copy(ROM.GetData(), ROM.GetData() + ROM.GetSize(), memory + m_ROMStart);
+		std::fill(memory, memory + m_SizeSRAM, 0);
+	}
+
+	DataRead.fill(true);
+	Reset();
+}
+
+void LockstepCPU::Reset()
+{
+	m_Program.fill(&MicroCode::GetResetProgram());
+	m_Cycle.fill(0);
+
+	m_Groups[0] = m_Lanes == 32 ? 0xFFFFFFFF : (1u << m_Lanes) - 1;
+	m_GroupCount = 1;
+}
+
+void LockstepCPU::RunCycles(uint64_t quantity)
+{
+	for (uint64_t cycle = 0; cycle < quantity; cycle++)
+	{
+		for (uint32_t lane = 0; lane < m_Lanes; lane++)
+			Cycles[lane]++;
+
+		// Groups split off this cycle are already a cycle ahead, they run from the next one
+		uint32_t groups = m_GroupCount;
+		for (uint32_t group = 0; group < groups; group++)
+			RunGroup(group);
+		MergeGroups();
+
+		m_GroupsRun += groups;
+		m_CyclesRun++;
+	}
+}
+
+void LockstepCPU::InterruptNMI(uint32_t lane)
+{
+	NMI[lane] = true;
+}
+
+void LockstepCPU::InterruptIRQ(uint32_t lane)
+{
+	if (PS[lane].Bits.I == 1)
+		return;
+
+	IRQ[lane] = true;
+}
+
+LockstepCPU::Lane::Lane(LockstepCPU& lockstep, uint32_t index)
+	: Lockstep(lockstep), Index(index),
+	PC(lockstep.PC[index]), SP(lockstep.SP[index]), PS(lockstep.PS[index]),
+	A(lockstep.A[index]), X(lockstep.X[index]), Y(lockstep.Y[index]),
+	AddressBus(lockstep.AddressBus[index]), DataBus(lockstep.DataBus[index]), DataRead(lockstep.DataRead[index]),
+	NMI(lockstep.NMI[index]), IRQ(lockstep.IRQ[index]),
+	m_BAL(lockstep.m_BAL[index]), m_BAH(lockstep.m_BAH[index]),
+	m_ADL(lockstep.m_ADL[index]), m_ADH(lockstep.m_ADH[index]),
+	m_IAL(lockstep.m_IAL[index]), m_IAH(lockstep.m_IAH[index])
+{
+}
+
+template<MicroOp Op>
+void LockstepCPU::RunMicroOp(uint32_t mask, Operation operation)
+{
+	ForEachLane(mask, [this, operation](uint32_t index)
+	{
+		m_Cycle[index]++;
+		Lane lane(*this, index);
+		MicroOps<Lane>::Run(lane, Op, operation);
+	});
+}
+
+template<size_t... Op>
+constexpr std::array<LockstepCPU::GroupHandler, MICRO_OP_COUNT> LockstepCPU::MakeHandlers(std::index_sequence<Op...>)
+{
+	return { &LockstepCPU::RunMicroOp<(MicroOp)Op>... };
+}
+
+const std::array<LockstepCPU::GroupHandler, MICRO_OP_COUNT> LockstepCPU::s_Handlers = LockstepCPU::MakeHandlers(std::make_index_sequence<MICRO_OP_COUNT>{});
+
+void LockstepCPU::RunGroup(uint32_t group)
+{
+	uint32_t mask = m_Groups[group];
+	uint32_t first = GetFirstLane(mask);
+
+	if (IsInstructionComplete(first))
+	{
+		ForEachLane(mask, [this](uint32_t lane) { LoadInstruction(lane); });
+		SplitGroup(group);
+		return;
+	}
+
+	m_Ended = 0;
+	const MicroProgram& program = *m_Program[first];
+	(this->*s_Handlers[(size_t)program.Cycles[m_Cycle[first]]])(mask, program.Op);
+
+	// Lanes that ended their instruction early wait for the next fetch on their own
+	if (m_Ended != 0 && m_Ended != mask)
+	{
+		m_Groups[group] = mask & ~m_Ended;
+		m_Groups[m_GroupCount++] = m_Ended;
+	}
+}
+
+void LockstepCPU::SplitGroup(uint32_t group)
+{
+	// Lanes that fetched another opcode, or an interrupt, leave the group
+	uint32_t first = GetFirstLane(m_Groups[group]);
+	uint32_t rest = 0;
+	ForEachLane(m_Groups[group], [this, first, &rest](uint32_t lane)
+	{
+		if (!IsSameStep(lane, first))
+			rest |= 1u << lane;
+	});
+	m_Groups[group] &= ~rest;
+
+	while (rest != 0)
+	{
+		uint32_t lead = GetFirstLane(rest);
+		uint32_t split = 0;
+		ForEachLane(rest, [this, lead, &split](uint32_t lane)
+		{
+			if (IsSameStep(lane, lead))
+				split |= 1u << lane;
+		});
+		rest &= ~split;
+		m_Groups[m_GroupCount++] = split;
+	}
+}
+
+void LockstepCPU::MergeGroups()
+{
+	// Lanes only meet again at a fetch: at the same step of the same program, they fetched together
+	uint32_t fetch = LOCKSTEP_MAX_LANES;
+	for (uint32_t group = 0; group < m_GroupCount; group++)
+	{
+		if (!IsInstructionComplete(GetFirstLane(m_Groups[group])))
+			continue;
+
+		if (fetch == LOCKSTEP_MAX_LANES)
+		{
+			fetch = group;
+			continue;
+		}
+		m_Groups[fetch] |= m_Groups[group];
+		m_Groups[group--] = m_Groups[--m_GroupCount];
+	}
+}
+
+void LockstepCPU::LoadInstruction(uint32_t lane)
+{
+	if (NMI[lane] || IRQ[lane])
+		AddressBus[lane] = 0x00;
+	else
+		AddressBus[lane] = PC[lane]++;
+
+	SetDataBusFromMemory(lane);
+
+	m_Program[lane] = &MicroCode::GetProgram(DataBus[lane]);
+	m_Cycle[lane] = 0;
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include "ALU.h"
+#include "Base.h"
+#include "Memory.h"
+#include "MicroCode.h"
+#include "MicroOps.h"
+
+#include <array>
+#include <utility>
+#include <vector>
+
+constexpr uint32_t LOCKSTEP_MAX_LANES = 32;
+constexpr uint32_t LOCKSTEP_LANE_MEMORY = 64 * 1024;
+
+template<typename T>
+using LaneArray = std::array<T, LOCKSTEP_MAX_LANES>;
+
+// Runs up to 32 CPUs on the same ROM side by side, one cycle at a time. The
+// registers are kept per lane in struct-of-arrays form. Lanes at the same micro-op
+// of the same program form a group, a mask of lanes kept from cycle to cycle: its
+// micro-op is dispatched once and run over the lanes of the mask. Lanes split off
+// when they fetch another opcode or end an instruction early (a branch not taken,
+// no page crossed), and the groups done with their instruction merge to fetch.
+//
+// The micro-ops are the MicroOps the CPU runs, so every lane matches a CPU with
+// the same memory layout bus cycle for bus cycle. Each lane has its own flat copy
+// of the address space; there are no devices.
+class LockstepCPU
+{
+public:
+	LaneArray<WORD> PC = {};
+	LaneArray<BYTE> SP = {};
+	LaneArray<StatusFlags> PS = {};
+	LaneArray<BYTE> A = {}, X = {}, Y = {};
+
+	LaneArray<WORD> AddressBus = {};
+	LaneArray<BYTE> DataBus = {};
+	LaneArray<bool> DataRead = {};
+	LaneArray<bool> NMI = {};
+	LaneArray<bool> IRQ = {};
+
+	LaneArray<uint64_t> Cycles = {};
+
+private:
+	// One lane seen as a core of MicroOps, with the register names of the CPU
+	struct Lane
+	{
+		LockstepCPU& Lockstep;
+		uint32_t Index;
+
+		WORD& PC;
+		BYTE& SP;
+		StatusFlags& PS;
+		BYTE& A;
+		BYTE& X;
+		BYTE& Y;
+		WORD& AddressBus;
+		BYTE& DataBus;
+		bool& DataRead;
+		bool& NMI;
+		bool& IRQ;
+		BYTE& m_BAL;
+		BYTE& m_BAH;
+		BYTE& m_ADL;
+		BYTE& m_ADH;
+		BYTE& m_IAL;
+		BYTE& m_IAH;
+
+		Lane(LockstepCPU& lockstep, uint32_t index);
+
+		inline void SetDataBusFromMemory() { Lockstep.SetDataBusFromMemory(Index); }
+		inline void WriteMemoryFromDataBus() { Lockstep.WriteMemoryFromDataBus(Index); }
+		inline void FetchOperand(BYTE& destination) { AddressBus = PC++; SetDataBusFromMemory(); destination = DataBus; }
+		inline void EndInstruction() { Lockstep.EndInstruction(Index); }
+
+		// The flags are set as the operations run
+		inline void SetZN(BYTE value) { ALU::SetZN(PS, value); }
+		inline void SyncFlags() {}
+		inline void DiscardFlags() {}
+	};
+
+	LaneArray<BYTE> m_BAL = {}, m_BAH = {};
+	LaneArray<BYTE> m_ADL = {}, m_ADH = {};
+	LaneArray<BYTE> m_IAL = {}, m_IAH = {};
+
+	LaneArray<const MicroProgram*> m_Program = {};
+	LaneArray<BYTE> m_Cycle = {};
+
+	LaneArray<uint32_t> m_Groups = {};	// Lane masks
+	uint32_t m_GroupCount = 0;
+	uint32_t m_Ended = 0;				// Lanes that ended their instruction early
+
+	uint32_t m_Lanes = 0;
+	uint32_t m_SizeSRAM = 0;
+	uint32_t m_ROMStart = LOCKSTEP_LANE_MEMORY;
+	std::vector<BYTE> m_Memory;		// The address space of every lane, one after the other
+
+	uint64_t m_CyclesRun = 0;
+	uint64_t m_GroupsRun = 0;
+
+public:
+	// Lays the memory out like a computer with the same SRAM and EEPROM sizes
+	LockstepCPU(uint32_t lanes, uint32_t sizeSRAM, MemoryImage ROM);
+	~LockstepCPU() = default;
+
+	void Reset();
+	void RunCycles(uint64_t quantity);
+
+	void InterruptNMI(uint32_t lane);
+	void InterruptIRQ(uint32_t lane);
+
+	// Reads and writes a lane's memory without driving its buses
+	inline BYTE ReadByte(uint32_t lane, WORD address) const { return m_Memory[lane * LOCKSTEP_LANE_MEMORY + address]; }
+	inline void WriteByte(uint32_t lane, WORD address, BYTE value) { m_Memory[lane * LOCKSTEP_LANE_MEMORY + address] = value; }
+
+	inline uint32_t GetLaneCount() const { return m_Lanes; }
+	inline bool IsInstructionComplete(uint32_t lane) const { return m_Cycle[lane] >= m_Program[lane]->Length; }
+	// Groups dispatched per cycle, 1 while every lane is in lockstep
+	inline double GetAverageGroups() const { return m_CyclesRun != 0 ? (double)m_GroupsRun / m_CyclesRun : 0; }
+
+private:
+	inline bool IsAddressMapped(WORD address) const { return address < m_SizeSRAM || address >= m_ROMStart; }
+	inline void SetDataBusFromMemory(uint32_t lane)
+	{
+		if (!IsAddressMapped(AddressBus[lane]))
+			return;	// Nothing drives the data bus
+
+		DataBus[lane] = ReadByte(lane, AddressBus[lane]);
+		DataRead[lane] = true;
+	}
+	inline void WriteMemoryFromDataBus(uint32_t lane)
+	{
+		if (!IsAddressMapped(AddressBus[lane]))
+			return;
+
+		// The ROM is write-protected, as on a computer
+		if (AddressBus[lane] < m_SizeSRAM)
+			WriteByte(lane, AddressBus[lane], DataBus[lane]);
+		DataRead[lane] = false;
+	}
+
+	// Runs over the lanes in order up to the last one in the mask, skipping those outside it
+	template<typename Function>
+	static inline void ForEachLane(uint32_t mask, Function function)
+	{
+		for (uint32_t lane = 0; mask != 0; lane++, mask >>= 1)
+		{
+			if (mask & 1)
+				function(lane);
+		}
+	}
+	static inline uint32_t GetFirstLane(uint32_t mask)
+	{
+		uint32_t lane = 0;
+		while (!(mask & (1u << lane)))
+			lane++;
+		return lane;
+	}
+	// Lanes done with their instruction all fetch next, whatever they ran
+	inline bool IsSameStep(uint32_t lane, uint32_t other) const
+	{
+		if (IsInstructionComplete(lane) || IsInstructionComplete(other))
+			return IsInstructionComplete(lane) && IsInstructionComplete(other);
+		return m_Program[lane] == m_Program[other] && m_Cycle[lane] == m_Cycle[other];
+	}
+
+	void RunGroup(uint32_t group);
+	void SplitGroup(uint32_t group);
+	void MergeGroups();
+	void LoadInstruction(uint32_t lane);
+	inline void EndInstruction(uint32_t lane)
+	{
+		m_Cycle[lane] = m_Program[lane]->Length;
+		m_Ended |= 1u << lane;
+	}
+
+	// One handler per micro-op, each running it over the lanes of a group
+	using GroupHandler = void (LockstepCPU::*)(uint32_t, Operation);
+	template<MicroOp Op>
+	void RunMicroOp(uint32_t mask, Operation operation);
+	template<size_t... Op>
+	static constexpr std::array<GroupHandler, MICRO_OP_COUNT> MakeHandlers(std::index_sequence<Op...>);
+	static const std::array<GroupHandler, MICRO_OP_COUNT> s_Handlers;
+};
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Base.h"
+
 #include "spdlog/spdlog.h"
 #include "spdlog/fmt/ostr.h"
 #include "spdlog/sinks/stdout_color_sinks.h"
@@ -38,4 +40,9 @@ private:
 #define LOG_ERROR(...)		::Log::GetLogger()->error(__VA_ARGS__)
 #define LOG_CRITICAL(...)	::Log::GetLogger()->critical(__VA_ARGS__)
 
-#define PRINT_CPU(...)		::Log::GetCpuLogger()->trace(__VA_ARGS__)
\ No newline at end of file
+// The arguments are only formatted when the CPU logger is enabled, Distribution builds drop them entirely
+#ifdef DISTRIBUTION_6502
+	#define PRINT_CPU(...)
+#else
+	#define PRINT_CPU(...)		do { if (::Log::GetCpuLogger()->should_log(spdlog::level::trace)) ::Log::GetCpuLogger()->trace(__VA_ARGS__); } while (0)
+#endif
\ No newline at end of file
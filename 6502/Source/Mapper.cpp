@@ -0,0 +1,45 @@
+#include "Mapper.h"
+
+#include "Log.h"
+#include "PageTable.h"
+
+#include <algorithm>
+
+Mapper::Mapper(WORD first, uint32_t size, uint32_t banks, bool isROM)
+{
+	uint32_t end = std::min<uint32_t>((first + size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1), 64 * 1024);
+	m_First = first & ~(PAGE_SIZE - 1);
+	m_Size = end - m_First;
+	if (m_First != first || m_Size != size)
+		LOG_WARN("Mapper window rounded out to {0} -> {1}", Log::WordToHexString(m_First), Log::WordToHexString((WORD)(end - 1)));
+
+	if (banks == 0)
+	{
+		LOG_ERROR("A mapper needs at least one bank.");
+		banks = 1;
+	}
+
+	m_Banks.reserve(banks);
+	for (uint32_t i = 0; i < banks; i++)
+		m_Banks.push_back(std::make_unique<Memory>(m_Size, m_First, isROM));
+}
+
+void Mapper::Select(uint32_t bank)
+{
+	if (bank >= m_Banks.size())
+	{
+		LOG_ERROR("Bank {0} is out of range, the mapper has {1}", bank, m_Banks.size());
+		return;
+	}
+	if (bank == m_Selected)
+		return;
+
+	// Code decoded from the outgoing bank must not be taken for the incoming one
+	Memory* outgoing = GetSelectedMemory();
+	for (uint32_t offset = 0; offset < m_Size; offset += PAGE_SIZE)
+		(*outgoing->GetPageGeneration((WORD)(m_First + offset)))++;
+
+	m_Selected = bank;
+	if (m_Pages != nullptr)
+		m_Pages->MapWindow(this);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Base.h"
+#include "Device.h"
+#include "Memory.h"
+
+#include <memory>
+#include <vector>
+
+constexpr uint32_t MAX_MAPPERS = 8;	// Per computer, so snapshots can hold their banks
+
+class PageTable;
+
+// Switches which of its banks backs a window of the address space, as the bank
+// registers of a board do. Banks are memories of the window's size and address,
+// loaded and read like SRAM and EEPROM, and windows take priority over both.
+// Switching points the pages of the window at the new bank without copying.
+//
+// As a device the mapper is its own bank register: writes select the bank (modulo
+// the bank count) and reads give it back. Other devices can drive Select directly.
+class Mapper : public Device
+{
+public:
+	// The window is rounded out to whole pages
+	Mapper(WORD first, uint32_t size, uint32_t banks, bool isROM);
+	~Mapper() = default;
+
+	void Select(uint32_t bank);
+
+	inline uint32_t GetSelectedBank() const { return m_Selected; }
+	inline uint32_t GetBankCount() const { return (uint32_t)m_Banks.size(); }
+	inline Memory* GetBank(uint32_t bank) { return m_Banks[bank].get(); }
+	inline Memory* GetSelectedMemory() const { return m_Banks[m_Selected].get(); }
+
+	inline WORD GetFirst() const { return m_First; }
+	inline uint32_t GetSize() const { return m_Size; }
+	inline bool IsInWindow(WORD address) const { return (uint32_t)address - m_First < m_Size; }
+
+	BYTE Read(WORD) override { return (BYTE)m_Selected; }
+	void Write(WORD, BYTE value) override { Select(value % GetBankCount()); }
+
+private:
+	friend class PageTable;
+
+	WORD m_First = 0;
+	uint32_t m_Size = 0;
+	std::vector<std::unique_ptr<Memory>> m_Banks;
+	uint32_t m_Selected = 0;
+	PageTable* m_Pages = nullptr;	// The page table the window is mapped in, if any
+};
@@ -2,8 +2,76 @@
 
 #include "Log.h"
 
+#include <algorithm>
 #include <fstream>
 
+#if defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+MemoryImage MemoryImage::Map(const char* filepath)
+{
+	MemoryImage image;
+
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return image;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0 || fileSize.QuadPart > UINT32_MAX)
+	{
+		CloseHandle(file);
+		return image;
+	}
+
+	// The view keeps the mapping open once both handles are closed
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (mapping == nullptr)
+		return image;
+	void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (data == nullptr)
+		return image;
+
+	uint32_t size = (uint32_t)fileSize.QuadPart;
+	image.m_Owner = std::shared_ptr<const void>(data, [](const void* data) { UnmapViewOfFile(data); });
+#else
+	int file = open(filepath, O_RDONLY);
+	if (file < 0)
+		return image;
+
+	struct stat status;
+	if (fstat(file, &status) != 0 || status.st_size == 0 || (uint64_t)status.st_size > UINT32_MAX)
+	{
+		close(file);
+		return image;
+	}
+
+	// The mapping stays valid once the file is closed
+	uint32_t size = (uint32_t)status.st_size;
+	void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (data == MAP_FAILED)
+		return image;
+
+	image.m_Owner = std::shared_ptr<const void>(data, [size](const void* data) { munmap(const_cast<void*>(data), size); });
+#endif
+
+	image.m_Data = (const BYTE*)data;
+	image.m_Size = size;
+	image.m_IsMapped = true;
+	return image;
+}
+
 Memory::Memory(uint32_t size, WORD zeroAddress, bool isROM)
 	: m_Size(size), m_ZeroAddress(zeroAddress), m_IsROM(isROM)
 {
@@ -12,12 +80,13 @@ Memory::Memory(uint32_t size, WORD zeroAddress, bool isROM)
 
 Memory::~Memory()
 { 
-	delete m_Data;
 }
 
 void Memory::Reset()
 {
-	m_Data = new std::vector<BYTE>(m_Size);
+	m_Image = nullptr;
+	m_Data.assign(m_Size, 0);
+	m_Generation++;
 }
 
 void Memory::LoadProgram(BYTE program[])
@@ -28,33 +97,100 @@ void Memory::LoadProgram(BYTE program[])
 	LOG_INFO("Program loaded.");
 }
 
-void Memory::LoadProgram(const char* filepath)
+bool Memory::LoadProgram(const char* filepath)
+{
+	MemoryImage program = LoadImage(filepath);
+	if (!program)
+		return false;
+
+	if (program.GetSize() != m_Size)
+	{
+		LOG_ERROR("Loaded program must be of same size as the memory ({0} KB)", m_Size / 1024);
+		return false;
+	}
+
+	ShareImage(program);
+	return true;
+}
+
+bool Memory::LoadProgramAtTop(const char* filepath)
+{
+	MemoryImage program = LoadImage(filepath);
+	if (!program)
+		return false;
+
+	if (program.GetSize() > m_Size)
+	{
+		LOG_ERROR("Loaded program must be at most the size of the memory ({0} KB)", m_Size / 1024);
+		return false;
+	}
+	if (program.GetSize() == m_Size)
+	{
+		ShareImage(program);
+		return true;
+	}
+
+	// Smaller images end where the vectors are
+	Reset();
+	std::copy(program.GetData(), program.GetData() + program.GetSize(), m_Data.end() - program.GetSize());
+	return true;
+}
+
+void Memory::ShareImage(MemoryImage image)
 {
+	if (!image || image.GetSize() != m_Size)
+	{
+		LOG_ERROR("Shared image must be of same size as the memory ({0} KB)", m_Size / 1024);
+		return;
+	}
+
+	m_Data.clear();
+	m_Data.shrink_to_fit();
+	m_Image = image;
+	m_Generation++;
+}
+
+MemoryImage Memory::LoadImage(const char* filepath)
+{
+	// Every memory sharing a mapped image reads the same page cache copy
+	MemoryImage image = MemoryImage::Map(filepath);
+	if (image)
+		return image;
+
 	std::ifstream file(filepath, std::ios::binary);
-	file.unsetf(std::ios::skipws);
+	if (!file.is_open())
+	{
+		LOG_ERROR("Could not open {0}", filepath);
+		return nullptr;
+	}
 
 	file.seekg(0, std::ios::end);
 	std::streampos fileSize = file.tellg();
 	file.seekg(0, std::ios::beg);
+	if (fileSize <= 0)
+	{
+		LOG_ERROR("{0} is empty", filepath);
+		return nullptr;
+	}
 
-	std::vector<BYTE> program;
-	program.reserve(fileSize);
-	program.insert(program.begin(), std::istream_iterator<BYTE>(file), std::istream_iterator<BYTE>());
-
-	if (program.size() != m_Size)
+	auto bytes = std::make_shared<std::vector<BYTE>>((size_t)fileSize);
+	if (!file.read((char*)bytes->data(), fileSize))
 	{
-		LOG_ERROR("Loaded program must be of same size as EEPROM ({0} KB)", m_Size / 1024);
-		return;
+		LOG_ERROR("Could not read {0}", filepath);
+		return nullptr;
 	}
 
-	std::swap(*m_Data, program);
+	return bytes;
 }
 
-bool Memory::IsAddressOk(const uint32_t& address)
+void Memory::MakePrivate()
 {
-	int32_t localAddress = address - m_ZeroAddress;
+	if (!m_Image)
+		return;
 
-	return !(localAddress < 0 || localAddress >= m_Size);
+	m_Data.assign(m_Image.GetData(), m_Image.GetData() + m_Image.GetSize());
+	m_Image = nullptr;
+	m_Generation++;
 }
 
 BYTE Memory::ReadByte(const WORD& address)
@@ -62,7 +198,7 @@ BYTE Memory::ReadByte(const WORD& address)
 	if (!IsAddressOk(address))
 		return 0;
 
-	return m_Data->at(address - m_ZeroAddress);
+	return GetData()[address - m_ZeroAddress];
 }
 
 void Memory::WriteByte(const WORD& address, const BYTE& value)
@@ -70,7 +206,22 @@ void Memory::WriteByte(const WORD& address, const BYTE& value)
 	if (!IsAddressOk(address))
 		return;
 
-	m_Data->at(address - m_ZeroAddress) = value;
+	MakePrivate();
+	m_Data[address - m_ZeroAddress] = value;
+	m_PageGenerations[address >> 8]++;
+}
+
+BYTE* Memory::GetWritableRange(WORD address, uint32_t size)
+{
+	uint32_t offset = (uint32_t)address - m_ZeroAddress;
+	if (size == 0 || !IsAddressOk(address) || offset + size > m_Size)
+		return nullptr;
+
+	MakePrivate();
+	for (uint32_t page = address >> 8; page <= (address + size - 1) >> 8; page++)
+		m_PageGenerations[page]++;
+
+	return &m_Data[offset];
 }
 
 void Memory::ChangeMemory(uint32_t size, WORD zeroAddress)
@@ -2,8 +2,42 @@
 
 #include "Base.h"
 
+#include <array>
+#include <cstddef>
+#include <memory>
 #include <vector>
 
+constexpr uint32_t PAGE_SIZE = 256;
+constexpr uint32_t PAGE_COUNT = 256;
+
+// Read-only contents shared between memories, either bytes held in memory or a
+// file mapped straight from the page cache. Copies share the same contents.
+class MemoryImage
+{
+public:
+	MemoryImage() = default;
+	MemoryImage(std::nullptr_t) {}
+	template<typename Bytes>
+	MemoryImage(std::shared_ptr<Bytes> bytes)
+		: m_Data(bytes ? bytes->data() : nullptr), m_Size(bytes ? (uint32_t)bytes->size() : 0), m_Owner(std::move(bytes)) {}
+
+	// Maps the whole file read-only, returns no image if it cannot be mapped
+	static MemoryImage Map(const char* filepath);
+
+	inline const BYTE* GetData() const { return m_Data; }
+	inline uint32_t GetSize() const { return m_Size; }
+	inline bool IsMapped() const { return m_IsMapped; }
+
+	inline const BYTE& operator[](uint32_t index) const { return m_Data[index]; }
+	inline explicit operator bool() const { return m_Owner != nullptr; }
+
+private:
+	const BYTE* m_Data = nullptr;
+	uint32_t m_Size = 0;
+	bool m_IsMapped = false;
+	std::shared_ptr<const void> m_Owner;	// Keeps the bytes or the mapping alive
+};
+
 class Memory
 {
 public:
@@ -13,20 +47,43 @@ public:
 	void Reset();
 
 	void LoadProgram(BYTE program[]);	// TEMP
-	void LoadProgram(const char* filepath);
+	// The image must be of the memory's size and backs it directly, returns false when it could not be loaded
+	bool LoadProgram(const char* filepath);
+	// As LoadProgram, but smaller images are copied to the top of the cleared memory
+	bool LoadProgramAtTop(const char* filepath);
+	// Uses the image without copying it, the memory gets its own copy on the first write
+	void ShareImage(MemoryImage image);
+	// Maps the file where the platform allows, otherwise reads it. Empty files give no image
+	static MemoryImage LoadImage(const char* filepath);
 	
-	inline bool IsROM() { return m_IsROM; }
-	bool IsAddressOk(const uint32_t& address);
+	inline bool IsROM() const { return m_IsROM; }
+	// Addresses below the zero address wrap around, so a single compare covers both ends
+	inline bool IsAddressOk(const uint32_t& address) const { return address - m_ZeroAddress < m_Size; }
+
+	inline uint32_t GetSize() const { return m_Size; }
+	inline WORD GetZeroAddress() const { return m_ZeroAddress; }
+	inline const BYTE* GetData() const { return m_Image ? m_Image.GetData() : m_Data.data(); }
+	inline BYTE* GetWritableData() { return m_Image ? nullptr : m_Data.data(); }	// nullptr while sharing an image
+	inline bool IsShared() const { return (bool)m_Image; }
+	inline uint32_t GetGeneration() const { return m_Generation; }	// Changes whenever the data is reallocated
+	inline uint32_t* GetPageGeneration(WORD address) { return &m_PageGenerations[address >> 8]; }	// Bumped on every write to the page
 
 	BYTE ReadByte(const WORD& address);
 	void WriteByte(const WORD& address, const BYTE& value);
+	// Host access to [address, address + size), which must be in the memory. Counts as a write to its pages
+	BYTE* GetWritableRange(WORD address, uint32_t size);
 
 	void ChangeMemory(uint32_t size, WORD zeroAddress);
 
 private:
+	void MakePrivate();
+
 	bool m_IsROM = true;
 	uint32_t m_Size = 0;
 	WORD m_ZeroAddress = 0;
-	std::vector<BYTE>* m_Data = nullptr;
+	std::vector<BYTE> m_Data;	// Empty while sharing an image
+	MemoryImage m_Image;
+	uint32_t m_Generation = 0;
+	std::array<uint32_t, PAGE_COUNT> m_PageGenerations = {};
 };
 
@@ -0,0 +1,35 @@
+#include "MicroCode.h"
+
+namespace {
+
+	using M = MicroOp;
+
+	constexpr std::array<MicroProgram, 256> BuildPrograms()
+	{
+		std::array<MicroProgram, 256> p = {};
+		for (uint32_t opcode = 0; opcode < 256; opcode++)
+			p[opcode] = MicroCode::MakeProgram(OPCODE_TABLE[opcode].Op, OPCODE_TABLE[opcode].Mode);
+		return p;
+	}
+
+	constexpr std::array<MicroProgram, 256> s_Programs = BuildPrograms();
+
+	constexpr MicroProgram s_ResetProgram = { Operation::None, {
+		M::ResetStart, M::Idle, M::Idle, M::ReadStack, M::ResetReadStack1, M::ResetReadStack2, M::ResetVectorADL, M::FetchADHAndJump
+	} };
+}
+
+const MicroProgram& MicroCode::GetProgram(BYTE opcode)
+{
+	return s_Programs[opcode];
+}
+
+const MicroProgram& MicroCode::GetResetProgram()
+{
+	return s_ResetProgram;
+}
+
+const OpcodeInfo& MicroCode::GetInfo(BYTE opcode)
+{
+	return OPCODE_TABLE[opcode];
+}
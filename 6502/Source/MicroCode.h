@@ -0,0 +1,510 @@
+#pragma once
+
+#include "Base.h"
+#include "OperationCodes.h"
+
+#include <array>
+#include <initializer_list>
+
+constexpr uint32_t MAX_MICRO_CYCLES = 8;
+constexpr uint32_t MAX_INSTRUCTION_CYCLES = MAX_MICRO_CYCLES + 1;	// Opcode fetch included
+
+// What an instruction does with its operand, independent of how the operand is addressed
+enum class Operation : BYTE
+{
+	None,
+
+	LDA, LDX, LDY, STA, STX, STY,
+	TAX, TAY, TSX, TXA, TXS, TYA,
+	PHA, PHP, PLA, PLP,
+	DEC, INC, DEX, DEY, INX, INY,
+	ADC, SBC,
+	AND, ORA, EOR, ASL, LSR, ROL, ROR,
+	CLC, CLD, CLI, CLV, SEC, SED, SEI,
+	BCC, BCS, BNE, BEQ, BPL, BMI, BVC, BVS,
+	CMP, CPX, CPY,
+	BRK, RTI, JMP, JSR, RTS,
+	NOP, BIT
+};
+
+// One bus cycle of an instruction (the opcode fetch cycle excluded)
+enum class MicroOp : BYTE
+{
+	// Operand and address fetching
+	FetchADL,				// AddressBus = PC++, ADL = DataBus
+	FetchADH,				// AddressBus = PC++, ADH = DataBus
+	FetchADHAndJump,		// AddressBus = PC, ADH = DataBus, PC = ADH:ADL
+	FetchBAL,				// AddressBus = PC++, BAL = DataBus
+	FetchBAH,				// AddressBus = PC++, BAH = DataBus
+	FetchIAL,				// AddressBus = PC++, IAL = DataBus
+	FetchIAH,				// AddressBus = PC, IAH = DataBus
+	AddressBAL,				// AddressBus = BAL (no memory access)
+	ReadIndirectXADL,		// AddressBus = BAL + X, ADL = DataBus
+	ReadIndirectXADH,		// AddressBus = BAL + X + 1, ADH = DataBus
+	ReadIndirectYBAL,		// AddressBus = IAL, BAL = DataBus
+	ReadIndirectYBAH,		// AddressBus = IAL + 1, BAH = DataBus
+	ReadIndirectADL,		// AddressBus = IAH:IAL, ADL = DataBus
+	ReadIndirectADHAndJump,	// AddressBus = IAH:IAL + 1, ADH = DataBus, PC = ADH:ADL
+	IndexAbsoluteX,			// AddressBus = BAH:BAL + X (no memory access)
+	IndexAbsoluteY,			// AddressBus = BAH:BAL + Y (no memory access)
+
+	// Cycles executing the operation
+	OperandImmediate,		// AddressBus = PC++
+	OperandZeroPage,		// AddressBus = ADL
+	OperandZeroPageX,		// AddressBus = BAL + X (wrapped to zero page)
+	OperandZeroPageY,		// AddressBus = BAL + Y (wrapped to zero page)
+	OperandAbsolute,		// AddressBus = ADH:ADL
+	OperandAbsoluteX,		// AddressBus = BAH:BAL + X, stalls one cycle on page cross
+	OperandAbsoluteY,		// AddressBus = BAH:BAL + Y, stalls one cycle on page cross
+	OperandPageCrossX,		// AddressBus = BAH+1:BAL + X
+	OperandPageCrossY,		// AddressBus = BAH+1:BAL + Y
+	OperandAddressBus,		// AddressBus unchanged
+	OperandImplied,			// AddressBus = PC (dummy read)
+	OperandAccumulator,		// No bus activity
+	OperandModify,			// Writes the modified DataBus back to AddressBus
+	OperandPush,			// AddressBus = $01:SP--
+	OperandPull,			// AddressBus = $01:SP
+	OperandBranch,			// AddressBus = PC++, ends the instruction if not taken
+
+	// Read-modify-write
+	ReadZeroPage,			// AddressBus = ADL
+	ReadZeroPageX,			// AddressBus = BAL + X (wrapped to zero page)
+	ReadAbsolute,			// AddressBus = ADH:ADL
+	ReadAddressBus,			// AddressBus unchanged
+	DummyWrite,				// RWB goes low, nothing is written
+
+	// Stack, branch, jump and interrupt cycles
+	ReadPC,					// AddressBus = PC (dummy read)
+	IncrementPC,			// AddressBus = PC++ (dummy read)
+	ReadStack,				// AddressBus = $01:SP (dummy read)
+	IncrementSP,			// AddressBus = $01:SP++ (dummy read)
+	PushPCH,				// AddressBus = $01:SP--, DataBus = PCH
+	PushPCL,				// AddressBus = $01:SP--, DataBus = PCL
+	PushPS,					// AddressBus = $01:SP--, DataBus = PS
+	PullPS,					// AddressBus = $01:SP++, PS = DataBus
+	PullPCL,				// AddressBus = $01:SP++, PCL = DataBus
+	PullPCH,				// AddressBus = $01:SP, PCH = DataBus
+	BranchTaken,			// Ends the instruction unless the branch crosses a page
+	BranchPageCross,		// PC += offset
+	BreakReadPC,			// AddressBus = PC (PC++ unless serving an interrupt)
+	BreakVectorADL,			// Sets I/B, picks the NMI or IRQ vector and reads its low byte
+
+	// Reset sequence
+	ResetStart,
+	Idle,
+	ResetReadStack1,
+	ResetReadStack2,
+	ResetVectorADL
+};
+
+constexpr uint32_t MICRO_OP_COUNT = (uint32_t)MicroOp::ResetVectorADL + 1;
+
+struct MicroProgram
+{
+	Operation Op = Operation::None;
+	BYTE Length = 0;	// 0 for illegal opcodes
+	BYTE Bytes = 1;		// Opcode and operand bytes following PC
+	std::array<MicroOp, MAX_MICRO_CYCLES> Cycles = {};
+
+	constexpr MicroProgram() = default;
+	constexpr MicroProgram(Operation op, std::initializer_list<MicroOp> cycles)
+		: Op(op)
+	{
+		for (MicroOp cycle : cycles)
+		{
+			// The jump after reading an interrupt or reset vector fetches from the vector, not PC
+			bool vector = Length > 0 && (Cycles[Length - 1] == MicroOp::BreakVectorADL || Cycles[Length - 1] == MicroOp::ResetVectorADL);
+			if (IsOperandFetch(cycle) && !vector)
+				Bytes++;
+
+			Cycles[Length++] = cycle;
+		}
+	}
+
+private:
+	static constexpr bool IsOperandFetch(MicroOp op)
+	{
+		switch (op)
+		{
+			case MicroOp::FetchADL: case MicroOp::FetchADH: case MicroOp::FetchADHAndJump:
+			case MicroOp::FetchBAL: case MicroOp::FetchBAH: case MicroOp::FetchIAL: case MicroOp::FetchIAH:
+			case MicroOp::OperandImmediate: case MicroOp::OperandBranch: case MicroOp::BreakReadPC:
+				return true;
+			default:
+				return false;
+		}
+	}
+};
+
+// How the operand of an instruction is addressed
+enum class AddressingMode : BYTE
+{
+	None,
+	Implied, Accumulator, Immediate, Relative,
+	ZeroPage, ZeroPageX, ZeroPageY,
+	Absolute, AbsoluteX, AbsoluteY,
+	Indirect, IndirectX, IndirectY
+};
+
+// What an instruction does with the memory at its effective address
+enum class AccessClass : BYTE
+{
+	None, Read, Write, ReadModifyWrite
+};
+
+struct OpcodeInfo
+{
+	const char* Mnemonic = "???";
+	Operation Op = Operation::None;
+	AddressingMode Mode = AddressingMode::None;
+	AccessClass Access = AccessClass::None;
+	BYTE Cycles = 0;			// Opcode fetch included, optional cycles excluded
+	BYTE PageCrossCycles = 0;	// Added when indexing or a taken branch crosses a page
+};
+
+class MicroCode
+{
+public:
+	static const MicroProgram& GetProgram(BYTE opcode);
+	static const MicroProgram& GetResetProgram();
+	static const OpcodeInfo& GetInfo(BYTE opcode);
+
+	static constexpr AccessClass GetAccess(Operation op, AddressingMode mode)
+	{
+		using O = Operation;
+		switch (op)
+		{
+			case O::LDA: case O::LDX: case O::LDY: case O::PLA: case O::PLP:
+			case O::ADC: case O::SBC: case O::AND: case O::ORA: case O::EOR:
+			case O::CMP: case O::CPX: case O::CPY: case O::BIT:
+				return AccessClass::Read;
+			case O::STA: case O::STX: case O::STY: case O::PHA: case O::PHP:
+				return AccessClass::Write;
+			case O::ASL: case O::LSR: case O::ROL: case O::ROR: case O::DEC: case O::INC:
+				return mode == AddressingMode::Accumulator || mode == AddressingMode::Implied ? AccessClass::None : AccessClass::ReadModifyWrite;
+			default:
+				return AccessClass::None;
+		}
+	}
+
+	// The cycles of an instruction after its opcode fetch
+	static constexpr MicroProgram MakeProgram(Operation op, AddressingMode mode)
+	{
+		using M = MicroOp;
+		using O = Operation;
+		using A = AddressingMode;
+
+		switch (op)
+		{
+			case O::None: return {};
+			case O::BRK: return { op, { M::BreakReadPC, M::PushPCH, M::PushPCL, M::PushPS, M::BreakVectorADL, M::FetchADHAndJump } };
+			case O::RTI: return { op, { M::ReadPC, M::IncrementSP, M::PullPS, M::PullPCL, M::PullPCH } };
+			case O::JSR: return { op, { M::FetchADL, M::ReadStack, M::PushPCH, M::PushPCL, M::FetchADHAndJump } };
+			case O::RTS: return { op, { M::ReadPC, M::IncrementSP, M::PullPCL, M::PullPCH, M::IncrementPC } };
+			case O::JMP:
+				if (mode == A::Indirect)
+					return { op, { M::FetchIAL, M::FetchIAH, M::ReadIndirectADL, M::ReadIndirectADHAndJump } };
+				return { op, { M::FetchADL, M::FetchADHAndJump } };
+			case O::PHA: case O::PHP: return { op, { M::ReadPC, M::OperandPush } };
+			case O::PLA: case O::PLP: return { op, { M::ReadPC, M::IncrementSP, M::OperandPull } };
+			default: break;
+		}
+
+		// Indexed stores always spend the page cross cycle
+		AccessClass access = GetAccess(op, mode);
+		bool write = access == AccessClass::Write;
+		bool modify = access == AccessClass::ReadModifyWrite;
+
+		switch (mode)
+		{
+			case A::Implied:		return { op, { M::OperandImplied } };
+			case A::Accumulator:	return { op, { M::OperandAccumulator } };
+			case A::Immediate:		return { op, { M::OperandImmediate } };
+			case A::Relative:		return { op, { M::OperandBranch, M::BranchTaken, M::BranchPageCross } };
+			case A::ZeroPage:
+				if (modify)
+					return { op, { M::FetchADL, M::ReadZeroPage, M::DummyWrite, M::OperandModify } };
+				return { op, { M::FetchADL, M::OperandZeroPage } };
+			case A::ZeroPageX:
+				if (modify)
+					return { op, { M::FetchBAL, M::AddressBAL, M::ReadZeroPageX, M::DummyWrite, M::OperandModify } };
+				return { op, { M::FetchBAL, M::AddressBAL, M::OperandZeroPageX } };
+			case A::ZeroPageY:		return { op, { M::FetchBAL, M::AddressBAL, M::OperandZeroPageY } };
+			case A::Absolute:
+				if (modify)
+					return { op, { M::FetchADL, M::FetchADH, M::ReadAbsolute, M::DummyWrite, M::OperandModify } };
+				return { op, { M::FetchADL, M::FetchADH, M::OperandAbsolute } };
+			case A::AbsoluteX:
+				if (modify)
+					return { op, { M::FetchBAL, M::FetchBAH, M::IndexAbsoluteX, M::ReadAddressBus, M::DummyWrite, M::OperandModify } };
+				if (write)
+					return { op, { M::FetchBAL, M::FetchBAH, M::IndexAbsoluteX, M::OperandAddressBus } };
+				return { op, { M::FetchBAL, M::FetchBAH, M::OperandAbsoluteX, M::OperandPageCrossX } };
+			case A::AbsoluteY:
+				if (write)
+					return { op, { M::FetchBAL, M::FetchBAH, M::IndexAbsoluteY, M::OperandAddressBus } };
+				return { op, { M::FetchBAL, M::FetchBAH, M::OperandAbsoluteY, M::OperandPageCrossY } };
+			case A::IndirectX:		return { op, { M::FetchBAL, M::AddressBAL, M::ReadIndirectXADL, M::ReadIndirectXADH, M::OperandAbsolute } };
+			case A::IndirectY:
+				if (write)
+					return { op, { M::FetchIAL, M::ReadIndirectYBAL, M::ReadIndirectYBAH, M::IndexAbsoluteY, M::OperandAddressBus } };
+				return { op, { M::FetchIAL, M::ReadIndirectYBAL, M::ReadIndirectYBAH, M::OperandAbsoluteY, M::OperandPageCrossY } };
+			default:
+				return {};
+		}
+	}
+
+	static constexpr OpcodeInfo MakeInfo(Operation op, AddressingMode mode)
+	{
+		constexpr const char* mnemonics[] = {
+			"???",
+			"LDA", "LDX", "LDY", "STA", "STX", "STY",
+			"TAX", "TAY", "TSX", "TXA", "TXS", "TYA",
+			"PHA", "PHP", "PLA", "PLP",
+			"DEC", "INC", "DEX", "DEY", "INX", "INY",
+			"ADC", "SBC",
+			"AND", "ORA", "EOR", "ASL", "LSR", "ROL", "ROR",
+			"CLC", "CLD", "CLI", "CLV", "SEC", "SED", "SEI",
+			"BCC", "BCS", "BNE", "BEQ", "BPL", "BMI", "BVC", "BVS",
+			"CMP", "CPX", "CPY",
+			"BRK", "RTI", "JMP", "JSR", "RTS",
+			"NOP", "BIT"
+		};
+
+		OpcodeInfo info;
+		info.Mnemonic = mnemonics[(BYTE)op];
+		info.Op = op;
+		info.Mode = mode;
+		info.Access = GetAccess(op, mode);
+
+		MicroProgram program = MakeProgram(op, mode);
+		if (program.Length == 0)
+			return info;
+
+		info.Cycles = 1;
+		for (BYTE i = 0; i < program.Length; i++)
+		{
+			switch (program.Cycles[i])
+			{
+				case MicroOp::OperandPageCrossX: case MicroOp::OperandPageCrossY: case MicroOp::BranchPageCross:
+					info.PageCrossCycles++;
+					break;
+				case MicroOp::BranchTaken:
+					break;
+				default:
+					info.Cycles++;
+					break;
+			}
+		}
+		return info;
+	}
+};
+
+// Every opcode by its mnemonic and addressing mode, illegal opcodes are left empty
+constexpr std::array<OpcodeInfo, 256> BuildOpcodeTable()
+{
+	using O = Operation;
+	using A = AddressingMode;
+	std::array<OpcodeInfo, 256> t = {};
+	auto set = [&t](BYTE opcode, Operation op, AddressingMode mode) { t[opcode] = MicroCode::MakeInfo(op, mode); };
+
+#pragma region Transfer_Instructions
+	set(INS_LDA_IM, O::LDA, A::Immediate);
+	set(INS_LDA_ZP, O::LDA, A::ZeroPage);
+	set(INS_LDA_ZPX, O::LDA, A::ZeroPageX);
+	set(INS_LDA_ABS, O::LDA, A::Absolute);
+	set(INS_LDA_ABSX, O::LDA, A::AbsoluteX);
+	set(INS_LDA_ABSY, O::LDA, A::AbsoluteY);
+	set(INS_LDA_INDX, O::LDA, A::IndirectX);
+	set(INS_LDA_INDY, O::LDA, A::IndirectY);
+
+	set(INS_LDX_IM, O::LDX, A::Immediate);
+	set(INS_LDX_ZP, O::LDX, A::ZeroPage);
+	set(INS_LDX_ZPY, O::LDX, A::ZeroPageY);
+	set(INS_LDX_ABS, O::LDX, A::Absolute);
+	set(INS_LDX_ABSY, O::LDX, A::AbsoluteY);
+
+	set(INS_LDY_IM, O::LDY, A::Immediate);
+	set(INS_LDY_ZP, O::LDY, A::ZeroPage);
+	set(INS_LDY_ZPX, O::LDY, A::ZeroPageX);
+	set(INS_LDY_ABS, O::LDY, A::Absolute);
+	set(INS_LDY_ABSX, O::LDY, A::AbsoluteX);
+
+	set(INS_STA_ZP, O::STA, A::ZeroPage);
+	set(INS_STA_ZPX, O::STA, A::ZeroPageX);
+	set(INS_STA_ABS, O::STA, A::Absolute);
+	set(INS_STA_ABSX, O::STA, A::AbsoluteX);
+	set(INS_STA_ABSY, O::STA, A::AbsoluteY);
+	set(INS_STA_INDX, O::STA, A::IndirectX);
+	set(INS_STA_INDY, O::STA, A::IndirectY);
+
+	set(INS_STX_ZP, O::STX, A::ZeroPage);
+	set(INS_STX_ZPY, O::STX, A::ZeroPageY);
+	set(INS_STX_ABS, O::STX, A::Absolute);
+
+	set(INS_STY_ZP, O::STY, A::ZeroPage);
+	set(INS_STY_ZPX, O::STY, A::ZeroPageX);
+	set(INS_STY_ABS, O::STY, A::Absolute);
+
+	set(INS_TAX_IMP, O::TAX, A::Implied);
+	set(INS_TAY_IMP, O::TAY, A::Implied);
+	set(INS_TSX_IMP, O::TSX, A::Implied);
+	set(INS_TXA_IMP, O::TXA, A::Implied);
+	set(INS_TXS_IMP, O::TXS, A::Implied);
+	set(INS_TYA_IMP, O::TYA, A::Implied);
+#pragma endregion
+
+#pragma region PushPull_Instructions
+	set(INS_PHA_IMP, O::PHA, A::Implied);
+	set(INS_PHP_IMP, O::PHP, A::Implied);
+	set(INS_PLA_IMP, O::PLA, A::Implied);
+	set(INS_PLP_IMP, O::PLP, A::Implied);
+#pragma endregion
+
+#pragma region DecInc_Instructions
+	set(INS_DEC_ZP, O::DEC, A::ZeroPage);
+	set(INS_DEC_ZPX, O::DEC, A::ZeroPageX);
+	set(INS_DEC_ABS, O::DEC, A::Absolute);
+	set(INS_DEC_ABSX, O::DEC, A::AbsoluteX);
+
+	set(INS_INC_ZP, O::INC, A::ZeroPage);
+	set(INS_INC_ZPX, O::INC, A::ZeroPageX);
+	set(INS_INC_ABS, O::INC, A::Absolute);
+	set(INS_INC_ABSX, O::INC, A::AbsoluteX);
+
+	set(INS_DEX_IMP, O::DEX, A::Implied);
+	set(INS_INX_IMP, O::INX, A::Implied);
+	set(INS_DEY_IMP, O::DEY, A::Implied);
+	set(INS_INY_IMP, O::INY, A::Implied);
+#pragma endregion
+
+#pragma region Arithmetic_Instructions
+	set(INS_ADC_IM, O::ADC, A::Immediate);
+	set(INS_ADC_ZP, O::ADC, A::ZeroPage);
+	set(INS_ADC_ZPX, O::ADC, A::ZeroPageX);
+	set(INS_ADC_ABS, O::ADC, A::Absolute);
+	set(INS_ADC_ABSX, O::ADC, A::AbsoluteX);
+	set(INS_ADC_ABSY, O::ADC, A::AbsoluteY);
+	set(INS_ADC_INDX, O::ADC, A::IndirectX);
+	set(INS_ADC_INDY, O::ADC, A::IndirectY);
+
+	set(INS_SBC_IM, O::SBC, A::Immediate);
+	set(INS_SBC_ZP, O::SBC, A::ZeroPage);
+	set(INS_SBC_ZPX, O::SBC, A::ZeroPageX);
+	set(INS_SBC_ABS, O::SBC, A::Absolute);
+	set(INS_SBC_ABSX, O::SBC, A::AbsoluteX);
+	set(INS_SBC_ABSY, O::SBC, A::AbsoluteY);
+	set(INS_SBC_INDX, O::SBC, A::IndirectX);
+	set(INS_SBC_INDY, O::SBC, A::IndirectY);
+#pragma endregion
+
+#pragma region Logical_Instructions
+	set(INS_AND_IM, O::AND, A::Immediate);
+	set(INS_AND_ZP, O::AND, A::ZeroPage);
+	set(INS_AND_ZPX, O::AND, A::ZeroPageX);
+	set(INS_AND_ABS, O::AND, A::Absolute);
+	set(INS_AND_ABSX, O::AND, A::AbsoluteX);
+	set(INS_AND_ABSY, O::AND, A::AbsoluteY);
+	set(INS_AND_INDX, O::AND, A::IndirectX);
+	set(INS_AND_INDY, O::AND, A::IndirectY);
+
+	set(INS_ORA_IM, O::ORA, A::Immediate);
+	set(INS_ORA_ZP, O::ORA, A::ZeroPage);
+	set(INS_ORA_ZPX, O::ORA, A::ZeroPageX);
+	set(INS_ORA_ABS, O::ORA, A::Absolute);
+	set(INS_ORA_ABSX, O::ORA, A::AbsoluteX);
+	set(INS_ORA_ABSY, O::ORA, A::AbsoluteY);
+	set(INS_ORA_INDX, O::ORA, A::IndirectX);
+	set(INS_ORA_INDY, O::ORA, A::IndirectY);
+
+	set(INS_EOR_IM, O::EOR, A::Immediate);
+	set(INS_EOR_ZP, O::EOR, A::ZeroPage);
+	set(INS_EOR_ZPX, O::EOR, A::ZeroPageX);
+	set(INS_EOR_ABS, O::EOR, A::Absolute);
+	set(INS_EOR_ABSX, O::EOR, A::AbsoluteX);
+	set(INS_EOR_ABSY, O::EOR, A::AbsoluteY);
+	set(INS_EOR_INDX, O::EOR, A::IndirectX);
+	set(INS_EOR_INDY, O::EOR, A::IndirectY);
+
+	set(INS_ASL_ACC, O::ASL, A::Accumulator);
+	set(INS_ASL_ZP, O::ASL, A::ZeroPage);
+	set(INS_ASL_ZPX, O::ASL, A::ZeroPageX);
+	set(INS_ASL_ABS, O::ASL, A::Absolute);
+	set(INS_ASL_ABSX, O::ASL, A::AbsoluteX);
+
+	set(INS_LSR_ACC, O::LSR, A::Accumulator);
+	set(INS_LSR_ZP, O::LSR, A::ZeroPage);
+	set(INS_LSR_ZPX, O::LSR, A::ZeroPageX);
+	set(INS_LSR_ABS, O::LSR, A::Absolute);
+	set(INS_LSR_ABSX, O::LSR, A::AbsoluteX);
+
+	set(INS_ROL_ACC, O::ROL, A::Accumulator);
+	set(INS_ROL_ZP, O::ROL, A::ZeroPage);
+	set(INS_ROL_ZPX, O::ROL, A::ZeroPageX);
+	set(INS_ROL_ABS, O::ROL, A::Absolute);
+	set(INS_ROL_ABSX, O::ROL, A::AbsoluteX);
+
+	set(INS_ROR_ACC, O::ROR, A::Accumulator);
+	set(INS_ROR_ZP, O::ROR, A::ZeroPage);
+	set(INS_ROR_ZPX, O::ROR, A::ZeroPageX);
+	set(INS_ROR_ABS, O::ROR, A::Absolute);
+	set(INS_ROR_ABSX, O::ROR, A::AbsoluteX);
+#pragma endregion
+
+#pragma region Flag_Instructions
+	set(INS_CLC_IMP, O::CLC, A::Implied);
+	set(INS_CLD_IMP, O::CLD, A::Implied);
+	set(INS_CLI_IMP, O::CLI, A::Implied);
+	set(INS_CLV_IMP, O::CLV, A::Implied);
+	set(INS_SEC_IMP, O::SEC, A::Implied);
+	set(INS_SED_IMP, O::SED, A::Implied);
+	set(INS_SEI_IMP, O::SEI, A::Implied);
+#pragma endregion
+
+#pragma region Branch_Instructions
+	set(INS_BCC_REL, O::BCC, A::Relative);
+	set(INS_BCS_REL, O::BCS, A::Relative);
+	set(INS_BNE_REL, O::BNE, A::Relative);
+	set(INS_BEQ_REL, O::BEQ, A::Relative);
+	set(INS_BPL_REL, O::BPL, A::Relative);
+	set(INS_BMI_REL, O::BMI, A::Relative);
+	set(INS_BVC_REL, O::BVC, A::Relative);
+	set(INS_BVS_REL, O::BVS, A::Relative);
+
+	set(INS_CMP_IM, O::CMP, A::Immediate);
+	set(INS_CMP_ZP, O::CMP, A::ZeroPage);
+	set(INS_CMP_ZPX, O::CMP, A::ZeroPageX);
+	set(INS_CMP_ABS, O::CMP, A::Absolute);
+	set(INS_CMP_ABSX, O::CMP, A::AbsoluteX);
+	set(INS_CMP_ABSY, O::CMP, A::AbsoluteY);
+	set(INS_CMP_INDX, O::CMP, A::IndirectX);
+	set(INS_CMP_INDY, O::CMP, A::IndirectY);
+
+	set(INS_CPX_IM, O::CPX, A::Immediate);
+	set(INS_CPX_ZP, O::CPX, A::ZeroPage);
+	set(INS_CPX_ABS, O::CPX, A::Absolute);
+
+	set(INS_CPY_IM, O::CPY, A::Immediate);
+	set(INS_CPY_ZP, O::CPY, A::ZeroPage);
+	set(INS_CPY_ABS, O::CPY, A::Absolute);
+#pragma endregion
+
+#pragma region Jump_Instructions
+	set(INS_BRK_IMP, O::BRK, A::Implied);
+	set(INS_RTI_IMP, O::RTI, A::Implied);
+	set(INS_JMP_ABS, O::JMP, A::Absolute);
+	set(INS_JMP_IND, O::JMP, A::Indirect);
+	set(INS_JSR_ABS, O::JSR, A::Absolute);
+	set(INS_RTS_IMP, O::RTS, A::Implied);
+#pragma endregion
+
+#pragma region Other_Instructions
+	set(INS_NOP_IMP, O::NOP, A::Implied);
+	set(INS_BIT_ZP, O::BIT, A::ZeroPage);
+	set(INS_BIT_ABS, O::BIT, A::Absolute);
+#pragma endregion
+
+	return t;
+}
+
+inline constexpr std::array<OpcodeInfo, 256> OPCODE_TABLE = BuildOpcodeTable();
@@ -0,0 +1,663 @@
+#pragma once
+
+#include "ALU.h"
+#include "Base.h"
+#include "MicroCode.h"
+
+// The bus micro-ops and operations of the micro-programs, shared by every core
+// that runs them: the CPU, and each lane of a LockstepCPU. A core has the CPU
+// registers and address latches (m_BAL to m_IAH) under the CPU names, and:
+//   SetDataBusFromMemory(), WriteMemoryFromDataBus()	to drive the buses
+//   FetchOperand(BYTE&)									AddressBus = PC++, reads the operand
+//   EndInstruction()									skips the rest of the program
+//   SetZN(BYTE), SyncFlags(), DiscardFlags()			for cores keeping N and Z pending
+template<typename Core>
+class MicroOps
+{
+public:
+	static void Run(Core& core, MicroOp op, Operation operation);
+	static void RunOperation(Core& core, Operation operation);
+	static void RunAccumulatorOperation(Core& core, Operation operation);
+	static bool IsBranchTaken(Core& core, Operation operation);
+
+private:
+	static void SetRegister(Core& core, BYTE& reg);
+	static void StoreRegister(Core& core, BYTE& reg);
+	static void CompareRegister(Core& core, BYTE& reg);
+	static void AddA(Core& core);
+	static void SubA(Core& core);
+	static void AndA(Core& core);
+	static void OrA(Core& core);
+	static void ExclusiveOrA(Core& core);
+	static void ShiftLeftDB(Core& core, bool withC);
+	static void ShiftRightDB(Core& core, bool withC);
+	static void ShiftLeftA(Core& core, bool withC);
+	static void ShiftRightA(Core& core, bool withC);
+	static void DecDB(Core& core);
+	static void IncDB(Core& core);
+	static void TestBit(Core& core);
+};
+
+template<typename Core>
+FORCE_INLINE void MicroOps<Core>::Run(Core& core, MicroOp op, Operation operation)
+{
+	switch (op)
+	{
+#pragma region Address_MicroOps
+		case MicroOp::FetchADL:
+		{
+			core.FetchOperand(core.m_ADL);
+		} break;
+		case MicroOp::FetchADH:
+		{
+			core.FetchOperand(core.m_ADH);
+		} break;
+		case MicroOp::FetchADHAndJump:
+		{
+			core.AddressBus = core.PC;
+			core.SetDataBusFromMemory();
+			core.m_ADH = core.DataBus;
+			core.PC = ((WORD)core.m_ADH << 8) | core.m_ADL;
+		} break;
+		case MicroOp::FetchBAL:
+		{
+			core.FetchOperand(core.m_BAL);
+		} break;
+		case MicroOp::FetchBAH:
+		{
+			core.FetchOperand(core.m_BAH);
+		} break;
+		case MicroOp::FetchIAL:
+		{
+			core.FetchOperand(core.m_IAL);
+		} break;
+		case MicroOp::FetchIAH:
+		{
+			core.AddressBus = core.PC;
+			core.SetDataBusFromMemory();
+			core.m_IAH = core.DataBus;
+		} break;
+		case MicroOp::AddressBAL:
+		{
+			core.AddressBus = core.m_BAL;
+		} break;
+		case MicroOp::ReadIndirectXADL:
+		{
+			core.AddressBus = (BYTE)(core.m_BAL + core.X);
+			core.SetDataBusFromMemory();
+			core.m_ADL = core.DataBus;
+		} break;
+		case MicroOp::ReadIndirectXADH:
+		{
+			core.AddressBus = (BYTE)(core.m_BAL + core.X) + 1;
+			core.SetDataBusFromMemory();
+			core.m_ADH = core.DataBus;
+		} break;
+		case MicroOp::ReadIndirectYBAL:
+		{
+			core.AddressBus = core.m_IAL;
+			core.SetDataBusFromMemory();
+			core.m_BAL = core.DataBus;
+		} break;
+		case MicroOp::ReadIndirectYBAH:
+		{
+			core.AddressBus = core.m_IAL + 1;
+			core.SetDataBusFromMemory();
+			core.m_BAH = core.DataBus;
+		} break;
+		case MicroOp::ReadIndirectADL:
+		{
+			core.AddressBus = ((WORD)core.m_IAH << 8) | core.m_IAL;
+			core.SetDataBusFromMemory();
+			core.m_ADL = core.DataBus;
+		} break;
+		case MicroOp::ReadIndirectADHAndJump:
+		{
+			core.AddressBus = (((WORD)core.m_IAH << 8) | core.m_IAL) + 1;
+			core.SetDataBusFromMemory();
+			core.m_ADH = core.DataBus;
+			core.PC = ((WORD)core.m_ADH << 8) | core.m_ADL;
+		} break;
+		case MicroOp::IndexAbsoluteX:
+		{
+			core.m_ADL = core.m_BAL + core.X;
+			core.m_ADH = core.m_BAH + (WORD(core.m_BAL) + core.X > 0xFF ? 1 : 0);
+			core.AddressBus = ((WORD)core.m_ADH << 8) | core.m_ADL;
+		} break;
+		case MicroOp::IndexAbsoluteY:
+		{
+			core.m_ADL = core.m_BAL + core.Y;
+			core.m_ADH = core.m_BAH + (WORD(core.m_BAL) + core.Y > 0xFF ? 1 : 0);
+			core.AddressBus = ((WORD)core.m_ADH << 8) | core.m_ADL;
+		} break;
+#pragma endregion
+
+#pragma region Operand_MicroOps
+		case MicroOp::OperandImmediate:
+		{
+			core.AddressBus = core.PC++;
+			RunOperation(core, operation);
+		} break;
+		case MicroOp::OperandZeroPage:
+		{
+			core.AddressBus = core.m_ADL;
+			RunOperation(core, operation);
+		} break;
+		case MicroOp::OperandZeroPageX:
+		{
+			core.AddressBus = (BYTE)(core.m_BAL + core.X);
+			RunOperation(core, operation);
+		} break;
+		case MicroOp::OperandZeroPageY:
+		{
+			core.AddressBus = (BYTE)(core.m_BAL + core.Y);
+			RunOperation(core, operation);
+		} break;
+		case MicroOp::OperandAbsolute:
+		{
+			core.AddressBus = ((WORD)core.m_ADH << 8) | core.m_ADL;
+			RunOperation(core, operation);
+		} break;
+		case MicroOp::OperandAbsoluteX:
+		{
+			// On page cross the bus idles this cycle and OperandPageCrossX follows
+			if (WORD(core.m_BAL) + core.X > 0xFF)
+				break;
+
+			core.m_ADL = core.m_BAL + core.X;
+			core.m_ADH = core.m_BAH;
+			core.AddressBus = ((WORD)core.m_ADH << 8) | core.m_ADL;
+			RunOperation(core, operation);
+			core.EndInstruction();
+		} break;
+		case MicroOp::OperandAbsoluteY:
+		{
+			if (WORD(core.m_BAL) + core.Y > 0xFF)
+				break;
+
+			core.m_ADL = core.m_BAL + core.Y;
+			core.m_ADH = core.m_BAH;
+			core.AddressBus = ((WORD)core.m_ADH << 8) | core.m_ADL;
+			RunOperation(core, operation);
+			core.EndInstruction();
+		} break;
+		case MicroOp::OperandPageCrossX:
+		{
+			core.m_ADL = core.m_BAL + core.X;
+			core.m_ADH = core.m_BAH + 1;
+			core.AddressBus = ((WORD)core.m_ADH << 8) | core.m_ADL;
+			RunOperation(core, operation);
+		} break;
+		case MicroOp::OperandPageCrossY:
+		{
+			core.m_ADL = core.m_BAL + core.Y;
+			core.m_ADH = core.m_BAH + 1;
+			core.AddressBus = ((WORD)core.m_ADH << 8) | core.m_ADL;
+			RunOperation(core, operation);
+		} break;
+		case MicroOp::OperandAccumulator:
+		{
+			RunAccumulatorOperation(core, operation);
+		} break;
+		case MicroOp::OperandAddressBus:
+		case MicroOp::OperandModify:
+		{
+			RunOperation(core, operation);
+		} break;
+		case MicroOp::OperandImplied:
+		{
+			core.AddressBus = core.PC;
+			core.SetDataBusFromMemory();
+			RunOperation(core, operation);
+		} break;
+		case MicroOp::OperandPush:
+		{
+			core.AddressBus = BIT(8) | core.SP--;
+			RunOperation(core, operation);
+		} break;
+		case MicroOp::OperandPull:
+		{
+			core.AddressBus = BIT(8) | core.SP;
+			RunOperation(core, operation);
+		} break;
+		case MicroOp::OperandBranch:
+		{
+			core.AddressBus = core.PC++;
+			core.SetDataBusFromMemory();
+			if (!IsBranchTaken(core, operation))
+				core.EndInstruction();
+		} break;
+#pragma endregion
+
+#pragma region ReadModifyWrite_MicroOps
+		case MicroOp::ReadZeroPage:
+		{
+			core.AddressBus = core.m_ADL;
+			core.SetDataBusFromMemory();
+		} break;
+		case MicroOp::ReadZeroPageX:
+		{
+			core.AddressBus = (BYTE)(core.m_BAL + core.X);
+			core.SetDataBusFromMemory();
+		} break;
+		case MicroOp::ReadAbsolute:
+		{
+			core.AddressBus = ((WORD)core.m_ADH << 8) | core.m_ADL;
+			core.SetDataBusFromMemory();
+		} break;
+		case MicroOp::ReadAddressBus:
+		{
+			core.SetDataBusFromMemory();
+		} break;
+		case MicroOp::DummyWrite:
+		{
+			core.DataRead = false;
+		} break;
+#pragma endregion
+
+#pragma region StackAndJump_MicroOps
+		case MicroOp::ReadPC:
+		{
+			core.AddressBus = core.PC;
+			core.SetDataBusFromMemory();
+		} break;
+		case MicroOp::IncrementPC:
+		{
+			core.AddressBus = core.PC++;
+			core.SetDataBusFromMemory();
+		} break;
+		case MicroOp::ReadStack:
+		{
+			core.AddressBus = BIT(8) | core.SP;
+			core.SetDataBusFromMemory();
+		} break;
+		case MicroOp::IncrementSP:
+		{
+			core.AddressBus = BIT(8) | core.SP++;
+			core.SetDataBusFromMemory();
+		} break;
+		case MicroOp::PushPCH:
+		{
+			core.AddressBus = BIT(8) | core.SP--;
+			core.DataBus = core.PC >> 8;
+			core.WriteMemoryFromDataBus();
+		} break;
+		case MicroOp::PushPCL:
+		{
+			core.AddressBus = BIT(8) | core.SP--;
+			core.DataBus = (BYTE)core.PC;
+			core.WriteMemoryFromDataBus();
+		} break;
+		case MicroOp::PushPS:
+		{
+			core.SyncFlags();
+			core.AddressBus = BIT(8) | core.SP--;
+			core.DataBus = core.PS.Byte;
+			core.WriteMemoryFromDataBus();
+		} break;
+		case MicroOp::PullPS:
+		{
+			core.AddressBus = BIT(8) | core.SP++;
+			core.SetDataBusFromMemory();
+			core.DiscardFlags();
+			core.PS.Byte = core.DataBus;
+			core.PS.Bits.B = 0;
+		} break;
+		case MicroOp::PullPCL:
+		{
+			core.AddressBus = BIT(8) | core.SP++;
+			core.SetDataBusFromMemory();
+			core.PC = core.DataBus;
+		} break;
+		case MicroOp::PullPCH:
+		{
+			core.AddressBus = BIT(8) | core.SP;
+			core.SetDataBusFromMemory();
+			core.PC |= (WORD)core.DataBus << 8;
+		} break;
+		case MicroOp::BranchTaken:
+		{
+			if ((core.PC >> 8) != ((core.PC + (int8_t)core.DataBus) >> 8))
+				break;
+
+			core.PC += (int8_t)core.DataBus;
+			core.AddressBus = core.PC;
+			core.EndInstruction();
+		} break;
+		case MicroOp::BranchPageCross:
+		{
+			core.PC += (int8_t)core.DataBus;
+			core.AddressBus = core.PC;
+		} break;
+		case MicroOp::BreakReadPC:
+		{
+			core.AddressBus = core.PC;
+			if (!(core.NMI || core.IRQ))
+				core.PC++;
+
+			core.SetDataBusFromMemory();
+		} break;
+		case MicroOp::BreakVectorADL:
+		{
+			core.PS.Bits.I = 1;
+			if (core.NMI || core.IRQ)
+				core.PS.Bits.B = 0;
+			else
+				core.PS.Bits.B = 1;
+
+			if (core.NMI)
+				core.PC = 0xFFFA;
+			else
+				core.PC = 0xFFFE;
+
+			core.IRQ = false;
+			core.NMI = false;
+
+			core.AddressBus = core.PC++;
+			core.SetDataBusFromMemory();
+			core.m_ADL = core.DataBus;
+		} break;
+#pragma endregion
+
+#pragma region Reset_MicroOps
+		case MicroOp::ResetStart:
+		{
+			core.PS.Bits.I = 1;
+			core.SP = 0x00;
+		} break;
+		case MicroOp::Idle:
+			break;
+		case MicroOp::ResetReadStack1:
+		{
+			core.AddressBus = BIT(8) | (core.SP - 1);
+			core.SetDataBusFromMemory();
+		} break;
+		case MicroOp::ResetReadStack2:
+		{
+			core.AddressBus = BIT(8) | (core.SP - 2);
+			core.SetDataBusFromMemory();
+		} break;
+		case MicroOp::ResetVectorADL:
+		{
+			core.SP = 0xFD;
+			core.PC = 0xFFFC;
+			core.AddressBus = core.PC++;
+			core.SetDataBusFromMemory();
+			core.m_ADL = core.DataBus;
+		} break;
+#pragma endregion
+	}
+}
+
+template<typename Core>
+FORCE_INLINE void MicroOps<Core>::RunOperation(Core& core, Operation operation)
+{
+	switch (operation)
+	{
+#pragma region Transfer_Operations
+		case Operation::LDA: SetRegister(core, core.A); break;
+		case Operation::LDX: SetRegister(core, core.X); break;
+		case Operation::LDY: SetRegister(core, core.Y); break;
+		case Operation::STA: StoreRegister(core, core.A); break;
+		case Operation::STX: StoreRegister(core, core.X); break;
+		case Operation::STY: StoreRegister(core, core.Y); break;
+
+		case Operation::TAX:
+		{
+			core.X = core.A;
+			core.SetZN(core.X);
+		} break;
+		case Operation::TAY:
+		{
+			core.Y = core.A;
+			core.SetZN(core.Y);
+		} break;
+		case Operation::TSX:
+		{
+			core.X = core.SP;
+			core.SetZN(core.X);
+		} break;
+		case Operation::TXA:
+		{
+			core.A = core.X;
+			core.SetZN(core.A);
+		} break;
+		case Operation::TXS:
+		{
+			core.SP = core.X;
+		} break;
+		case Operation::TYA:
+		{
+			core.A = core.Y;
+			core.SetZN(core.A);
+		} break;
+#pragma endregion
+
+#pragma region PushPull_Operations
+		case Operation::PHA:
+		{
+			core.DataBus = core.A;
+			core.WriteMemoryFromDataBus();
+		} break;
+		case Operation::PHP:
+		{
+			core.SyncFlags();
+			core.DataBus = core.PS.Byte;
+			core.WriteMemoryFromDataBus();
+		} break;
+		case Operation::PLA:
+		{
+			SetRegister(core, core.A);
+		} break;
+		case Operation::PLP:
+		{
+			core.SetDataBusFromMemory();
+			core.DiscardFlags();
+			core.PS.Byte = core.DataBus;
+		} break;
+#pragma endregion
+
+#pragma region DecInc_Operations
+		case Operation::DEC: DecDB(core); break;
+		case Operation::INC: IncDB(core); break;
+
+		case Operation::DEX:
+		{
+			core.X--;
+			core.SetZN(core.X);
+		} break;
+		case Operation::INX:
+		{
+			core.X++;
+			core.SetZN(core.X);
+		} break;
+		case Operation::DEY:
+		{
+			core.Y--;
+			core.SetZN(core.Y);
+		} break;
+		case Operation::INY:
+		{
+			core.Y++;
+			core.SetZN(core.Y);
+		} break;
+#pragma endregion
+
+#pragma region Arithmetic_Operations
+		case Operation::ADC: AddA(core); break;
+		case Operation::SBC: SubA(core); break;
+#pragma endregion
+
+#pragma region Logical_Operations
+		case Operation::AND: AndA(core); break;
+		case Operation::ORA: OrA(core); break;
+		case Operation::EOR: ExclusiveOrA(core); break;
+
+		case Operation::ASL: ShiftLeftDB(core, false); break;
+		case Operation::ROL: ShiftLeftDB(core, true); break;
+		case Operation::LSR: ShiftRightDB(core, false); break;
+		case Operation::ROR: ShiftRightDB(core, true); break;
+#pragma endregion
+
+#pragma region Flag_Operations
+		case Operation::CLC: core.PS.Bits.C = 0; break;
+		case Operation::CLD: core.PS.Bits.D = 0; break;
+		case Operation::CLI: core.PS.Bits.I = 0; break;
+		case Operation::CLV: core.PS.Bits.V = 0; break;
+		case Operation::SEC: core.PS.Bits.C = 1; break;
+		case Operation::SED: core.PS.Bits.D = 1; break;
+		case Operation::SEI: core.PS.Bits.I = 1; break;
+#pragma endregion
+
+#pragma region Compare_Operations
+		case Operation::CMP: CompareRegister(core, core.A); break;
+		case Operation::CPX: CompareRegister(core, core.X); break;
+		case Operation::CPY: CompareRegister(core, core.Y); break;
+#pragma endregion
+
+#pragma region Other_Operations
+		case Operation::BIT: TestBit(core); break;
+		case Operation::NOP: break;
+#pragma endregion
+
+		default:
+			break;
+	}
+}
+
+template<typename Core>
+FORCE_INLINE void MicroOps<Core>::RunAccumulatorOperation(Core& core, Operation operation)
+{
+	switch (operation)
+	{
+		case Operation::ASL: ShiftLeftA(core, false); break;
+		case Operation::ROL: ShiftLeftA(core, true); break;
+		case Operation::LSR: ShiftRightA(core, false); break;
+		case Operation::ROR: ShiftRightA(core, true); break;
+		default: break;
+	}
+}
+
+template<typename Core>
+FORCE_INLINE bool MicroOps<Core>::IsBranchTaken(Core& core, Operation operation)
+{
+	core.SyncFlags();
+	return ALU::IsBranchTaken(operation, core.PS);
+}
+
+template<typename Core>
+void MicroOps<Core>::SetRegister(Core& core, BYTE& reg)
+{
+	core.SetDataBusFromMemory();
+	reg = core.DataBus;
+	core.SetZN(reg);
+}
+
+template<typename Core>
+void MicroOps<Core>::StoreRegister(Core& core, BYTE& reg)
+{
+	core.DataBus = reg;
+	core.WriteMemoryFromDataBus();
+}
+
+template<typename Core>
+void MicroOps<Core>::CompareRegister(Core& core, BYTE& reg)
+{
+	core.SetDataBusFromMemory();
+	core.DiscardFlags();
+	ALU::Compare(reg, core.PS, core.DataBus);
+}
+
+template<typename Core>
+void MicroOps<Core>::AddA(Core& core)
+{
+	core.SetDataBusFromMemory();
+	core.DiscardFlags();
+	ALU::Add(core.A, core.PS, core.DataBus);
+}
+
+template<typename Core>
+void MicroOps<Core>::SubA(Core& core)
+{
+	core.SetDataBusFromMemory();
+	core.DiscardFlags();
+	ALU::Sub(core.A, core.PS, core.DataBus);
+}
+
+template<typename Core>
+void MicroOps<Core>::AndA(Core& core)
+{
+	core.SetDataBusFromMemory();
+	core.A &= core.DataBus;
+	core.SetZN(core.A);
+}
+
+template<typename Core>
+void MicroOps<Core>::OrA(Core& core)
+{
+	core.SetDataBusFromMemory();
+	core.A |= core.DataBus;
+	core.SetZN(core.A);
+}
+
+template<typename Core>
+void MicroOps<Core>::ExclusiveOrA(Core& core)
+{
+	core.SetDataBusFromMemory();
+	core.A ^= core.DataBus;
+	core.SetZN(core.A);
+}
+
+template<typename Core>
+void MicroOps<Core>::ShiftLeftDB(Core& core, bool withC)
+{
+	core.DiscardFlags();
+	core.DataBus = ALU::ShiftLeft(core.PS, core.DataBus, withC);
+	core.WriteMemoryFromDataBus();
+}
+
+template<typename Core>
+void MicroOps<Core>::ShiftRightDB(Core& core, bool withC)
+{
+	core.DiscardFlags();
+	core.DataBus = ALU::ShiftRight(core.PS, core.DataBus, withC);
+	core.WriteMemoryFromDataBus();
+}
+
+template<typename Core>
+void MicroOps<Core>::ShiftLeftA(Core& core, bool withC)
+{
+	core.DiscardFlags();
+	core.A = ALU::ShiftLeft(core.PS, core.A, withC);
+}
+
+template<typename Core>
+void MicroOps<Core>::ShiftRightA(Core& core, bool withC)
+{
+	core.DiscardFlags();
+	core.A = ALU::ShiftRight(core.PS, core.A, withC);
+}
+
+template<typename Core>
+void MicroOps<Core>::DecDB(Core& core)
+{
+	core.DataBus--;
+	core.SetZN(core.DataBus);
+	core.WriteMemoryFromDataBus();
+}
+
+template<typename Core>
+void MicroOps<Core>::IncDB(Core& core)
+{
+	core.DataBus++;
+	core.SetZN(core.DataBus);
+	core.WriteMemoryFromDataBus();
+}
+
+template<typename Core>
+void MicroOps<Core>::TestBit(Core& core)
+{
+	core.SetDataBusFromMemory();
+	core.DiscardFlags();
+	ALU::TestBit(core.A, core.PS, core.DataBus);
+}
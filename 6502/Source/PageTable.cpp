@@ -0,0 +1,108 @@
+#include "PageTable.h"
+
+#include <algorithm>
+
+void PageTable::Map(Memory* SRAM, Memory* EEPROM, DeviceBus* IO)
+{
+	m_SRAM = SRAM;
+	m_EEPROM = EEPROM;
+	m_IO = IO;
+	m_SRAMGeneration = SRAM->GetGeneration();
+	m_EEPROMGeneration = EEPROM->GetGeneration();
+	m_IOGeneration = IO != nullptr ? IO->GetGeneration() : 0;
+
+	for (uint32_t i = 0; i < PAGE_COUNT; i++)
+	{
+		WORD first = (WORD)(i * PAGE_SIZE);
+
+		// Devices have priority over memory, and SRAM over EEPROM where they overlap
+		Memory* owner = nullptr;
+		for (uint32_t offset = 0; offset < PAGE_SIZE; offset++)
+		{
+			WORD address = first + offset;
+			Memory* memory = SRAM->IsAddressOk(address) ? SRAM : (EEPROM->IsAddressOk(address) ? EEPROM : nullptr);
+
+			if (offset == 0)
+				owner = memory;
+			else if (memory != owner)
+				owner = nullptr;
+
+			if (owner == nullptr)
+				break;
+		}
+
+		SetPage(m_Pages[i], owner, first);
+	}
+
+	for (Window& window : m_Windows)
+		MapWindow(window.Handle);
+}
+
+bool PageTable::IsOutdated(Memory* SRAM, Memory* EEPROM, DeviceBus* IO) const
+{
+	if (SRAM != m_SRAM || EEPROM != m_EEPROM || IO != m_IO
+		|| SRAM->GetGeneration() != m_SRAMGeneration || EEPROM->GetGeneration() != m_EEPROMGeneration
+		|| (IO != nullptr && IO->GetGeneration() != m_IOGeneration))
+		return true;
+
+	for (const Window& window : m_Windows)
+	{
+		if (window.Handle->GetSelectedMemory() != window.Bank || window.Bank->GetGeneration() != window.Generation)
+			return true;
+	}
+	return false;
+}
+
+void PageTable::AttachMapper(Mapper* mapper)
+{
+	m_Windows.push_back({ mapper, nullptr, 0 });
+	mapper->m_Pages = this;
+}
+
+void PageTable::DetachMapper(Mapper* mapper)
+{
+	auto window = std::find_if(m_Windows.begin(), m_Windows.end(), [mapper](const Window& window) { return window.Handle == mapper; });
+	if (window == m_Windows.end())
+		return;
+
+	m_Windows.erase(window);
+	mapper->m_Pages = nullptr;
+}
+
+void PageTable::MapWindow(Mapper* mapper)
+{
+	auto window = std::find_if(m_Windows.begin(), m_Windows.end(), [mapper](const Window& window) { return window.Handle == mapper; });
+	if (window == m_Windows.end() || m_SRAM == nullptr)
+		return;
+
+	Memory* bank = mapper->GetSelectedMemory();
+	window->Bank = bank;
+	window->Generation = bank->GetGeneration();
+
+	// Devices keep priority over the window, which backs the rest of their pages
+	for (uint32_t offset = 0; offset < mapper->GetSize(); offset += PAGE_SIZE)
+	{
+		WORD first = (WORD)(mapper->GetFirst() + offset);
+		Page& page = m_Pages[first >> 8];
+		SetPage(page, bank, first);
+		page.IsBanked = true;
+	}
+}
+
+void PageTable::SetPage(Page& page, Memory* owner, WORD first)
+{
+	if (m_IO != nullptr && m_IO->IsPageMapped(first))
+		page.Kind = PageKind::IO;
+	else if (owner != nullptr)
+		page.Kind = owner->IsROM() ? PageKind::ROM : PageKind::RAM;
+	else
+		page.Kind = PageKind::Mixed;
+
+	// IO pages keep their owner for the addresses no device claims, but no data to go around the devices
+	bool direct = owner != nullptr && page.Kind != PageKind::IO;
+	page.Data = direct ? owner->GetData() + (first - owner->GetZeroAddress()) : nullptr;
+	page.WritableData = direct && page.Kind == PageKind::RAM && !owner->IsShared() ? owner->GetWritableData() + (first - owner->GetZeroAddress()) : nullptr;
+	page.Generation = direct ? owner->GetPageGeneration(first) : nullptr;
+	page.Owner = owner;
+	page.IsBanked = false;
+}
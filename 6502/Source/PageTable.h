@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Base.h"
+#include "DeviceBus.h"
+#include "Mapper.h"
+#include "Memory.h"
+
+#include <array>
+#include <vector>
+
+enum class PageKind : BYTE
+{
+	Mixed,	// Unmapped, or shared between memories
+	RAM,
+	ROM,
+	IO		// Claimed by a device, at least in part
+};
+
+struct Page
+{
+	const BYTE* Data = nullptr;		// Start of the page when a single memory backs all of it, otherwise nullptr
+	BYTE* WritableData = nullptr;	// As Data for RAM pages only, so writes to ROM and shared images miss it
+	uint32_t* Generation = nullptr;	// Write counter of the page in its memory, set along with Data
+	Memory* Owner = nullptr;		// The memory backing all of the page, or on IO pages the addresses no device claims
+	PageKind Kind = PageKind::Mixed;
+	bool IsBanked = false;			// In a mapper window, what Data points to changes with the bank
+};
+
+// Maps each 256-byte page of the address space straight to its backing store.
+// RAM and ROM pages are read straight from their data, and RAM pages written
+// the same way: ROM is write-protected by having no writable data. Pages that
+// are unmapped, shared between memories or claimed by a device have no data
+// pointer and must be resolved through the devices and memories themselves.
+// Mapper windows lie over the memories, and switching their bank only remaps
+// the pages of the window.
+class PageTable
+{
+public:
+	PageTable() = default;
+	~PageTable() = default;
+
+	void Map(Memory* SRAM, Memory* EEPROM, DeviceBus* IO);
+	bool IsOutdated(Memory* SRAM, Memory* EEPROM, DeviceBus* IO) const;
+
+	// The pages only follow the windows from the next Map on
+	void AttachMapper(Mapper* mapper);
+	void DetachMapper(Mapper* mapper);
+	void MapWindow(Mapper* mapper);	// Points the window at the selected bank
+
+	inline const Page& GetPage(WORD address) const { return m_Pages[address >> 8]; }
+
+private:
+	struct Window
+	{
+		Mapper* Handle;
+		const Memory* Bank;		// As last mapped, nullptr until then
+		uint32_t Generation;
+	};
+
+	void SetPage(Page& page, Memory* owner, WORD first);
+
+	std::array<Page, PAGE_COUNT> m_Pages;
+	std::vector<Window> m_Windows;
+
+	Memory* m_SRAM = nullptr;
+	Memory* m_EEPROM = nullptr;
+	DeviceBus* m_IO = nullptr;
+	uint32_t m_SRAMGeneration = 0;
+	uint32_t m_EEPROMGeneration = 0;
+	uint32_t m_IOGeneration = 0;
+};
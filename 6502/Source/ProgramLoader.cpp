@@ -0,0 +1,409 @@
+#include "ProgramLoader.h"
+
+#include "Log.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+constexpr uint32_t MAX_RECORD_BYTES = 1 + 2 + 1 + 255 + 1;	// Largest Intel HEX record, S-records are shorter
+
+using RecordBytes = std::array<BYTE, MAX_RECORD_BYTES>;
+
+static int GetHexDigit(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+
+	return -1;
+}
+
+// Decodes the hex pairs of a record from first on, returns the number of bytes or -1 when malformed
+static int DecodeRecord(const std::string& line, size_t first, RecordBytes& bytes)
+{
+	size_t digits = line.size() - first;
+	if (digits % 2 != 0 || digits / 2 > bytes.size())
+		return -1;
+
+	for (size_t i = 0; i < digits / 2; i++)
+	{
+		int high = GetHexDigit(line[first + i * 2]);
+		int low = GetHexDigit(line[first + i * 2 + 1]);
+		if (high < 0 || low < 0)
+			return -1;
+		bytes[i] = (BYTE)((high << 4) | low);
+	}
+
+	return (int)(digits / 2);
+}
+
+static BYTE GetSum(const RecordBytes& bytes, int size)
+{
+	BYTE sum = 0;
+	for (int i = 0; i < size; i++)
+		sum += bytes[i];
+
+	return sum;
+}
+
+// Whether the line from start on is a record: the prefix, hex digits, then a line ending or the end of the input
+static bool IsRecordLine(std::istream& input, std::streampos start, size_t prefix)
+{
+	char line[2 + MAX_RECORD_BYTES * 2 + 2];
+	input.seekg(start);
+	input.read(line, sizeof(line));
+	size_t read = (size_t)input.gcount();
+	input.clear();
+
+	size_t end = prefix;
+	while (end < read && GetHexDigit(line[end]) >= 0)
+		end++;
+	if (end == prefix)
+		return false;
+
+	return end == read ? read < sizeof(line) : line[end] == '\r' || line[end] == '\n';
+}
+
+// Reads the next line without its line ending, counting it in the file bytes
+static bool ReadLine(std::istream& input, std::string& line, ProgramLoadStats& stats)
+{
+	if (!std::getline(input, line))
+		return false;
+
+	stats.FileBytes += line.size() + 1;
+	if (!line.empty() && line.back() == '\r')
+		line.pop_back();
+
+	return true;
+}
+
+ProgramLoader::ProgramLoader(Memory* SRAM, Memory* EEPROM)
+	: m_SRAM(SRAM), m_EEPROM(EEPROM)
+{
+}
+
+bool ProgramLoader::Load(const std::string& filepath, ProgramFormat format)
+{
+	std::ifstream file(filepath, std::ios::binary);
+	if (!file.is_open())
+	{
+		LOG_ERROR("Could not open {0}", filepath);
+		return false;
+	}
+
+	if (format == ProgramFormat::Detect)
+		format = DetectFormat(file);
+	if (format != ProgramFormat::Image)
+		return Load(file, format);
+
+	// Images are mapped rather than read
+	file.seekg(0, std::ios::end);
+	uint64_t size = (uint64_t)file.tellg();
+	if (size != m_EEPROM->GetSize())
+	{
+		LOG_ERROR("Loaded program must be of same size as the EEPROM ({0} KB)", m_EEPROM->GetSize() / 1024);
+		return false;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	m_Stats = {};
+	if (!m_EEPROM->LoadProgram(filepath.c_str()))
+		return false;
+	m_Stats.FileBytes = size;
+	m_Stats.BytesLoaded = size;
+	m_Stats.Records = 1;
+	m_Stats.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	LOG_INFO("Loaded {0} bytes in {1} records ({2:.1f} MB/s)", m_Stats.BytesLoaded, m_Stats.Records, m_Stats.GetMegabytesPerSecond());
+	return true;
+}
+
+bool ProgramLoader::Load(std::istream& input, ProgramFormat format)
+{
+	auto start = std::chrono::steady_clock::now();
+	m_Stats = {};
+
+	if (format == ProgramFormat::Detect)
+		format = DetectFormat(input);
+	bool loaded = LoadFormat(input, format);
+	m_Stats.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if (!loaded)
+		return false;
+
+	LOG_INFO("Loaded {0} bytes in {1} records ({2:.1f} MB/s)", m_Stats.BytesLoaded, m_Stats.Records, m_Stats.GetMegabytesPerSecond());
+	if (m_Stats.BytesSkipped > 0)
+		LOG_WARN("Skipped {0} bytes outside the accessible SRAM and EEPROM", m_Stats.BytesSkipped);
+	return true;
+}
+
+ProgramFormat ProgramLoader::DetectFormat(std::istream& input) const
+{
+	std::streampos start = input.tellg();
+	char first[sizeof(SEGMENTS_MAGIC)] = {};
+	input.read(first, sizeof(first));
+	std::streamsize read = input.gcount();
+
+	input.clear();
+	input.seekg(0, std::ios::end);
+	std::streamoff size = input.tellg() - start;
+
+	// Images may start with the same bytes, so the whole first line must be a record
+	ProgramFormat format = ProgramFormat::Unknown;
+	if (read >= 1 && first[0] == ':' && IsRecordLine(input, start, 1))
+		format = ProgramFormat::IntelHex;
+	else if (read >= 2 && first[0] == 'S' && first[1] >= '0' && first[1] <= '9' && IsRecordLine(input, start, 2))
+		format = ProgramFormat::SRecord;
+	else if (read == sizeof(SEGMENTS_MAGIC) && std::memcmp(first, SEGMENTS_MAGIC, sizeof(SEGMENTS_MAGIC)) == 0)
+		format = ProgramFormat::Segments;
+	else if (size == (std::streamoff)m_EEPROM->GetSize())
+		format = ProgramFormat::Image;
+
+	input.seekg(start);
+	return format;
+}
+
+bool ProgramLoader::LoadFormat(std::istream& input, ProgramFormat format)
+{
+	switch (format)
+	{
+	case ProgramFormat::IntelHex:	return LoadIntelHex(input);
+	case ProgramFormat::SRecord:	return LoadSRecord(input);
+	case ProgramFormat::Segments:	return LoadSegments(input);
+	case ProgramFormat::Image:		return LoadImage(input);
+	default:
+		LOG_ERROR("Unknown program format, it must be given explicitly");
+		return false;
+	}
+}
+
+bool ProgramLoader::LoadIntelHex(std::istream& input)
+{
+	std::string line;
+	RecordBytes record;
+	uint32_t base = 0;
+
+	for (uint32_t lineNumber = 1; ReadLine(input, line, m_Stats); lineNumber++)
+	{
+		if (line.empty())
+			continue;
+
+		// Length, address (2), type, data and checksum
+		int size = line[0] == ':' ? DecodeRecord(line, 1, record) : -1;
+		if (size < 5 || size != record[0] + 5)
+		{
+			LOG_ERROR("Malformed Intel HEX record on line {0}", lineNumber);
+			return false;
+		}
+		if (GetSum(record, size) != 0)
+		{
+			LOG_ERROR("Intel HEX checksum mismatch on line {0}", lineNumber);
+			return false;
+		}
+
+		uint32_t length = record[0];
+		const BYTE* data = &record[4];
+		switch (record[3])
+		{
+		case 0x00:
+			Write(base + ((record[1] << 8) | record[2]), data, length);
+			m_Stats.Records++;
+			break;
+		case 0x01:
+			return true;
+		case 0x02:
+		case 0x04:
+			if (length != 2)
+			{
+				LOG_ERROR("Malformed Intel HEX record on line {0}", lineNumber);
+				return false;
+			}
+			base = ((data[0] << 8) | data[1]) << (record[3] == 0x02 ? 4 : 16);
+			break;
+		case 0x03:
+		case 0x05:
+			break;	// Start address
+		default:
+			LOG_ERROR("Unknown Intel HEX record type {0} on line {1}", record[3], lineNumber);
+			return false;
+		}
+	}
+
+	LOG_WARN("Intel HEX file has no end of file record");
+	return true;
+}
+
+bool ProgramLoader::LoadSRecord(std::istream& input)
+{
+	// Address bytes of each record type, S4 is reserved
+	static constexpr uint32_t ADDRESS_BYTES[10] = { 2, 2, 3, 4, 0, 2, 3, 4, 3, 2 };
+
+	std::string line;
+	RecordBytes record;
+
+	for (uint32_t lineNumber = 1; ReadLine(input, line, m_Stats); lineNumber++)
+	{
+		if (line.empty())
+			continue;
+
+		// Count, address, data and checksum
+		int type = line.size() >= 2 && line[0] == 'S' ? line[1] - '0' : -1;
+		int size = type >= 0 && type <= 9 && type != 4 ? DecodeRecord(line, 2, record) : -1;
+		if (size < 1 || size != record[0] + 1 || record[0] < ADDRESS_BYTES[type] + 1)
+		{
+			LOG_ERROR("Malformed S-record on line {0}", lineNumber);
+			return false;
+		}
+		if (GetSum(record, size) != 0xFF)
+		{
+			LOG_ERROR("S-record checksum mismatch on line {0}", lineNumber);
+			return false;
+		}
+
+		if (type >= 7)
+			return true;	// Termination
+		if (type < 1 || type > 3)
+			continue;
+
+		uint32_t address = 0;
+		for (uint32_t i = 0; i < ADDRESS_BYTES[type]; i++)
+			address = (address << 8) | record[1 + i];
+
+		Write(address, &record[1 + ADDRESS_BYTES[type]], record[0] - ADDRESS_BYTES[type] - 1);
+		m_Stats.Records++;
+	}
+
+	return true;
+}
+
+bool ProgramLoader::LoadSegments(std::istream& input)
+{
+	char magic[sizeof(SEGMENTS_MAGIC)] = {};
+	input.read(magic, sizeof(magic));
+	m_Stats.FileBytes += input.gcount();
+	if (input.gcount() != sizeof(magic) || std::memcmp(magic, SEGMENTS_MAGIC, sizeof(magic)) != 0)
+	{
+		LOG_ERROR("Segments must start with their magic");
+		return false;
+	}
+
+	BYTE header[4];
+	while (input.read((char*)header, sizeof(header)))
+	{
+		m_Stats.FileBytes += sizeof(header);
+		m_Stats.Records++;
+
+		uint32_t address = header[0] | (header[1] << 8);
+		uint32_t length = header[2] | (header[3] << 8);
+
+		// The bytes are read straight into the memories
+		while (length > 0)
+		{
+			Memory* memory = nullptr;
+			uint32_t run = GetRun(address, length, memory);
+			if (memory != nullptr)
+			{
+				input.read((char*)memory->GetWritableRange((WORD)address, run), run);
+				m_Stats.BytesLoaded += input.gcount();
+			}
+			else
+			{
+				input.ignore(run);
+				m_Stats.BytesSkipped += input.gcount();
+			}
+
+			m_Stats.FileBytes += input.gcount();
+			if (input.gcount() != run)
+			{
+				LOG_ERROR("Segment ends early at address {0}", Log::WordToHexString(address + (uint32_t)input.gcount()));
+				return false;
+			}
+
+			address += run;
+			length -= run;
+		}
+	}
+
+	if (input.gcount() != 0)
+	{
+		LOG_ERROR("Segment header ends early");
+		return false;
+	}
+	return true;
+}
+
+bool ProgramLoader::LoadImage(std::istream& input)
+{
+	std::streampos start = input.tellg();
+	input.seekg(0, std::ios::end);
+	uint32_t size = (uint32_t)(input.tellg() - start);
+	input.seekg(start);
+
+	if (size != m_EEPROM->GetSize())
+	{
+		LOG_ERROR("Loaded program must be of same size as the EEPROM ({0} KB)", m_EEPROM->GetSize() / 1024);
+		return false;
+	}
+
+	if (!input.read((char*)m_EEPROM->GetWritableRange(m_EEPROM->GetZeroAddress(), size), size))
+	{
+		LOG_ERROR("Could not read the image");
+		return false;
+	}
+
+	m_Stats.FileBytes = size;
+	m_Stats.BytesLoaded = size;
+	m_Stats.Records = 1;
+	return true;
+}
+
+uint32_t ProgramLoader::GetRun(uint32_t address, uint32_t size, Memory*& memory) const
+{
+	memory = nullptr;
+	uint32_t end = address + size;
+
+	// SRAM comes first, so it keeps the addresses it shares with EEPROM
+	for (Memory* candidate : { m_SRAM, m_EEPROM })
+	{
+		uint32_t first = candidate->GetZeroAddress();
+		uint32_t last = first + candidate->GetSize();
+		if (address >= first && address < last)
+		{
+			if (memory == nullptr)
+			{
+				memory = candidate;
+				end = std::min(end, last);
+			}
+		}
+		else if (first > address)
+			end = std::min(end, first);
+	}
+
+	return end - address;
+}
+
+void ProgramLoader::Write(uint32_t address, const BYTE* data, uint32_t size)
+{
+	while (size > 0)
+	{
+		Memory* memory = nullptr;
+		uint32_t run = GetRun(address, size, memory);
+		if (memory != nullptr)
+		{
+			std::memcpy(memory->GetWritableRange((WORD)address, run), data, run);
+			m_Stats.BytesLoaded += run;
+		}
+		else
+			m_Stats.BytesSkipped += run;
+
+		address += run;
+		data += run;
+		size -= run;
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Base.h"
+#include "Memory.h"
+
+#include <istream>
+#include <string>
+
+// Program file formats:
+//
+// IntelHex  ":LLAAAATT<data>CC" lines, data (00), end of file (01), extended segment (02)
+//           and extended linear (04) address records. Start address records are ignored.
+// SRecord   "S<type><count><address><data><checksum>" lines, data with 16 (S1), 24 (S2) or
+//           32-bit (S3) addresses. Header, count and termination records are ignored.
+// Segments  Binary, the SEGMENTS_MAGIC bytes then the segments. Each segment is its origin
+//           (2 bytes) and length (2 bytes), both little-endian, followed by that many bytes.
+// Image     Binary image of the whole EEPROM, as loaded by Memory::LoadProgram.
+//
+// Detection looks for a first line of the text formats, ':' or "S<digit>" then only hex
+// digits, and the magic of segments. Other files are images when they have the size of the EEPROM, and of an
+// unknown format otherwise, which callers must then give explicitly.
+enum class ProgramFormat
+{
+	Detect,
+	IntelHex,
+	SRecord,
+	Segments,
+	Image,
+	Unknown
+};
+
+constexpr char SEGMENTS_MAGIC[4] = { '6', '5', 'S', 'G' };
+
+struct ProgramLoadStats
+{
+	uint64_t FileBytes = 0;
+	uint64_t BytesLoaded = 0;
+	uint64_t BytesSkipped = 0;	// Outside SRAM and EEPROM
+	uint32_t Records = 0;		// Data records or segments
+	double Seconds = 0;
+
+	inline double GetMegabytesPerSecond() const { return Seconds > 0 ? FileBytes / Seconds / (1024 * 1024) : 0; }
+};
+
+// Streams program files into the memories of a computer. Only the ranges the file
+// covers are written, straight into the memory holding them (SRAM over EEPROM where
+// they overlap), and records are decoded one at a time.
+class ProgramLoader
+{
+public:
+	ProgramLoader(Memory* SRAM, Memory* EEPROM);
+	~ProgramLoader() = default;
+
+	bool Load(const std::string& filepath, ProgramFormat format = ProgramFormat::Detect);
+	bool Load(std::istream& input, ProgramFormat format = ProgramFormat::Detect);	// The input must be seekable to detect the format
+
+	ProgramFormat DetectFormat(std::istream& input) const;
+	inline const ProgramLoadStats& GetStats() const { return m_Stats; }
+
+private:
+	bool LoadFormat(std::istream& input, ProgramFormat format);
+	bool LoadIntelHex(std::istream& input);
+	bool LoadSRecord(std::istream& input);
+	bool LoadSegments(std::istream& input);
+	bool LoadImage(std::istream& input);
+
+	// Length of the start of [address, address + size) held by a single memory, or by none
+	uint32_t GetRun(uint32_t address, uint32_t size, Memory*& memory) const;
+	void Write(uint32_t address, const BYTE* data, uint32_t size);
+
+	Memory* m_SRAM = nullptr;
+	Memory* m_EEPROM = nullptr;
+	ProgramLoadStats m_Stats;
+};
@@ -0,0 +1,464 @@
+#include "Recompiler.h"
+
+#include "Log.h"
+#include "OperationCodes.h"
+#include "StaticCode.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+	using M = MicroOp;
+
+	std::string Hex(uint64_t value, int digits)
+	{
+		char text[24];
+		std::snprintf(text, sizeof(text), "0x%0*llX", digits, (unsigned long long)value);
+		return text;
+	}
+
+	bool IsBranch(Operation op)
+	{
+		return op >= Operation::BCC && op <= Operation::BVS;
+	}
+
+	// Register an operation loads, stores or compares
+	const char* GetRegister(Operation op)
+	{
+		switch (op)
+		{
+			case Operation::LDX: case Operation::STX: case Operation::CPX: return "s.X";
+			case Operation::LDY: case Operation::STY: case Operation::CPY: return "s.Y";
+			case Operation::PHP: return "s.PS.Byte";
+			default: return "s.A";
+		}
+	}
+}
+
+Recompiler::Recompiler(const std::vector<BYTE>& image, WORD zeroAddress)
+	: m_Image(image), m_ZeroAddress(zeroAddress)
+{
+	if (m_ZeroAddress + m_Image.size() > 64 * 1024)
+	{
+		LOG_ERROR("The image does not fit in the address space from {0}", Log::WordToHexString(zeroAddress));
+		m_Image.resize(64 * 1024 - m_ZeroAddress);
+	}
+}
+
+void Recompiler::AddEntry(WORD address)
+{
+	m_Entries.push_back(address);
+}
+
+bool Recompiler::IsInImage(WORD address, uint32_t size) const
+{
+	return address >= m_ZeroAddress && uint32_t(address - m_ZeroAddress) + size <= m_Image.size();
+}
+
+bool Recompiler::IsTranslatable(WORD address) const
+{
+	if (!IsInImage(address))
+		return false;
+
+	const MicroProgram& program = MicroCode::GetProgram(GetByte(address));
+	return program.Length > 0 && program.Op != Operation::BRK && IsInImage(address, program.Bytes);
+}
+
+void Recompiler::Analyze()
+{
+	std::vector<WORD> pending = m_Entries;
+	for (WORD vector : { 0xFFFA, 0xFFFC, 0xFFFE })
+	{
+		if (IsInImage(vector, 2))
+			pending.push_back(GetByte(vector) | (GetByte(vector + 1) << 8));
+	}
+
+	std::set<WORD> visited;
+	while (!pending.empty())
+	{
+		WORD address = pending.back();
+		pending.pop_back();
+		if (!visited.insert(address).second)
+			continue;
+
+		if (!IsInImage(address))
+		{
+			m_ExternalTargets.insert(address);
+			continue;
+		}
+
+		RecompiledBlock block;
+		block.Address = address;
+		DecodeBlock(block);
+		if (block.Instructions == 0)
+			continue;
+
+		pending.insert(pending.end(), block.Targets.begin(), block.Targets.end());
+		m_Blocks[address] = block;
+	}
+
+	LOG_INFO("Found {0} blocks, {1} targets outside the image", m_Blocks.size(), m_ExternalTargets.size());
+}
+
+void Recompiler::DecodeBlock(RecompiledBlock& block) const
+{
+	WORD address = block.Address;
+	while (IsTranslatable(address))
+	{
+		BYTE opcode = GetByte(address);
+		const MicroProgram& program = MicroCode::GetProgram(opcode);
+		WORD next = address + program.Bytes;
+
+		block.Instructions++;
+		block.End = next;
+
+		if (IsBranch(program.Op))
+		{
+			block.Targets.push_back(WORD(next + (int8_t)GetByte(address + 1)));
+			block.Targets.push_back(next);
+			return;
+		}
+		switch (opcode)
+		{
+			case INS_JMP_ABS:
+				block.Targets.push_back(GetByte(address + 1) | (GetByte(address + 2) << 8));
+				return;
+			case INS_JSR_ABS:
+				block.Targets.push_back(GetByte(address + 1) | (GetByte(address + 2) << 8));
+				block.Targets.push_back(next);	// Where RTS comes back to
+				return;
+			case INS_JMP_IND:
+			case INS_RTS_IMP:
+			case INS_RTI_IMP:
+				return;
+			default:
+				break;
+		}
+
+		// Running off the end of the address space
+		if (next < address)
+			return;
+		address = next;
+	}
+}
+
+std::string Recompiler::Generate(const std::string& name, bool withRunner) const
+{
+	std::ostringstream out;
+	out << "// Translated by 6502_Recompiler, do not edit.\n";
+	out << "// " << m_Blocks.size() << " blocks from a " << m_Image.size() << " byte image at " << Hex(m_ZeroAddress, 4) << "\n\n";
+	out << "#include <StaticCode.h>\n";
+	if (withRunner)
+		out << "#include <Computer.h>\n#include <Log.h>\n\n#include <chrono>\n#include <cstdio>\n#include <cstdlib>\n";
+	out << "\nnamespace {\n\n";
+
+	std::vector<WORD> lastAddresses;
+	for (const auto& [address, block] : m_Blocks)
+	{
+		WORD lastAddress = block.End - 1;
+		GenerateBlock(out, block, lastAddress);
+		lastAddresses.push_back(lastAddress);
+	}
+
+	out << "\tconst StaticBlock s_Blocks[] = {\n";
+	uint32_t index = 0;
+	for (const auto& [address, block] : m_Blocks)
+	{
+		WORD lastAddress = lastAddresses[index++];
+		out << "\t\t{ " << Hex(address, 4) << ", " << Hex(address >> 8, 2) << ", " << Hex(lastAddress >> 8, 2) << ", Block_" << Hex(address, 4).substr(2) << " },\n";
+	}
+	if (m_Blocks.empty())
+		out << "\t\t{}\n";
+	out << "\t};\n}\n\n";
+
+	out << "extern const StaticProgram " << name << " = {\n";
+	out << "\t\"" << name << "\", " << Hex(m_ZeroAddress, 4) << ", " << m_Image.size() << ", "
+		<< Hex(HashImage(m_Image.data(), (uint32_t)m_Image.size()), 16) << "ull,\n";
+	out << "\ts_Blocks, " << m_Blocks.size() << "\n};\n";
+
+	if (withRunner)
+	{
+		out << "\n// " << name << " <image> [cycles]: runs the image from reset with the translated blocks\n";
+		out << "int main(int argc, char* argv[])\n{\n";
+		out << "\tif (argc < 2)\n\t{\n\t\tstd::printf(\"Usage: " << name << " <image> [cycles]\\n\");\n\t\treturn 1;\n\t}\n\n";
+		out << "\tLog::Init();\n";
+		out << "\tuint64_t cycles = argc > 2 ? std::strtoull(argv[2], nullptr, 0) : 100000000;\n\n";
+		out << "\tComputer computer(" << std::min<uint32_t>(m_ZeroAddress, 32 * 1024) << ", " << m_Image.size() << ");\n";
+		out << "\tcomputer.EEPROM->LoadProgram(argv[1]);\n";
+		out << "\tcomputer.CPU.AttachStaticProgram(&" << name << ");\n";
+		out << "\tcomputer.clock.SetSpeedMS(0);\n";
+		out << "\tcomputer.clock.Start();\n\n";
+		out << "\tauto start = std::chrono::steady_clock::now();\n";
+		out << "\tuint64_t run = computer.RunCycles(cycles);\n";
+		out << "\tdouble seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();\n\n";
+		out << "\tstd::printf(\"%llu cycles in %.3f s (%.1f MHz), PC=$%04X A=$%02X X=$%02X Y=$%02X\\n\", (unsigned long long)run, seconds,\n";
+		out << "\t\trun / seconds / 1e6, computer.CPU.PC, computer.CPU.A, computer.CPU.X, computer.CPU.Y);\n";
+		out << "\tLog::Shutdown();\n\treturn 0;\n}\n";
+	}
+
+	return out.str();
+}
+
+void Recompiler::GenerateBlock(std::ostringstream& out, const RecompiledBlock& block, WORD& lastAddress) const
+{
+	std::ostringstream body;
+	WORD address = block.Address;
+	Operation op = Operation::None;
+	for (uint32_t i = 0; i < block.Instructions; i++)
+	{
+		GenerateInstruction(body, block, address, lastAddress);
+		op = MicroCode::GetProgram(GetByte(address)).Op;
+		address += MicroCode::GetProgram(GetByte(address)).Bytes;
+	}
+
+	std::string code = body.str();
+	out << "\tvoid Block_" << Hex(block.Address, 4).substr(2) << "(StaticCPU& cpu)\n\t{\n";
+	out << "\t\tJitContext& s = cpu.State;\n";
+	if (code.find("goto entry;") != std::string::npos)
+		out << "\tentry:\n";
+	out << code;
+
+	// Blocks stopped by code left to the interpreter hand it the next PC
+	bool jumps = IsBranch(op) || op == Operation::JMP || op == Operation::JSR || op == Operation::RTS || op == Operation::RTI;
+	if (!jumps)
+		out << "\t\ts.PC = " << Hex(block.End, 4) << ";\n";
+	out << "\t}\n\n";
+}
+
+void Recompiler::GenerateInstruction(std::ostringstream& out, const RecompiledBlock& block, WORD address, WORD& lastAddress) const
+{
+	const BYTE opcode = GetByte(address);
+	const MicroProgram& program = MicroCode::GetProgram(opcode);
+	const OpcodeInfo& info = MicroCode::GetInfo(opcode);
+	const Operation op = program.Op;
+
+	out << "\t\t// " << Hex(address, 4).replace(0, 2, "$") << ":";
+	for (uint32_t i = 0; i < program.Bytes; i++)
+		out << " " << Hex(GetByte(address + i), 2).substr(2);
+	out << "  " << info.Mnemonic << "\n";
+
+	// The budget covers the longest path, the optional cycles are counted where they happen
+	out << "\t\tif (!cpu.Begin(" << Hex(address, 4) << ", " << program.Length + 1 << ")) return;\n";
+	out << "\t\ts.Cycles += " << (uint32_t)info.Cycles << ";\n";
+	out << "\t\t{\n";
+
+	const std::string indent = "\t\t\t";
+	auto line = [&](const std::string& text) { out << indent << text << "\n"; };
+	auto read = [&](const std::string& at) { line("if (!cpu.Read(" + at + ")) return;"); };
+	auto fetch = [&](WORD at)
+	{
+		// Bytes of the image are baked in, anything past it is read when run
+		if (!IsInImage(at))
+		{
+			read(Hex(at, 4));
+			return;
+		}
+		line("cpu.Fetch(" + Hex(at, 4) + ", " + Hex(GetByte(at), 2) + ");");
+		if (at > lastAddress)
+			lastAddress = at;
+	};
+
+	// Latches are constants while they come from the operand bytes
+	std::string ADL, ADH, BAL, BAH, IAL, IAH;
+	auto latch = [&](std::string& target, const char* local)
+	{
+		line(std::string("BYTE ") + local + " = s.DataBus;");
+		target = local;
+	};
+	auto word = [](const std::string& high, const std::string& low)
+	{
+		if (high.rfind("0x", 0) == 0 && low.rfind("0x", 0) == 0)
+			return Hex((std::stoul(high, nullptr, 16) << 8) | std::stoul(low, nullptr, 16), 4);
+		return "WORD(" + high + " << 8 | " + low + ")";
+	};
+
+	// What the operation does once the cycle put its address on the bus (immediate operands are already on the data bus)
+	auto operation = [&](const std::string& at, bool onDataBus)
+	{
+		const char* reg = GetRegister(op);
+		auto readOperand = [&]() { if (!onDataBus) read(at); };
+
+		switch (op)
+		{
+			case Operation::LDA: case Operation::LDX: case Operation::LDY: case Operation::PLA:
+				readOperand(); line(std::string("ALU::Load(") + reg + ", s.PS, s.DataBus);"); break;
+			case Operation::CMP: case Operation::CPX: case Operation::CPY:
+				readOperand(); line(std::string("ALU::Compare(") + reg + ", s.PS, s.DataBus);"); break;
+			case Operation::ADC: readOperand(); line("ALU::Add(s.A, s.PS, s.DataBus);"); break;
+			case Operation::SBC: readOperand(); line("ALU::Sub(s.A, s.PS, s.DataBus);"); break;
+			case Operation::AND: readOperand(); line("ALU::And(s.A, s.PS, s.DataBus);"); break;
+			case Operation::ORA: readOperand(); line("ALU::Or(s.A, s.PS, s.DataBus);"); break;
+			case Operation::EOR: readOperand(); line("ALU::ExclusiveOr(s.A, s.PS, s.DataBus);"); break;
+			case Operation::BIT: readOperand(); line("ALU::TestBit(s.A, s.PS, s.DataBus);"); break;
+			case Operation::PLP: readOperand(); line("s.PS.Byte = s.DataBus;"); break;
+
+			case Operation::STA: case Operation::STX: case Operation::STY: case Operation::PHA: case Operation::PHP:
+				line("if (!cpu.Write(" + at + ", " + reg + ")) return;"); break;
+
+			case Operation::ASL: line("if (!cpu.Write(s.AddressBus, ALU::ShiftLeft(s.PS, s.DataBus, false))) return;"); break;
+			case Operation::ROL: line("if (!cpu.Write(s.AddressBus, ALU::ShiftLeft(s.PS, s.DataBus, true))) return;"); break;
+			case Operation::LSR: line("if (!cpu.Write(s.AddressBus, ALU::ShiftRight(s.PS, s.DataBus, false))) return;"); break;
+			case Operation::ROR: line("if (!cpu.Write(s.AddressBus, ALU::ShiftRight(s.PS, s.DataBus, true))) return;"); break;
+			case Operation::DEC: line("if (!cpu.Write(s.AddressBus, ALU::Decrement(s.PS, s.DataBus))) return;"); break;
+			case Operation::INC: line("if (!cpu.Write(s.AddressBus, ALU::Increment(s.PS, s.DataBus))) return;"); break;
+
+			case Operation::TAX: line("ALU::Load(s.X, s.PS, s.A);"); break;
+			case Operation::TAY: line("ALU::Load(s.Y, s.PS, s.A);"); break;
+			case Operation::TSX: line("ALU::Load(s.X, s.PS, s.SP);"); break;
+			case Operation::TXA: line("ALU::Load(s.A, s.PS, s.X);"); break;
+			case Operation::TXS: line("s.SP = s.X;"); break;
+			case Operation::TYA: line("ALU::Load(s.A, s.PS, s.Y);"); break;
+
+			case Operation::DEX: line("ALU::Load(s.X, s.PS, s.X - 1);"); break;
+			case Operation::INX: line("ALU::Load(s.X, s.PS, s.X + 1);"); break;
+			case Operation::DEY: line("ALU::Load(s.Y, s.PS, s.Y - 1);"); break;
+			case Operation::INY: line("ALU::Load(s.Y, s.PS, s.Y + 1);"); break;
+
+			case Operation::CLC: line("s.PS.Bits.C = 0;"); break;
+			case Operation::CLD: line("s.PS.Bits.D = 0;"); break;
+			case Operation::CLI: line("s.PS.Bits.I = 0;"); break;
+			case Operation::CLV: line("s.PS.Bits.V = 0;"); break;
+			case Operation::SEC: line("s.PS.Bits.C = 1;"); break;
+			case Operation::SED: line("s.PS.Bits.D = 1;"); break;
+			case Operation::SEI: line("s.PS.Bits.I = 1;"); break;
+
+			default:
+				break;
+		}
+	};
+
+	auto jump = [&](WORD target)
+	{
+		line("s.PC = " + Hex(target, 4) + ";");
+		line(target == block.Address ? "goto entry;" : "return;");
+	};
+
+	WORD PC = address;
+	fetch(PC++);
+
+	for (uint32_t i = 0; i < program.Length; i++)
+	{
+		switch (program.Cycles[i])
+		{
+			case M::FetchADL: fetch(PC); ADL = Hex(GetByte(PC++), 2); break;
+			case M::FetchADH: fetch(PC); ADH = Hex(GetByte(PC++), 2); break;
+			case M::FetchBAL: fetch(PC); BAL = Hex(GetByte(PC++), 2); break;
+			case M::FetchBAH: fetch(PC); BAH = Hex(GetByte(PC++), 2); break;
+			case M::FetchIAL: fetch(PC); IAL = Hex(GetByte(PC++), 2); break;
+			case M::FetchIAH: fetch(PC); IAH = Hex(GetByte(PC), 2); break;
+			case M::FetchADHAndJump:
+			{
+				fetch(PC);
+				ADH = Hex(GetByte(PC), 2);
+				PC = (WORD)std::stoul(word(ADH, ADL), nullptr, 16);
+			} break;
+
+			case M::AddressBAL: line("s.AddressBus = " + BAL + ";"); break;
+			case M::ReadIndirectXADL: read("BYTE(" + BAL + " + s.X)"); latch(ADL, "adl"); break;
+			case M::ReadIndirectXADH: read("WORD(BYTE(" + BAL + " + s.X) + 1)"); latch(ADH, "adh"); break;
+			case M::ReadIndirectYBAL: read(IAL); latch(BAL, "bal"); break;
+			case M::ReadIndirectYBAH: read(Hex(std::stoul(IAL, nullptr, 16) + 1, 4)); latch(BAH, "bah"); break;
+			case M::ReadIndirectADL: read(word(IAH, IAL)); latch(ADL, "adl"); break;
+			case M::ReadIndirectADHAndJump:
+			{
+				read(Hex(WORD(std::stoul(word(IAH, IAL), nullptr, 16) + 1), 4));
+				line("s.PC = WORD(s.DataBus << 8 | " + ADL + ");");
+				line("return;");
+			} break;
+			case M::IndexAbsoluteX: line("WORD address = WORD(" + word(BAH, BAL) + " + s.X);"); line("s.AddressBus = address;"); break;
+			case M::IndexAbsoluteY: line("WORD address = WORD(" + word(BAH, BAL) + " + s.Y);"); line("s.AddressBus = address;"); break;
+
+			case M::OperandImmediate: fetch(PC++); operation("", true); break;
+			case M::OperandZeroPage: operation(ADL, false); break;
+			case M::OperandZeroPageX: operation("BYTE(" + BAL + " + s.X)", false); break;
+			case M::OperandZeroPageY: operation("BYTE(" + BAL + " + s.Y)", false); break;
+			case M::OperandAbsolute: operation(word(ADH, ADL), false); break;
+			case M::OperandAbsoluteX:
+			case M::OperandAbsoluteY:
+			{
+				// Stalls a cycle when indexing crosses a page, the page cross micro-op is folded in
+				const char* index = program.Cycles[i] == M::OperandAbsoluteX ? "s.X" : "s.Y";
+				line("WORD address = WORD(" + word(BAH, BAL) + " + " + index + ");");
+				line("if (" + BAL + " + " + index + " > 0xFF) s.Cycles++;");
+				operation("address", false);
+				i++;
+			} break;
+			case M::OperandAddressBus: operation("address", false); break;
+			case M::OperandImplied: fetch(PC); operation("", true); break;
+			case M::OperandAccumulator:
+			{
+				switch (op)
+				{
+					case Operation::ASL: line("s.A = ALU::ShiftLeft(s.PS, s.A, false);"); break;
+					case Operation::ROL: line("s.A = ALU::ShiftLeft(s.PS, s.A, true);"); break;
+					case Operation::LSR: line("s.A = ALU::ShiftRight(s.PS, s.A, false);"); break;
+					case Operation::ROR: line("s.A = ALU::ShiftRight(s.PS, s.A, true);"); break;
+					default: break;
+				}
+			} break;
+			case M::OperandModify: operation("s.AddressBus", true); break;
+			case M::OperandPush: operation("WORD(0x0100 | s.SP--)", false); break;
+			case M::OperandPull: operation("WORD(0x0100 | s.SP)", false); break;
+			case M::OperandBranch:
+			{
+				fetch(PC);
+				int target = PC + 1 + (int8_t)GetByte(PC);
+				PC++;
+				bool pageCross = (PC >> 8) != (target >> 8);
+
+				line(std::string("if (ALU::IsBranchTaken(Operation::") + info.Mnemonic + ", s.PS))");
+				line("{");
+				out << indent << "\ts.Cycles += " << (pageCross ? 2 : 1) << ";\n";
+				out << indent << "\ts.AddressBus = " << Hex(WORD(target), 4) << ";\n";
+				out << indent << "\ts.PC = " << Hex(WORD(target), 4) << ";\n";
+				out << indent << "\t" << (WORD(target) == block.Address ? "goto entry;" : "return;") << "\n";
+				line("}");
+				jump(PC);
+				i = program.Length;
+			} break;
+
+			case M::ReadZeroPage: read(ADL); break;
+			case M::ReadZeroPageX: read("BYTE(" + BAL + " + s.X)"); break;
+			case M::ReadAbsolute: read(word(ADH, ADL)); break;
+			case M::ReadAddressBus: read("address"); break;
+			case M::DummyWrite: line("s.DataRead = false;"); break;
+
+			case M::ReadPC: fetch(PC); break;
+			case M::IncrementPC: read("s.PC++"); break;
+			case M::ReadStack: read("WORD(0x0100 | s.SP)"); break;
+			case M::IncrementSP: read("WORD(0x0100 | s.SP++)"); break;
+			case M::PushPCH: line("if (!cpu.Write(WORD(0x0100 | s.SP--), " + Hex(PC >> 8, 2) + ")) return;"); break;
+			case M::PushPCL: line("if (!cpu.Write(WORD(0x0100 | s.SP--), " + Hex(PC & 0xFF, 2) + ")) return;"); break;
+			case M::PullPS:
+			{
+				read("WORD(0x0100 | s.SP++)");
+				line("s.PS.Byte = s.DataBus;");
+				line("s.PS.Bits.B = 0;");
+			} break;
+			case M::PullPCL: read("WORD(0x0100 | s.SP++)"); line("s.PC = s.DataBus;"); break;
+			case M::PullPCH: read("WORD(0x0100 | s.SP)"); line("s.PC |= WORD(s.DataBus << 8);"); break;
+
+			// BRK and the reset sequence never get here
+			default:
+				LOG_ERROR("Micro-op {0} cannot be translated", (int)program.Cycles[i]);
+				break;
+		}
+	}
+
+	switch (op)
+	{
+		case Operation::JMP:
+		case Operation::JSR:
+			if (opcode != INS_JMP_IND)
+				jump(PC);
+			break;
+		case Operation::RTS:
+		case Operation::RTI:
+			line("return;");
+			break;
+		default:
+			break;
+	}
+	out << "\t\t}\n";
+}
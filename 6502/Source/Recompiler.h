@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Base.h"
+#include "MicroCode.h"
+
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct RecompiledBlock
+{
+	WORD Address = 0;
+	WORD End = 0;					// Address following the last translated instruction
+	uint32_t Instructions = 0;
+	std::vector<WORD> Targets;		// Known successors, followed by the analysis
+};
+
+// Translates a ROM image ahead of time into a C++ translation unit holding one
+// function per basic block, see StaticCode.h for what the functions run on.
+//
+// Blocks are found by following control flow from the reset, NMI and IRQ vectors
+// (and any extra entries given). Targets only known at run time (RTS, RTI and
+// indirect jumps) are not followed, and neither is code outside the image: when
+// the CPU gets there the interpreter runs it. BRK and illegal opcodes are always
+// left to the interpreter.
+class Recompiler
+{
+public:
+	// The image is mapped from zeroAddress, as the EEPROM of a computer
+	Recompiler(const std::vector<BYTE>& image, WORD zeroAddress);
+	~Recompiler() = default;
+
+	void AddEntry(WORD address);
+	void Analyze();
+
+	// Writes the translation unit, defining a StaticProgram called name
+	std::string Generate(const std::string& name, bool withRunner = false) const;
+
+	inline const std::map<WORD, RecompiledBlock>& GetBlocks() const { return m_Blocks; }
+	inline const std::set<WORD>& GetExternalTargets() const { return m_ExternalTargets; }
+
+private:
+	bool IsInImage(WORD address, uint32_t size = 1) const;
+	inline BYTE GetByte(WORD address) const { return m_Image[address - m_ZeroAddress]; }
+	bool IsTranslatable(WORD address) const;
+
+	void DecodeBlock(RecompiledBlock& block) const;
+	void GenerateBlock(std::ostringstream& out, const RecompiledBlock& block, WORD& lastAddress) const;
+	void GenerateInstruction(std::ostringstream& out, const RecompiledBlock& block, WORD address, WORD& lastAddress) const;
+
+	std::vector<BYTE> m_Image;
+	WORD m_ZeroAddress = 0;
+
+	std::vector<WORD> m_Entries;
+	std::map<WORD, RecompiledBlock> m_Blocks;
+	std::set<WORD> m_ExternalTargets;	// Targets outside the image
+};
@@ -0,0 +1,57 @@
+#include "Scheduler.h"
+
+#include <algorithm>
+
+EventId Scheduler::Schedule(uint64_t cycle, EventCallback callback, const void* owner)
+{
+	EventId id = m_NextId++;
+	m_Events.push_back({ cycle, id, owner, std::move(callback) });
+	std::push_heap(m_Events.begin(), m_Events.end(), IsLater);
+	UpdateNextCycle();
+
+	return id;
+}
+
+bool Scheduler::Cancel(EventId id)
+{
+	auto it = std::find_if(m_Events.begin(), m_Events.end(), [id](const Event& event) { return event.Id == id; });
+	if (it == m_Events.end())
+		return false;
+
+	m_Events.erase(it);
+	Rebuild();
+	return true;
+}
+
+void Scheduler::CancelAll(const void* owner)
+{
+	m_Events.erase(std::remove_if(m_Events.begin(), m_Events.end(), [owner](const Event& event) { return event.Owner == owner; }), m_Events.end());
+	Rebuild();
+}
+
+void Scheduler::Clear()
+{
+	m_Events.clear();
+	UpdateNextCycle();
+}
+
+void Scheduler::RunDue(uint64_t cycle)
+{
+	while (!m_Events.empty() && m_Events.front().Cycle <= cycle)
+	{
+		// Taken out of the heap first, the callback may schedule or cancel events
+		std::pop_heap(m_Events.begin(), m_Events.end(), IsLater);
+		Event event = std::move(m_Events.back());
+		m_Events.pop_back();
+		UpdateNextCycle();
+
+		m_RunCount++;
+		event.Callback(event.Cycle);
+	}
+}
+
+void Scheduler::Rebuild()
+{
+	std::make_heap(m_Events.begin(), m_Events.end(), IsLater);
+	UpdateNextCycle();
+}
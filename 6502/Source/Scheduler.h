@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Base.h"
+
+#include <functional>
+#include <vector>
+
+using EventId = uint64_t;
+using EventCallback = std::function<void(uint64_t cycle)>;	// Called with the cycle the event was due at
+
+// Events due at given cycles, kept in a min-heap ordered by cycle and then by
+// scheduling order. An event runs before the first cycle following the one it
+// is due at, so runs stop at every deadline and the CPU sees whatever it did
+// (an interrupt raised, a device register changed). Events may schedule more
+// events, a periodic timer reschedules itself from its callback.
+class Scheduler
+{
+public:
+	Scheduler() = default;
+	~Scheduler() = default;
+
+	// The owner lets all the events of a device be cancelled when it is detached
+	EventId Schedule(uint64_t cycle, EventCallback callback, const void* owner = nullptr);
+	bool Cancel(EventId id);	// Returns false if the event already ran or was cancelled
+	void CancelAll(const void* owner);
+	void Clear();
+
+	// Runs every event due at or before cycle
+	inline void Run(uint64_t cycle)
+	{
+		if (cycle >= m_NextCycle)
+			RunDue(cycle);
+	}
+
+	inline uint64_t GetNextCycle() const { return m_NextCycle; }	// UINT64_MAX when nothing is scheduled
+	inline size_t GetPendingCount() const { return m_Events.size(); }
+	inline uint64_t GetRunCount() const { return m_RunCount; }
+
+private:
+	struct Event
+	{
+		uint64_t Cycle;
+		EventId Id;
+		const void* Owner;
+		EventCallback Callback;
+	};
+
+	// Orders the heap so the earliest event comes first, the first scheduled among equals
+	static inline bool IsLater(const Event& left, const Event& right) { return left.Cycle != right.Cycle ? left.Cycle > right.Cycle : left.Id > right.Id; }
+
+	void RunDue(uint64_t cycle);
+	void Rebuild();
+	inline void UpdateNextCycle() { m_NextCycle = m_Events.empty() ? UINT64_MAX : m_Events.front().Cycle; }
+
+	std::vector<Event> m_Events;	// Heap with the earliest event in front
+	EventId m_NextId = 1;
+	uint64_t m_NextCycle = UINT64_MAX;
+	uint64_t m_RunCount = 0;
+};
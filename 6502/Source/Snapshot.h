@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Base.h"
+#include "Mapper.h"
+
+#include <array>
+#include <atomic>
+
+// A consistent copy of the computer state, taken between cycles
+struct ComputerSnapshot
+{
+	uint64_t Cycles = 0;
+	uint64_t IdleCycles = 0;	// Skipped in idle loops, counted in Cycles
+	WORD PC = 0;
+	BYTE SP = 0, PS = 0;
+	BYTE A = 0, X = 0, Y = 0;
+
+	WORD AddressBus = 0;
+	BYTE DataBus = 0;
+	bool DataRead = true;
+
+	bool Running = false;
+	double AchievedHZ = 0;
+
+	std::array<BYTE, 64 * 1024> Memory = {};	// SRAM, EEPROM and banks as the CPU sees them, devices excluded
+	std::array<uint32_t, MAX_MAPPERS> Banks = {};	// Bank selected by each mapper, in attach order
+	uint32_t MapperCount = 0;
+};
+
+// Hands snapshots from one writer thread to one reader thread. With three
+// buffers the writer always has one to fill and the reader always has the
+// latest complete one, so neither side ever waits for the other.
+class SnapshotBuffer
+{
+private:
+	static constexpr BYTE INDEX_MASK = 0x03;
+	static constexpr BYTE NEW_DATA = BIT(2);	// Set when the middle buffer has not been read yet
+
+	std::array<ComputerSnapshot, 3> m_Buffers;
+	BYTE m_Back = 0;						// Owned by the writer
+	std::atomic<BYTE> m_Middle = 1;
+	BYTE m_Front = 2;						// Owned by the reader
+
+public:
+	SnapshotBuffer() = default;
+	~SnapshotBuffer() = default;
+
+	// Writer
+	inline ComputerSnapshot& GetBack() { return m_Buffers[m_Back]; }
+	inline void Publish() { m_Back = m_Middle.exchange(m_Back | NEW_DATA, std::memory_order_acq_rel) & INDEX_MASK; }
+
+	// Reader, the snapshot stays valid until the next call
+	inline const ComputerSnapshot& Read()
+	{
+		if (m_Middle.load(std::memory_order_relaxed) & NEW_DATA)
+			m_Front = m_Middle.exchange(m_Front, std::memory_order_acq_rel) & INDEX_MASK;
+
+		return m_Buffers[m_Front];
+	}
+};
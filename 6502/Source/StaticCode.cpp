@@ -0,0 +1,68 @@
+#include "StaticCode.h"
+
+#include "Log.h"
+
+StaticRunner::StaticRunner(const StaticProgram& program)
+	: m_Program(program)
+{
+	m_Entries.resize(64 * 1024, nullptr);
+	for (uint32_t i = 0; i < program.BlockCount; i++)
+		m_Entries[program.Blocks[i].Address] = &program.Blocks[i];
+}
+
+bool StaticRunner::Map(const PageTable& pages, Memory* EEPROM)
+{
+	m_Active = EEPROM->GetSize() == m_Program.ImageSize && EEPROM->GetZeroAddress() == m_Program.ZeroAddress
+		&& HashImage(EEPROM->GetData(), EEPROM->GetSize()) == m_Program.ImageHash;
+	if (!m_Active)
+	{
+		LOG_WARN("The EEPROM does not hold the image {0} was translated from, running interpreted.", m_Program.Name);
+		return false;
+	}
+
+	// Devices may cover parts of the image, and the code baked in stops matching a page once it is written
+	for (uint32_t i = 0; i < PAGE_COUNT; i++)
+	{
+		WORD first = (WORD)(i * PAGE_SIZE);
+		const Page& page = pages.GetPage(first);
+
+		m_Mapped[i] = EEPROM->IsAddressOk(first) && page.Data == EEPROM->GetData() + (first - m_Program.ZeroAddress);
+		m_Generations[i] = m_Mapped[i] ? *page.Generation : 0;
+	}
+	return true;
+}
+
+bool StaticRunner::IsCurrent(const StaticBlock& block, const PageTable& pages) const
+{
+	for (uint32_t i = block.FirstPage; i <= block.LastPage; i++)
+	{
+		if (!m_Mapped[i] || *pages.GetPage((WORD)(i * PAGE_SIZE)).Generation != m_Generations[i])
+			return false;
+	}
+	return true;
+}
+
+uint64_t StaticRunner::Run(JitContext& context, const PageTable& pages)
+{
+	if (!m_Active)
+		return 0;
+
+	StaticCPU cpu(context, pages);
+
+	uint64_t start = context.Cycles;
+	while (context.Cycles < context.CycleLimit)
+	{
+		const StaticBlock* block = m_Entries[context.PC];
+		if (block == nullptr || !IsCurrent(*block, pages))
+			break;
+
+		uint64_t cycles = context.Cycles;
+		block->Run(cpu);
+		m_BlockRuns++;
+
+		// The first instruction did not fit under the limit or needs the interpreter
+		if (context.Cycles == cycles)
+			break;
+	}
+	return context.Cycles - start;
+}
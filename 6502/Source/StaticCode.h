@@ -0,0 +1,139 @@
+#pragma once
+
+#include "ALU.h"
+#include "Base.h"
+#include "Jit.h"
+#include "Memory.h"
+#include "PageTable.h"
+
+#include <array>
+#include <vector>
+
+class StaticCPU;
+
+// A basic block translated ahead of time by the recompiler
+struct StaticBlock
+{
+	WORD Address = 0;
+	BYTE FirstPage = 0;		// Pages of the ROM image the block was translated from
+	BYTE LastPage = 0;
+	void (*Run)(StaticCPU& cpu) = nullptr;
+};
+
+// The blocks translated from one ROM image, only run while that image is in the EEPROM
+struct StaticProgram
+{
+	const char* Name = nullptr;
+	WORD ZeroAddress = 0;
+	uint32_t ImageSize = 0;
+	uint64_t ImageHash = 0;
+	const StaticBlock* Blocks = nullptr;
+	uint32_t BlockCount = 0;
+};
+
+// FNV-1a, identifies the image a program was translated from
+inline uint64_t HashImage(const BYTE* data, uint32_t size)
+{
+	uint64_t hash = 0xCBF29CE484222325ull;
+	for (uint32_t i = 0; i < size; i++)
+		hash = (hash ^ data[i]) * 0x100000001B3ull;
+	return hash;
+}
+
+// What translated code runs on. The operand bytes are baked into the code, only
+// data accesses go through the page table. An access the pages cannot serve
+// directly puts the state back as it was at the start of the instruction, which
+// the interpreter then runs instead.
+class StaticCPU
+{
+public:
+	JitContext& State;
+
+	StaticCPU(JitContext& state, const PageTable& pages)
+		: State(state), m_Pages(pages) {}
+
+	// Starts the instruction at PC unless it could end past the cycle limit
+	inline bool Begin(WORD PC, uint32_t maxCycles)
+	{
+		State.PC = PC;
+		if (State.Cycles + maxCycles > State.CycleLimit)
+			return false;
+
+		m_Start = State;
+		return true;
+	}
+
+	// A byte of the ROM image read at its address
+	inline void Fetch(WORD address, BYTE value)
+	{
+		State.AddressBus = address;
+		State.DataBus = value;
+		State.DataRead = true;
+	}
+
+	inline bool Read(WORD address)
+	{
+		const Page& page = m_Pages.GetPage(address);
+		if (page.Data == nullptr)
+			return Abort();
+
+		State.AddressBus = address;
+		State.DataBus = page.Data[address & 0xFF];
+		State.DataRead = true;
+		return true;
+	}
+
+	inline bool Write(WORD address, BYTE value)
+	{
+		const Page& page = m_Pages.GetPage(address);
+		if (page.WritableData == nullptr)
+			return Abort();
+
+		State.AddressBus = address;
+		State.DataBus = value;
+		State.DataRead = false;
+		page.WritableData[address & 0xFF] = value;
+		(*page.Generation)++;
+		return true;
+	}
+
+private:
+	inline bool Abort()
+	{
+		State = m_Start;
+		return false;
+	}
+
+	const PageTable& m_Pages;
+	JitContext m_Start;
+};
+
+// Runs the blocks of a static program from the PCs they start at
+class StaticRunner
+{
+public:
+	StaticRunner(const StaticProgram& program);
+	~StaticRunner() = default;
+
+	// Checks the EEPROM still holds the image, must be called whenever the page table is remapped
+	bool Map(const PageTable& pages, Memory* EEPROM);
+	inline bool IsActive() const { return m_Active; }
+
+	// Runs blocks from context.PC until it reaches code that was not translated or the
+	// cycle limit. Returns the number of cycles run.
+	uint64_t Run(JitContext& context, const PageTable& pages);
+
+	inline const StaticProgram& GetProgram() const { return m_Program; }
+	inline uint64_t GetBlockRuns() const { return m_BlockRuns; }
+
+private:
+	bool IsCurrent(const StaticBlock& block, const PageTable& pages) const;
+
+	const StaticProgram& m_Program;
+	std::vector<const StaticBlock*> m_Entries;		// Block per PC
+	std::array<uint32_t, PAGE_COUNT> m_Generations = {};
+	std::array<bool, PAGE_COUNT> m_Mapped = {};		// Pages still backed by the image
+	bool m_Active = false;
+
+	uint64_t m_BlockRuns = 0;
+};
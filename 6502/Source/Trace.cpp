@@ -0,0 +1,51 @@
+#include "Trace.h"
+
+#include "Log.h"
+
+#include <algorithm>
+
+TraceBuffer::TraceBuffer(uint32_t capacity)
+{
+	uint64_t size = 1;
+	while (size < capacity)
+		size <<= 1;
+
+	m_Slots = std::make_unique<Slot[]>(size);
+	m_Mask = size - 1;
+}
+
+std::vector<TraceRecord> TraceBuffer::Read(uint32_t count) const
+{
+	uint64_t head = m_Head.load(std::memory_order_acquire);
+	uint64_t first = head - std::min<uint64_t>({ head, GetCapacity(), count });
+
+	std::vector<TraceRecord> records;
+	records.reserve((size_t)(head - first));
+
+	// Records the producer overwrote while they were copied may be torn, drop them
+	for (uint64_t i = first; i < head; i++)
+	{
+		const Slot& slot = m_Slots[i & m_Mask];
+		uint64_t sequence = slot.Sequence.load(std::memory_order_acquire);
+		uint64_t cycle = slot.Cycle.load(std::memory_order_relaxed);
+		uint32_t bus = slot.Bus.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (sequence != i * 2 + 2 || slot.Sequence.load(std::memory_order_relaxed) != sequence)
+			continue;
+
+		records.push_back({ cycle, (WORD)bus, (BYTE)(bus >> 16), (bool)(bus >> 24) });
+	}
+
+	return records;
+}
+
+void TraceBuffer::Dump(uint32_t count) const
+{
+	for (const TraceRecord& record : Read(count))
+		PRINT_CPU("{0} - {1} {2}", Log::WordToHexString(record.Address), record.Read ? "\"r\"" : "\"W\"", Log::WordToHexString(record.Data));
+}
+
+void TraceBuffer::Clear()
+{
+	m_Head.store(0, std::memory_order_release);
+}
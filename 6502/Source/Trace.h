@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Base.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// One bus cycle as seen on the pins
+struct TraceRecord
+{
+	uint64_t Cycle;
+	WORD Address;
+	BYTE Data;
+	bool Read;		// RWB
+};
+
+// Keeps the most recent bus cycles as binary records. A single producer (the
+// CPU) pushes without locking or blocking; readers may copy the records out
+// from any thread and drop the ones overwritten while they were copying.
+class TraceBuffer
+{
+private:
+	// Each record is split into two words so it can be stored without tearing a single field.
+	// The sequence is odd while the slot is written and 2 * (record + 1) once it holds a record.
+	struct Slot
+	{
+		std::atomic<uint64_t> Sequence;
+		std::atomic<uint64_t> Cycle;
+		std::atomic<uint32_t> Bus;	// Address (0-15), data (16-23) and RWB (24)
+	};
+
+	std::unique_ptr<Slot[]> m_Slots;
+	uint64_t m_Mask;
+	std::atomic<uint64_t> m_Head = 0;	// Records pushed since the last clear
+
+public:
+	TraceBuffer(uint32_t capacity);		// Rounded up to a power of two
+	~TraceBuffer() = default;
+
+	inline void Push(uint64_t cycle, WORD address, BYTE data, bool read)
+	{
+		uint64_t head = m_Head.load(std::memory_order_relaxed);
+		Slot& slot = m_Slots[head & m_Mask];
+		slot.Sequence.store(head * 2 + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		slot.Cycle.store(cycle, std::memory_order_relaxed);
+		slot.Bus.store(address | (data << 16) | ((read ? 1u : 0u) << 24), std::memory_order_relaxed);
+		slot.Sequence.store(head * 2 + 2, std::memory_order_release);
+		m_Head.store(head + 1, std::memory_order_release);
+	}
+
+	// Copies up to count of the most recent records, oldest first
+	std::vector<TraceRecord> Read(uint32_t count) const;
+	// Formats up to count of the most recent records to the CPU logger
+	void Dump(uint32_t count) const;
+	void Clear();
+
+	inline uint64_t GetCapacity() const { return m_Mask + 1; }
+	inline uint64_t GetRecordCount() const { return m_Head.load(std::memory_order_acquire); }
+};
@@ -0,0 +1,320 @@
+#include "TraceFile.h"
+
+#include "CPU.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cstring>
+
+constexpr char TRACE_MAGIC[] = "6502TRC";
+constexpr char INDEX_MAGIC[] = "6502IDX";
+constexpr BYTE TRACE_VERSION = 1;
+
+constexpr uint32_t HEADER_SIZE = 16;
+constexpr uint32_t KEYFRAME_SIZE = 19;
+constexpr uint32_t INDEX_ENTRY_SIZE = 16;
+constexpr uint32_t INDEX_FOOTER_SIZE = 16;
+constexpr size_t WRITE_BUFFER_SIZE = 64 * 1024;
+
+constexpr BYTE TAG_READ = BIT(0);
+constexpr BYTE TAG_ADDRESS_SHIFT = 1;
+constexpr BYTE TAG_SAME_DATA = BIT(3);
+constexpr BYTE TAG_KEYFRAME = BIT(7);
+
+enum AddressEncoding : BYTE
+{
+	ADDRESS_NEXT = 0,
+	ADDRESS_SAME = 1,
+	ADDRESS_DELTA = 2,
+	ADDRESS_FULL = 3
+};
+
+static void PutLE(std::vector<BYTE>& buffer, uint64_t value, uint32_t bytes)
+{
+	for (uint32_t i = 0; i < bytes; i++)
+		buffer.push_back((BYTE)(value >> (i * 8)));
+}
+
+static uint64_t GetLE(const BYTE* data, uint32_t bytes)
+{
+	uint64_t value = 0;
+	for (uint32_t i = 0; i < bytes; i++)
+		value |= (uint64_t)data[i] << (i * 8);
+
+	return value;
+}
+
+#pragma region TraceWriter
+
+TraceWriter::~TraceWriter()
+{
+	Close();
+}
+
+bool TraceWriter::Open(const std::string& filepath, uint32_t keyframeInterval)
+{
+	Close();
+
+	m_File.open(filepath, std::ios::binary | std::ios::trunc);
+	if (!m_File.is_open())
+	{
+		LOG_ERROR("Could not open trace file {0}", filepath);
+		return false;
+	}
+
+	m_Buffer.clear();
+	m_Buffer.reserve(WRITE_BUFFER_SIZE + KEYFRAME_SIZE);
+	m_Index.clear();
+	m_Offset = 0;
+	m_WriteFailed = false;
+
+	m_Buffer.insert(m_Buffer.end(), TRACE_MAGIC, TRACE_MAGIC + 7);
+	m_Buffer.push_back(TRACE_VERSION);
+	PutLE(m_Buffer, keyframeInterval, 4);
+	PutLE(m_Buffer, 0, 4);
+
+	m_KeyframeInterval = keyframeInterval;
+	m_RecordsSinceKeyframe = keyframeInterval;	// The first record is always a keyframe
+	return true;
+}
+
+bool TraceWriter::Close()
+{
+	if (!IsOpen())
+		return !m_WriteFailed;
+
+	for (const auto& [cycle, offset] : m_Index)
+	{
+		PutLE(m_Buffer, cycle, 8);
+		PutLE(m_Buffer, offset, 8);
+	}
+	PutLE(m_Buffer, m_Index.size(), 8);
+	m_Buffer.insert(m_Buffer.end(), INDEX_MAGIC, INDEX_MAGIC + 7);
+	m_Buffer.push_back(TRACE_VERSION);
+
+	if (!Flush())
+		return false;
+
+	m_File.close();
+	if (m_File.fail())
+	{
+		LOG_ERROR("Could not finish writing the trace file");
+		m_WriteFailed = true;
+	}
+	return !m_WriteFailed;
+}
+
+void TraceWriter::Record(const CPU& cpu)
+{
+	if (!IsOpen())
+		return;
+
+	if (m_RecordsSinceKeyframe >= m_KeyframeInterval || cpu.Cycles != m_NextCycle)
+	{
+		WriteKeyframe(cpu);
+	}
+	else
+	{
+		BYTE tag = cpu.DataRead ? TAG_READ : 0;
+		int16_t delta = (int16_t)(WORD)(cpu.AddressBus - m_Address);
+
+		AddressEncoding encoding = ADDRESS_FULL;
+		if (delta == 1)
+			encoding = ADDRESS_NEXT;
+		else if (delta == 0)
+			encoding = ADDRESS_SAME;
+		else if (delta >= -128 && delta <= 127)
+			encoding = ADDRESS_DELTA;
+
+		tag |= encoding << TAG_ADDRESS_SHIFT;
+		if (cpu.DataBus == m_Data)
+			tag |= TAG_SAME_DATA;
+
+		m_Buffer.push_back(tag);
+		if (encoding == ADDRESS_DELTA)
+			m_Buffer.push_back((BYTE)delta);
+		else if (encoding == ADDRESS_FULL)
+			PutLE(m_Buffer, cpu.AddressBus, 2);
+		if (cpu.DataBus != m_Data)
+			m_Buffer.push_back(cpu.DataBus);
+	}
+
+	m_RecordsSinceKeyframe++;
+	m_NextCycle = cpu.Cycles + 1;
+	m_Address = cpu.AddressBus;
+	m_Data = cpu.DataBus;
+
+	if (m_Buffer.size() >= WRITE_BUFFER_SIZE)
+		Flush();
+}
+
+void TraceWriter::WriteKeyframe(const CPU& cpu)
+{
+	m_Index.emplace_back(cpu.Cycles, m_Offset + m_Buffer.size());
+
+	m_Buffer.push_back(TAG_KEYFRAME | (cpu.DataRead ? TAG_READ : 0));
+	PutLE(m_Buffer, cpu.Cycles, 8);
+	PutLE(m_Buffer, cpu.AddressBus, 2);
+	m_Buffer.push_back(cpu.DataBus);
+	PutLE(m_Buffer, cpu.PC, 2);
+	m_Buffer.push_back(cpu.SP);
+	m_Buffer.push_back(cpu.PS.Byte);
+	m_Buffer.push_back(cpu.A);
+	m_Buffer.push_back(cpu.X);
+	m_Buffer.push_back(cpu.Y);
+
+	m_RecordsSinceKeyframe = 0;
+}
+
+bool TraceWriter::Flush()
+{
+	m_File.write((const char*)m_Buffer.data(), m_Buffer.size());
+	m_Offset += m_Buffer.size();
+	m_Buffer.clear();
+
+	if (!m_File)
+	{
+		LOG_ERROR("Could not write the trace file, recording stopped at cycle {0}", m_NextCycle);
+		m_WriteFailed = true;
+		m_File.close();
+		return false;
+	}
+	return true;
+}
+
+#pragma endregion
+
+#pragma region TraceReader
+
+bool TraceReader::Open(const std::string& filepath)
+{
+	// Mapped where the platform allows, so only the pages decoded are read from disk
+	m_File = Memory::LoadImage(filepath.c_str());
+	if (!m_File)
+	{
+		// LoadImage has logged why, and the previous file is released
+		m_Data = nullptr;
+		m_Size = 0;
+		m_Index.clear();
+		return false;
+	}
+
+	return Open(m_File.GetData(), m_File.GetSize());
+}
+
+bool TraceReader::Open(const BYTE* data, size_t size)
+{
+	m_Data = data;
+	m_Size = size;
+	m_Index.clear();
+
+	if (size < HEADER_SIZE || std::memcmp(data, TRACE_MAGIC, 7) != 0 || data[7] != TRACE_VERSION)
+	{
+		LOG_ERROR("Not a version {0} trace file", TRACE_VERSION);
+		m_Size = 0;
+		return false;
+	}
+
+	if (!ReadIndex())
+	{
+		LOG_WARN("Trace file has no index (was it closed?), decoding will scan from the start");
+		m_RecordsEnd = m_Size;
+	}
+
+	return true;
+}
+
+bool TraceReader::ReadIndex()
+{
+	if (m_Size < HEADER_SIZE + INDEX_FOOTER_SIZE)
+		return false;
+
+	const BYTE* footer = m_Data + m_Size - INDEX_FOOTER_SIZE;
+	if (std::memcmp(footer + 8, INDEX_MAGIC, 7) != 0 || footer[15] != TRACE_VERSION)
+		return false;
+
+	uint64_t count = GetLE(footer, 8);
+	if (count > (m_Size - HEADER_SIZE - INDEX_FOOTER_SIZE) / INDEX_ENTRY_SIZE)
+		return false;
+
+	m_RecordsEnd = (size_t)(m_Size - INDEX_FOOTER_SIZE - count * INDEX_ENTRY_SIZE);
+	for (uint64_t i = 0; i < count; i++)
+	{
+		const BYTE* entry = m_Data + m_RecordsEnd + i * INDEX_ENTRY_SIZE;
+		m_Index.emplace_back(GetLE(entry, 8), GetLE(entry + 8, 8));
+	}
+
+	return true;
+}
+
+bool TraceReader::Decode(uint64_t first, uint64_t last, const std::function<void(const TraceRecord&)>& onRecord,
+	const std::function<void(const TraceKeyframe&)>& onKeyframe) const
+{
+	if (m_Size == 0)
+		return false;
+
+	// Start from the last keyframe at or before the first cycle
+	size_t position = HEADER_SIZE;
+	auto keyframe = std::upper_bound(m_Index.begin(), m_Index.end(), std::make_pair(first, UINT64_MAX));
+	if (keyframe != m_Index.begin())
+		position = (size_t)std::prev(keyframe)->second;
+
+	TraceRecord record = {};
+	bool synced = false;
+
+	while (position < m_RecordsEnd)
+	{
+		BYTE tag = m_Data[position++];
+
+		if (tag & TAG_KEYFRAME)
+		{
+			if (position + KEYFRAME_SIZE - 1 > m_RecordsEnd)
+				break;
+
+			const BYTE* data = m_Data + position;
+			TraceKeyframe frame = { GetLE(data, 8), (WORD)GetLE(data + 11, 2), data[13], data[14], data[15], data[16], data[17] };
+			record = { frame.Cycle, (WORD)GetLE(data + 8, 2), data[10], (bool)(tag & TAG_READ) };
+			position += KEYFRAME_SIZE - 1;
+			synced = true;
+
+			if (onKeyframe && frame.Cycle >= first && frame.Cycle <= last)
+				onKeyframe(frame);
+		}
+		else
+		{
+			if (!synced)
+			{
+				LOG_ERROR("Trace record at offset {0} has no keyframe before it", position - 1);
+				return false;
+			}
+
+			AddressEncoding encoding = (AddressEncoding)((tag >> TAG_ADDRESS_SHIFT) & 0x03);
+			size_t size = (encoding == ADDRESS_DELTA ? 1 : encoding == ADDRESS_FULL ? 2 : 0) + (tag & TAG_SAME_DATA ? 0 : 1);
+			if (position + size > m_RecordsEnd)
+				break;
+
+			switch (encoding)
+			{
+			case ADDRESS_NEXT:	record.Address++; break;
+			case ADDRESS_SAME:	break;
+			case ADDRESS_DELTA:	record.Address += (int8_t)m_Data[position++]; break;
+			case ADDRESS_FULL:	record.Address = (WORD)GetLE(m_Data + position, 2); position += 2; break;
+			}
+
+			if (!(tag & TAG_SAME_DATA))
+				record.Data = m_Data[position++];
+
+			record.Cycle++;
+			record.Read = tag & TAG_READ;
+		}
+
+		if (record.Cycle > last)
+			break;
+		if (record.Cycle >= first)
+			onRecord(record);
+	}
+
+	return true;
+}
+
+#pragma endregion
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Base.h"
+#include "Memory.h"
+#include "Trace.h"
+
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+class CPU;
+
+// Bus trace file layout, all values little-endian:
+//
+// Header   "6502TRC" + version (8 bytes), keyframe interval (4 bytes), reserved (4 bytes)
+// Record   tag, [address], [data]
+//          tag bit 0    RWB
+//          tag bit 1-2  address: 0 = previous + 1, 1 = previous, 2 = signed 8-bit delta, 3 = 16-bit address
+//          tag bit 3    data is the same as in the previous record (no data byte)
+//          Each record is one cycle after the previous one.
+// Keyframe tag 0x80 | RWB, cycle (8), address (2), data (1), PC (2), SP, PS, A, X, Y
+//          Starts the file, every keyframe interval records and every gap in the cycles.
+// Index    Cycle (8) and file offset (8) of every keyframe, keyframe count (8), "6502IDX" + version (8 bytes)
+//          Written on close, lets a reader seek without scanning the records.
+
+struct TraceKeyframe
+{
+	uint64_t Cycle;
+	WORD PC;
+	BYTE SP, PS;
+	BYTE A, X, Y;
+};
+
+// Streams the bus cycles of a CPU to a trace file
+class TraceWriter
+{
+private:
+	std::ofstream m_File;
+	std::vector<BYTE> m_Buffer;		// Flushed to the file when full
+	std::vector<std::pair<uint64_t, uint64_t>> m_Index;
+	uint64_t m_Offset = 0;			// File offset of the start of the buffer
+	bool m_WriteFailed = false;		// Recording stops at the first failed write
+
+	uint32_t m_KeyframeInterval = 0;
+	uint32_t m_RecordsSinceKeyframe = 0;
+	uint64_t m_NextCycle = 0;
+	WORD m_Address = 0;
+	BYTE m_Data = 0;
+
+public:
+	TraceWriter() = default;
+	~TraceWriter();
+
+	bool Open(const std::string& filepath, uint32_t keyframeInterval = 4096);
+	bool Close();	// Writes the keyframe index, returns false if any write to the file failed
+
+	void Record(const CPU& cpu);	// Records the bus cycle the CPU just ran
+
+	inline bool IsOpen() const { return m_File.is_open(); }
+
+private:
+	void WriteKeyframe(const CPU& cpu);
+	bool Flush();
+};
+
+// Decodes a trace file held in memory, e.g. read or mapped from disk
+class TraceReader
+{
+private:
+	MemoryImage m_File;
+	const BYTE* m_Data = nullptr;
+	size_t m_Size = 0;
+	size_t m_RecordsEnd = 0;		// Start of the index, or the end of the data
+	std::vector<std::pair<uint64_t, uint64_t>> m_Index;
+
+public:
+	TraceReader() = default;
+	~TraceReader() = default;
+
+	bool Open(const std::string& filepath);
+	bool Open(const BYTE* data, size_t size);	// The data must outlive the reader
+
+	// Calls onRecord for every cycle in [first, last], and onKeyframe for every keyframe on the way
+	bool Decode(uint64_t first, uint64_t last, const std::function<void(const TraceRecord&)>& onRecord,
+		const std::function<void(const TraceKeyframe&)>& onKeyframe = nullptr) const;
+
+	inline const std::vector<std::pair<uint64_t, uint64_t>>& GetIndex() const { return m_Index; }
+
+private:
+	bool ReadIndex();
+};
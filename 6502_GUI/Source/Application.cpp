@@ -1,8 +1,12 @@
 #include <Computer.h>
+#include <EmulationThread.h>
 #include <Log.h>
 
 #include <SFML/Graphics.hpp>
 
+#include <memory>
+#include <string>
+
 #define PROGRAM_LENGTH(prg) sizeof(prg) / sizeof(BYTE)
 
 constexpr uint32_t SRAM_MEMORY = 32 * 1024;
@@ -12,38 +16,76 @@ constexpr uint32_t EEPROM_MEMORY = 16 * 1024;
 // $8000 -> $BFFF : free addresses (e.g. for I/O)
 // $C000 -> $FFFF : EEPROM
 
+// Space : start/stop
+// S     : step one cycle (while stopped)
+// Up    : speed x10
+// Down  : speed /10
+
 int main()
 {
 	Log::Init();
 
 	Computer* computer = new Computer(SRAM_MEMORY, EEPROM_MEMORY);
-	computer->EEPROM->LoadProgram("C:\\Dev\\6502\\6502_Tests\\TestPrograms\\program7.out");
-	computer->clock.SetSpeedMS(20);
+	uint32_t speed = 50;
+
+	// From here on the computer belongs to the emulation thread
+	auto emulator = std::make_unique<EmulationThread>(computer);
+	emulator->LoadProgram("C:\\Dev\\6502\\6502_Tests\\TestPrograms\\program7.out");
+	emulator->SetSpeedHZ(speed);
 
 	sf::RenderWindow window(sf::VideoMode(1280, 720), "Hello World");
+	window.setVerticalSyncEnabled(true);
 
 	sf::CircleShape shape(200);
 	shape.setFillColor(sf::Color(100, 200, 50));
 	
-	computer->clock.Start();
+	emulator->Start();
 	
 	while (window.isOpen()) 
 	{
 		sf::Event event;
+
+		const ComputerSnapshot& snapshot = emulator->ReadSnapshot();
+		window.setTitle("6502 - PC " + Log::WordToHexString(snapshot.PC) + " A " + Log::WordToHexString(snapshot.A)
+			+ " X " + Log::WordToHexString(snapshot.X) + " Y " + Log::WordToHexString(snapshot.Y)
+			+ " - " + std::to_string((uint64_t)snapshot.AchievedHZ) + " / " + std::to_string(speed) + " Hz"
+			+ (snapshot.Running ? "" : " (stopped)"));
 		
 		window.clear();
 		window.draw(shape);
 		window.display();
 
-		computer->RunCycle();
-
 		while (window.pollEvent(event))
 		{
 			if (event.type == sf::Event::Closed)
 				window.close();
+
+			if (event.type != sf::Event::KeyPressed)
+				continue;
+
+			switch (event.key.code)
+			{
+			case sf::Keyboard::Space:
+				snapshot.Running ? emulator->Stop() : emulator->Start();
+				break;
+			case sf::Keyboard::S:
+				emulator->Step();
+				break;
+			case sf::Keyboard::Up:
+				speed = speed <= 100000000 ? speed * 10 : speed;
+				emulator->SetSpeedHZ(speed);
+				break;
+			case sf::Keyboard::Down:
+				speed = speed >= 10 ? speed / 10 : speed;
+				emulator->SetSpeedHZ(speed);
+				break;
+			default:
+				break;
+			}
 		}
 	}
 
+	emulator.reset();
 	delete computer;
 
 	Log::Shutdown();
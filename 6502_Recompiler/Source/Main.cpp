@@ -0,0 +1,90 @@
+#include <Log.h>
+#include <Memory.h>
+#include <Recompiler.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+// Translates an EEPROM image into a C++ translation unit defining a StaticProgram,
+// to be linked with the 6502 library and attached with CPU::AttachStaticProgram
+//
+// 6502_Recompiler <image> <output.cpp> [--name <name>] [--zero <address>] [--entry <address>]... [--runner]
+//   --name    name of the StaticProgram defined (StaticFirmware by default)
+//   --zero    address the image is mapped from (by default it ends at $FFFF)
+//   --entry   extra code address to translate from, besides the vectors
+//   --runner  also writes a main() running the image, for a dedicated native runner
+
+static void PrintUsage()
+{
+	std::printf("Usage: 6502_Recompiler <image> <output.cpp> [--name <name>] [--zero <address>] [--entry <address>]... [--runner]\n");
+}
+
+int main(int argc, char* argv[])
+{
+	Log::Init();
+
+	const char* imagePath = nullptr;
+	const char* outputPath = nullptr;
+	std::string name = "StaticFirmware";
+	long zeroAddress = -1;
+	std::vector<WORD> entries;
+	bool withRunner = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+		if (std::strcmp(argv[i], "--runner") == 0)
+			withRunner = true;
+		else if (std::strcmp(argv[i], "--name") == 0 && hasValue)
+			name = argv[++i];
+		else if (std::strcmp(argv[i], "--zero") == 0 && hasValue)
+			zeroAddress = std::strtol(argv[++i], nullptr, 0);
+		else if (std::strcmp(argv[i], "--entry") == 0 && hasValue)
+			entries.push_back((WORD)std::strtoul(argv[++i], nullptr, 0));
+		else if (imagePath == nullptr)
+			imagePath = argv[i];
+		else if (outputPath == nullptr)
+			outputPath = argv[i];
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	if (imagePath == nullptr || outputPath == nullptr)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	MemoryImage image = Memory::LoadImage(imagePath);
+	if (!image)
+		return 1;
+	if (image.GetSize() == 0 || image.GetSize() > 64 * 1024)
+	{
+		LOG_ERROR("{0} is not an EEPROM image", imagePath);
+		return 1;
+	}
+	if (zeroAddress < 0)
+		zeroAddress = 64 * 1024 - (long)image.GetSize();
+
+	Recompiler recompiler(std::vector<BYTE>(image.GetData(), image.GetData() + image.GetSize()), (WORD)zeroAddress);
+	for (WORD entry : entries)
+		recompiler.AddEntry(entry);
+	recompiler.Analyze();
+
+	std::ofstream output(outputPath);
+	if (!output.is_open())
+	{
+		LOG_ERROR("Could not open {0}", outputPath);
+		return 1;
+	}
+	output << recompiler.Generate(name, withRunner);
+
+	Log::Shutdown();
+	return 0;
+}
@@ -56,20 +56,17 @@ protected:
 		MCU->clock.Start();
 
 		int32_t cycles = -8;	// -8 for reset cycles
-		while (!(MCU->EEPROM->ReadByte(MCU->CPU.PC) == 0xEA
-			&& MCU->EEPROM->ReadByte(MCU->CPU.PC + 1) == 0xEA
-			&& MCU->CPU.m_InstructionQueue.empty()))
-		{
-			cycles++;
-			MCU->RunCycle();
-		}
+		cycles += (int32_t)MCU->RunUntil([](Computer& computer)
+			{
+				return computer.EEPROM->ReadByte(computer.CPU.PC) == 0xEA
+					&& computer.EEPROM->ReadByte(computer.CPU.PC + 1) == 0xEA;
+			});
 
 		return cycles;
 	}
 
 	void RunCycles(int32_t quantity)
 	{
-		for (int i = 0; i < quantity; i++)
-			MCU->RunCycle();
+		MCU->RunCycles(quantity);
 	}
 };
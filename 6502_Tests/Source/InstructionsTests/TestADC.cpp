@@ -353,4 +353,49 @@ TEST_F(ADCTest, ADCIndirectYWithPageCrossing)
 	EXPECT_EQ(MCU->CPU.PS.Bits.V, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.N, 0);
 	EXPECT_EQ(cycles, 6);
-}
\ No newline at end of file
+}
+
+TEST_F(ADCTest, ADCImmediateDecimal)
+{
+	BYTE program[] = {
+		0x69, 0x46
+	};
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+	MCU->CPU.A = 0x58;
+	MCU->CPU.PS.Bits.C = 1;
+	MCU->CPU.PS.Bits.D = 1;
+
+	int32_t cycles = RunTestProgram();
+
+	EXPECT_EQ(MCU->CPU.A, 0x05);
+	EXPECT_EQ(MCU->CPU.PS.Bits.C, 1);
+	EXPECT_EQ(MCU->CPU.PS.Bits.Z, 0);
+	EXPECT_EQ(cycles, 2);
+}
+
+TEST_F(ADCTest, ADCImmediateDecimalFlags)
+{
+	BYTE program[] = {
+		0x69, 0x01,		// $99 + $01
+		0x69, 0x00		// $79 + $00 + carry
+	};
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+	MCU->CPU.A = 0x99;
+	MCU->CPU.PS.Bits.C = 0;
+	MCU->CPU.PS.Bits.D = 1;
+
+	// Z follows the binary sum ($9A) and N the sum before the high digit is adjusted ($A0)
+	RunCycles(8 + 2);
+	EXPECT_EQ(MCU->CPU.A, 0x00);
+	EXPECT_EQ(MCU->CPU.PS.Bits.C, 1);
+	EXPECT_EQ(MCU->CPU.PS.Bits.Z, 0);
+	EXPECT_EQ(MCU->CPU.PS.Bits.N, 1);
+	EXPECT_EQ(MCU->CPU.PS.Bits.V, 0);
+
+	MCU->CPU.A = 0x79;
+	RunCycles(2);
+	EXPECT_EQ(MCU->CPU.A, 0x80);
+	EXPECT_EQ(MCU->CPU.PS.Bits.C, 0);
+	EXPECT_EQ(MCU->CPU.PS.Bits.N, 1);
+	EXPECT_EQ(MCU->CPU.PS.Bits.V, 1);
+}
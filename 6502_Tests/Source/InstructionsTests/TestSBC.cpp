@@ -9,12 +9,12 @@ TEST_F(SBCTest, SBCImmediate)
 	};
 	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
 	MCU->CPU.A = 0x42;
-	MCU->CPU.PS.Bits.C = 0;
+	MCU->CPU.PS.Bits.C = 1;
 
 	int32_t cycles = RunTestProgram();
 
 	EXPECT_EQ(MCU->CPU.A, 0x20);
-	EXPECT_EQ(MCU->CPU.PS.Bits.C, 0);
+	EXPECT_EQ(MCU->CPU.PS.Bits.C, 1);
 	EXPECT_EQ(MCU->CPU.PS.Bits.Z, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.V, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.N, 0);
@@ -28,31 +28,31 @@ TEST_F(SBCTest, SBCImmediateWithZero)
 	};
 	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
 	MCU->CPU.A = 0x00;
-	MCU->CPU.PS.Bits.C = 0;
+	MCU->CPU.PS.Bits.C = 1;
 
 	int32_t cycles = RunTestProgram();
 
 	EXPECT_EQ(MCU->CPU.A, 0x00);
-	EXPECT_EQ(MCU->CPU.PS.Bits.C, 0);
+	EXPECT_EQ(MCU->CPU.PS.Bits.C, 1);
 	EXPECT_EQ(MCU->CPU.PS.Bits.Z, 1);
 	EXPECT_EQ(MCU->CPU.PS.Bits.V, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.N, 0);
 	EXPECT_EQ(cycles, 2);
 }
 
-TEST_F(SBCTest, SBCImmediateWithCarry)
+TEST_F(SBCTest, SBCImmediateWithBorrow)
 {
 	BYTE program[] = {
 		0xE9, 0xFF
 	};
 	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
 	MCU->CPU.A = 0x22;
-	MCU->CPU.PS.Bits.C = 0;
+	MCU->CPU.PS.Bits.C = 1;
 
 	int32_t cycles = RunTestProgram();
 
 	EXPECT_EQ(MCU->CPU.A, 0x23);
-	EXPECT_EQ(MCU->CPU.PS.Bits.C, 1);
+	EXPECT_EQ(MCU->CPU.PS.Bits.C, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.Z, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.V, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.N, 0);
@@ -66,31 +66,31 @@ TEST_F(SBCTest, SBCImmediateWithOverflow)
 	};
 	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
 	MCU->CPU.A = 0x82;
-	MCU->CPU.PS.Bits.C = 0;
+	MCU->CPU.PS.Bits.C = 1;
 
 	int32_t cycles = RunTestProgram();
 
 	EXPECT_EQ(MCU->CPU.A, 0x40);
-	EXPECT_EQ(MCU->CPU.PS.Bits.C, 0);
+	EXPECT_EQ(MCU->CPU.PS.Bits.C, 1);
 	EXPECT_EQ(MCU->CPU.PS.Bits.Z, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.V, 1);
 	EXPECT_EQ(MCU->CPU.PS.Bits.N, 0);
 	EXPECT_EQ(cycles, 2);
 }
 
-TEST_F(SBCTest, SBCImmediateWithCarryAndOverflow)
+TEST_F(SBCTest, SBCImmediateWithBorrowAndOverflow)
 {
 	BYTE program[] = {
 		0xE9, 0x86
 	};
 	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
 	MCU->CPU.A = 0x76;
-	MCU->CPU.PS.Bits.C = 0;
+	MCU->CPU.PS.Bits.C = 1;
 
 	int32_t cycles = RunTestProgram();
 
 	EXPECT_EQ(MCU->CPU.A, 0xF0);
-	EXPECT_EQ(MCU->CPU.PS.Bits.C, 1);
+	EXPECT_EQ(MCU->CPU.PS.Bits.C, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.Z, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.V, 1);
 	EXPECT_EQ(MCU->CPU.PS.Bits.N, 1);
@@ -105,12 +105,12 @@ TEST_F(SBCTest, SBCZeroPage)
 	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
 	MCU->SRAM->WriteByte(0x35, 0x42);
 	MCU->CPU.A = 0x92;
-	MCU->CPU.PS.Bits.C = 0;
+	MCU->CPU.PS.Bits.C = 1;
 
 	int32_t cycles = RunTestProgram();
 
 	EXPECT_EQ(MCU->CPU.A, 0x50);
-	EXPECT_EQ(MCU->CPU.PS.Bits.C, 0);
+	EXPECT_EQ(MCU->CPU.PS.Bits.C, 1);
 	EXPECT_EQ(MCU->CPU.PS.Bits.Z, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.V, 1);
 	EXPECT_EQ(MCU->CPU.PS.Bits.N, 0);
@@ -126,12 +126,12 @@ TEST_F(SBCTest, SBCZeroPageX)
 	MCU->SRAM->WriteByte(0x38, 0x42);
 	MCU->CPU.A = 0x62;
 	MCU->CPU.X = 0x03;
-	MCU->CPU.PS.Bits.C = 0;
+	MCU->CPU.PS.Bits.C = 1;
 
 	int32_t cycles = RunTestProgram();
 
 	EXPECT_EQ(MCU->CPU.A, 0x20);
-	EXPECT_EQ(MCU->CPU.PS.Bits.C, 0);
+	EXPECT_EQ(MCU->CPU.PS.Bits.C, 1);
 	EXPECT_EQ(MCU->CPU.PS.Bits.Z, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.V, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.N, 0);
@@ -147,12 +147,12 @@ TEST_F(SBCTest, SBCZeroPageXWithPageCrossing)
 	MCU->SRAM->WriteByte(0x34, 0x42);
 	MCU->CPU.A = 0x22;
 	MCU->CPU.X = 0xFF;
-	MCU->CPU.PS.Bits.C = 0;
+	MCU->CPU.PS.Bits.C = 1;
 
 	int32_t cycles = RunTestProgram();
 
 	EXPECT_EQ(MCU->CPU.A, 0xE0);
-	EXPECT_EQ(MCU->CPU.PS.Bits.C, 1);
+	EXPECT_EQ(MCU->CPU.PS.Bits.C, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.Z, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.V, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.N, 1);
@@ -167,12 +167,12 @@ TEST_F(SBCTest, SBCAbsolute)
 	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
 	MCU->SRAM->WriteByte(0x3735, 0x42);
 	MCU->CPU.A = 0x62;
-	MCU->CPU.PS.Bits.C = 0;
+	MCU->CPU.PS.Bits.C = 1;
 
 	int32_t cycles = RunTestProgram();
 
 	EXPECT_EQ(MCU->CPU.A, 0x20);
-	EXPECT_EQ(MCU->CPU.PS.Bits.C, 0);
+	EXPECT_EQ(MCU->CPU.PS.Bits.C, 1);
 	EXPECT_EQ(MCU->CPU.PS.Bits.Z, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.V, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.N, 0);
@@ -188,12 +188,12 @@ TEST_F(SBCTest, SBCAbsoluteX)
 	MCU->SRAM->WriteByte(0x3738, 0x42);
 	MCU->CPU.A = 0x62;
 	MCU->CPU.X = 0x03;
-	MCU->CPU.PS.Bits.C = 0;
+	MCU->CPU.PS.Bits.C = 1;
 
 	int32_t cycles = RunTestProgram();
 
 	EXPECT_EQ(MCU->CPU.A, 0x20);
-	EXPECT_EQ(MCU->CPU.PS.Bits.C, 0);
+	EXPECT_EQ(MCU->CPU.PS.Bits.C, 1);
 	EXPECT_EQ(MCU->CPU.PS.Bits.Z, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.V, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.N, 0);
@@ -209,12 +209,12 @@ TEST_F(SBCTest, SBCAbsoluteXWithPageCrossing)
 	MCU->SRAM->WriteByte(0x3834, 0x42);
 	MCU->CPU.A = 0x62;
 	MCU->CPU.X = 0xFF;
-	MCU->CPU.PS.Bits.C = 0;
+	MCU->CPU.PS.Bits.C = 1;
 
 	int32_t cycles = RunTestProgram();
 
 	EXPECT_EQ(MCU->CPU.A, 0x20);
-	EXPECT_EQ(MCU->CPU.PS.Bits.C, 0);
+	EXPECT_EQ(MCU->CPU.PS.Bits.C, 1);
 	EXPECT_EQ(MCU->CPU.PS.Bits.Z, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.V, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.N, 0);
@@ -230,12 +230,12 @@ TEST_F(SBCTest, SBCAbsoluteY)
 	MCU->SRAM->WriteByte(0x3738, 0x42);
 	MCU->CPU.A = 0x62;
 	MCU->CPU.Y = 0x03;
-	MCU->CPU.PS.Bits.C = 0;
+	MCU->CPU.PS.Bits.C = 1;
 
 	int32_t cycles = RunTestProgram();
 
 	EXPECT_EQ(MCU->CPU.A, 0x20);
-	EXPECT_EQ(MCU->CPU.PS.Bits.C, 0);
+	EXPECT_EQ(MCU->CPU.PS.Bits.C, 1);
 	EXPECT_EQ(MCU->CPU.PS.Bits.Z, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.V, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.N, 0);
@@ -251,12 +251,12 @@ TEST_F(SBCTest, SBCAbsoluteYWithPageCrossing)
 	MCU->SRAM->WriteByte(0x3834, 0x42);
 	MCU->CPU.A = 0x62;
 	MCU->CPU.Y = 0xFF;
-	MCU->CPU.PS.Bits.C = 0;
+	MCU->CPU.PS.Bits.C = 1;
 
 	int32_t cycles = RunTestProgram();
 
 	EXPECT_EQ(MCU->CPU.A, 0x20);
-	EXPECT_EQ(MCU->CPU.PS.Bits.C, 0);
+	EXPECT_EQ(MCU->CPU.PS.Bits.C, 1);
 	EXPECT_EQ(MCU->CPU.PS.Bits.Z, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.V, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.N, 0);
@@ -274,12 +274,12 @@ TEST_F(SBCTest, SBCIndirectX)
 	MCU->SRAM->WriteByte(0x2056, 0x42);
 	MCU->CPU.A = 0x62;
 	MCU->CPU.X = 0x04;
-	MCU->CPU.PS.Bits.C = 0;
+	MCU->CPU.PS.Bits.C = 1;
 
 	int32_t cycles = RunTestProgram();
 
 	EXPECT_EQ(MCU->CPU.A, 0x20);
-	EXPECT_EQ(MCU->CPU.PS.Bits.C, 0);
+	EXPECT_EQ(MCU->CPU.PS.Bits.C, 1);
 	EXPECT_EQ(MCU->CPU.PS.Bits.Z, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.V, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.N, 0);
@@ -297,12 +297,12 @@ TEST_F(SBCTest, SBCIndirectXWithZeroPageCrossover)
 	MCU->SRAM->WriteByte(0x2056, 0x42);
 	MCU->CPU.A = 0x62;
 	MCU->CPU.X = 0xFF;
-	MCU->CPU.PS.Bits.C = 0;
+	MCU->CPU.PS.Bits.C = 1;
 
 	int32_t cycles = RunTestProgram();
 
 	EXPECT_EQ(MCU->CPU.A, 0x20);
-	EXPECT_EQ(MCU->CPU.PS.Bits.C, 0);
+	EXPECT_EQ(MCU->CPU.PS.Bits.C, 1);
 	EXPECT_EQ(MCU->CPU.PS.Bits.Z, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.V, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.N, 0);
@@ -320,12 +320,12 @@ TEST_F(SBCTest, SBCIndirectY)
 	MCU->SRAM->WriteByte(0x2059, 0x42);
 	MCU->CPU.A = 0x62;
 	MCU->CPU.Y = 0x03;
-	MCU->CPU.PS.Bits.C = 0;
+	MCU->CPU.PS.Bits.C = 1;
 
 	int32_t cycles = RunTestProgram();
 
 	EXPECT_EQ(MCU->CPU.A, 0x20);
-	EXPECT_EQ(MCU->CPU.PS.Bits.C, 0);
+	EXPECT_EQ(MCU->CPU.PS.Bits.C, 1);
 	EXPECT_EQ(MCU->CPU.PS.Bits.Z, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.V, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.N, 0);
@@ -343,14 +343,57 @@ TEST_F(SBCTest, SBCIndirectYWithPageCrossing)
 	MCU->SRAM->WriteByte(0x2155, 0x42);
 	MCU->CPU.A = 0x62;
 	MCU->CPU.Y = 0xFF;
-	MCU->CPU.PS.Bits.C = 0;
+	MCU->CPU.PS.Bits.C = 1;
 
 	int32_t cycles = RunTestProgram();
 
 	EXPECT_EQ(MCU->CPU.A, 0x20);
-	EXPECT_EQ(MCU->CPU.PS.Bits.C, 0);
+	EXPECT_EQ(MCU->CPU.PS.Bits.C, 1);
 	EXPECT_EQ(MCU->CPU.PS.Bits.Z, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.V, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.N, 0);
 	EXPECT_EQ(cycles, 6);
-}
\ No newline at end of file
+}
+
+TEST_F(SBCTest, SBCImmediateDecimal)
+{
+	BYTE program[] = {
+		0xE9, 0x13,		// $40 - $13
+		0xE9, 0x21		// $27 - $21 - borrow
+	};
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+	MCU->CPU.A = 0x40;
+	MCU->CPU.PS.Bits.C = 1;
+	MCU->CPU.PS.Bits.D = 1;
+
+	RunCycles(8 + 2);
+	EXPECT_EQ(MCU->CPU.A, 0x27);
+	EXPECT_EQ(MCU->CPU.PS.Bits.C, 1);
+	EXPECT_EQ(MCU->CPU.PS.Bits.Z, 0);
+
+	MCU->CPU.A = 0x12;
+	RunCycles(2);
+	EXPECT_EQ(MCU->CPU.A, 0x91);
+	EXPECT_EQ(MCU->CPU.PS.Bits.C, 0);
+	EXPECT_EQ(MCU->CPU.PS.Bits.N, 1);
+}
+
+TEST_F(SBCTest, SBCImmediateBorrowsThroughCarry)
+{
+	BYTE program[] = {
+		0xE9, 0x22,		// $42 - $22 - borrow
+		0xE9, 0x20		// $1F - $20
+	};
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+	MCU->CPU.A = 0x42;
+	MCU->CPU.PS.Bits.C = 0;
+
+	RunCycles(8 + 2);
+	EXPECT_EQ(MCU->CPU.A, 0x1F);
+	EXPECT_EQ(MCU->CPU.PS.Bits.C, 1);
+
+	RunCycles(2);
+	EXPECT_EQ(MCU->CPU.A, 0xFF);
+	EXPECT_EQ(MCU->CPU.PS.Bits.C, 0);
+	EXPECT_EQ(MCU->CPU.PS.Bits.N, 1);
+}
@@ -0,0 +1,349 @@
+// Translated by 6502_Recompiler, do not edit.
+// 5 blocks from a 16384 byte image at 0xC000
+
+#include <StaticCode.h>
+
+namespace {
+
+	void Block_C000(StaticCPU& cpu)
+	{
+		JitContext& s = cpu.State;
+		// $C000: A9 0C  LDA
+		if (!cpu.Begin(0xC000, 2)) return;
+		s.Cycles += 2;
+		{
+			cpu.Fetch(0xC000, 0xA9);
+			cpu.Fetch(0xC001, 0x0C);
+			ALU::Load(s.A, s.PS, s.DataBus);
+		}
+		// $C002: 8D 00 30  STA
+		if (!cpu.Begin(0xC002, 4)) return;
+		s.Cycles += 4;
+		{
+			cpu.Fetch(0xC002, 0x8D);
+			cpu.Fetch(0xC003, 0x00);
+			cpu.Fetch(0xC004, 0x30);
+			if (!cpu.Write(0x3000, s.A)) return;
+		}
+		// $C005: A9 17  LDA
+		if (!cpu.Begin(0xC005, 2)) return;
+		s.Cycles += 2;
+		{
+			cpu.Fetch(0xC005, 0xA9);
+			cpu.Fetch(0xC006, 0x17);
+			ALU::Load(s.A, s.PS, s.DataBus);
+		}
+		// $C007: 8D 01 30  STA
+		if (!cpu.Begin(0xC007, 4)) return;
+		s.Cycles += 4;
+		{
+			cpu.Fetch(0xC007, 0x8D);
+			cpu.Fetch(0xC008, 0x01);
+			cpu.Fetch(0xC009, 0x30);
+			if (!cpu.Write(0x3001, s.A)) return;
+		}
+		// $C00A: A9 00  LDA
+		if (!cpu.Begin(0xC00A, 2)) return;
+		s.Cycles += 2;
+		{
+			cpu.Fetch(0xC00A, 0xA9);
+			cpu.Fetch(0xC00B, 0x00);
+			ALU::Load(s.A, s.PS, s.DataBus);
+		}
+		// $C00C: 8D 02 30  STA
+		if (!cpu.Begin(0xC00C, 4)) return;
+		s.Cycles += 4;
+		{
+			cpu.Fetch(0xC00C, 0x8D);
+			cpu.Fetch(0xC00D, 0x02);
+			cpu.Fetch(0xC00E, 0x30);
+			if (!cpu.Write(0x3002, s.A)) return;
+		}
+		// $C00F: 8D 03 30  STA
+		if (!cpu.Begin(0xC00F, 4)) return;
+		s.Cycles += 4;
+		{
+			cpu.Fetch(0xC00F, 0x8D);
+			cpu.Fetch(0xC010, 0x03);
+			cpu.Fetch(0xC011, 0x30);
+			if (!cpu.Write(0x3003, s.A)) return;
+		}
+		// $C012: 8D 04 30  STA
+		if (!cpu.Begin(0xC012, 4)) return;
+		s.Cycles += 4;
+		{
+			cpu.Fetch(0xC012, 0x8D);
+			cpu.Fetch(0xC013, 0x04);
+			cpu.Fetch(0xC014, 0x30);
+			if (!cpu.Write(0x3004, s.A)) return;
+		}
+		// $C015: A2 08  LDX
+		if (!cpu.Begin(0xC015, 2)) return;
+		s.Cycles += 2;
+		{
+			cpu.Fetch(0xC015, 0xA2);
+			cpu.Fetch(0xC016, 0x08);
+			ALU::Load(s.X, s.PS, s.DataBus);
+		}
+		// $C017: 4E 01 30  LSR
+		if (!cpu.Begin(0xC017, 6)) return;
+		s.Cycles += 6;
+		{
+			cpu.Fetch(0xC017, 0x4E);
+			cpu.Fetch(0xC018, 0x01);
+			cpu.Fetch(0xC019, 0x30);
+			if (!cpu.Read(0x3001)) return;
+			s.DataRead = false;
+			if (!cpu.Write(s.AddressBus, ALU::ShiftRight(s.PS, s.DataBus, false))) return;
+		}
+		// $C01A: 90 13  BCC
+		if (!cpu.Begin(0xC01A, 4)) return;
+		s.Cycles += 2;
+		{
+			cpu.Fetch(0xC01A, 0x90);
+			cpu.Fetch(0xC01B, 0x13);
+			if (ALU::IsBranchTaken(Operation::BCC, s.PS))
+			{
+				s.Cycles += 1;
+				s.AddressBus = 0xC02F;
+				s.PC = 0xC02F;
+				return;
+			}
+			s.PC = 0xC01C;
+			return;
+		}
+	}
+
+	void Block_C017(StaticCPU& cpu)
+	{
+		JitContext& s = cpu.State;
+		// $C017: 4E 01 30  LSR
+		if (!cpu.Begin(0xC017, 6)) return;
+		s.Cycles += 6;
+		{
+			cpu.Fetch(0xC017, 0x4E);
+			cpu.Fetch(0xC018, 0x01);
+			cpu.Fetch(0xC019, 0x30);
+			if (!cpu.Read(0x3001)) return;
+			s.DataRead = false;
+			if (!cpu.Write(s.AddressBus, ALU::ShiftRight(s.PS, s.DataBus, false))) return;
+		}
+		// $C01A: 90 13  BCC
+		if (!cpu.Begin(0xC01A, 4)) return;
+		s.Cycles += 2;
+		{
+			cpu.Fetch(0xC01A, 0x90);
+			cpu.Fetch(0xC01B, 0x13);
+			if (ALU::IsBranchTaken(Operation::BCC, s.PS))
+			{
+				s.Cycles += 1;
+				s.AddressBus = 0xC02F;
+				s.PC = 0xC02F;
+				return;
+			}
+			s.PC = 0xC01C;
+			return;
+		}
+	}
+
+	void Block_C01C(StaticCPU& cpu)
+	{
+		JitContext& s = cpu.State;
+		// $C01C: AD 03 30  LDA
+		if (!cpu.Begin(0xC01C, 4)) return;
+		s.Cycles += 4;
+		{
+			cpu.Fetch(0xC01C, 0xAD);
+			cpu.Fetch(0xC01D, 0x03);
+			cpu.Fetch(0xC01E, 0x30);
+			if (!cpu.Read(0x3003)) return;
+			ALU::Load(s.A, s.PS, s.DataBus);
+		}
+		// $C01F: 18  CLC
+		if (!cpu.Begin(0xC01F, 2)) return;
+		s.Cycles += 2;
+		{
+			cpu.Fetch(0xC01F, 0x18);
+			cpu.Fetch(0xC020, 0x6D);
+			s.PS.Bits.C = 0;
+		}
+		// $C020: 6D 00 30  ADC
+		if (!cpu.Begin(0xC020, 4)) return;
+		s.Cycles += 4;
+		{
+			cpu.Fetch(0xC020, 0x6D);
+			cpu.Fetch(0xC021, 0x00);
+			cpu.Fetch(0xC022, 0x30);
+			if (!cpu.Read(0x3000)) return;
+			ALU::Add(s.A, s.PS, s.DataBus);
+		}
+		// $C023: 8D 03 30  STA
+		if (!cpu.Begin(0xC023, 4)) return;
+		s.Cycles += 4;
+		{
+			cpu.Fetch(0xC023, 0x8D);
+			cpu.Fetch(0xC024, 0x03);
+			cpu.Fetch(0xC025, 0x30);
+			if (!cpu.Write(0x3003, s.A)) return;
+		}
+		// $C026: AD 04 30  LDA
+		if (!cpu.Begin(0xC026, 4)) return;
+		s.Cycles += 4;
+		{
+			cpu.Fetch(0xC026, 0xAD);
+			cpu.Fetch(0xC027, 0x04);
+			cpu.Fetch(0xC028, 0x30);
+			if (!cpu.Read(0x3004)) return;
+			ALU::Load(s.A, s.PS, s.DataBus);
+		}
+		// $C029: 6D 02 30  ADC
+		if (!cpu.Begin(0xC029, 4)) return;
+		s.Cycles += 4;
+		{
+			cpu.Fetch(0xC029, 0x6D);
+			cpu.Fetch(0xC02A, 0x02);
+			cpu.Fetch(0xC02B, 0x30);
+			if (!cpu.Read(0x3002)) return;
+			ALU::Add(s.A, s.PS, s.DataBus);
+		}
+		// $C02C: 8D 04 30  STA
+		if (!cpu.Begin(0xC02C, 4)) return;
+		s.Cycles += 4;
+		{
+			cpu.Fetch(0xC02C, 0x8D);
+			cpu.Fetch(0xC02D, 0x04);
+			cpu.Fetch(0xC02E, 0x30);
+			if (!cpu.Write(0x3004, s.A)) return;
+		}
+		// $C02F: 0E 00 30  ASL
+		if (!cpu.Begin(0xC02F, 6)) return;
+		s.Cycles += 6;
+		{
+			cpu.Fetch(0xC02F, 0x0E);
+			cpu.Fetch(0xC030, 0x00);
+			cpu.Fetch(0xC031, 0x30);
+			if (!cpu.Read(0x3000)) return;
+			s.DataRead = false;
+			if (!cpu.Write(s.AddressBus, ALU::ShiftLeft(s.PS, s.DataBus, false))) return;
+		}
+		// $C032: 2E 02 30  ROL
+		if (!cpu.Begin(0xC032, 6)) return;
+		s.Cycles += 6;
+		{
+			cpu.Fetch(0xC032, 0x2E);
+			cpu.Fetch(0xC033, 0x02);
+			cpu.Fetch(0xC034, 0x30);
+			if (!cpu.Read(0x3002)) return;
+			s.DataRead = false;
+			if (!cpu.Write(s.AddressBus, ALU::ShiftLeft(s.PS, s.DataBus, true))) return;
+		}
+		// $C035: CA  DEX
+		if (!cpu.Begin(0xC035, 2)) return;
+		s.Cycles += 2;
+		{
+			cpu.Fetch(0xC035, 0xCA);
+			cpu.Fetch(0xC036, 0xD0);
+			ALU::Load(s.X, s.PS, s.X - 1);
+		}
+		// $C036: D0 DF  BNE
+		if (!cpu.Begin(0xC036, 4)) return;
+		s.Cycles += 2;
+		{
+			cpu.Fetch(0xC036, 0xD0);
+			cpu.Fetch(0xC037, 0xDF);
+			if (ALU::IsBranchTaken(Operation::BNE, s.PS))
+			{
+				s.Cycles += 1;
+				s.AddressBus = 0xC017;
+				s.PC = 0xC017;
+				return;
+			}
+			s.PC = 0xC038;
+			return;
+		}
+	}
+
+	void Block_C02F(StaticCPU& cpu)
+	{
+		JitContext& s = cpu.State;
+		// $C02F: 0E 00 30  ASL
+		if (!cpu.Begin(0xC02F, 6)) return;
+		s.Cycles += 6;
+		{
+			cpu.Fetch(0xC02F, 0x0E);
+			cpu.Fetch(0xC030, 0x00);
+			cpu.Fetch(0xC031, 0x30);
+			if (!cpu.Read(0x3000)) return;
+			s.DataRead = false;
+			if (!cpu.Write(s.AddressBus, ALU::ShiftLeft(s.PS, s.DataBus, false))) return;
+		}
+		// $C032: 2E 02 30  ROL
+		if (!cpu.Begin(0xC032, 6)) return;
+		s.Cycles += 6;
+		{
+			cpu.Fetch(0xC032, 0x2E);
+			cpu.Fetch(0xC033, 0x02);
+			cpu.Fetch(0xC034, 0x30);
+			if (!cpu.Read(0x3002)) return;
+			s.DataRead = false;
+			if (!cpu.Write(s.AddressBus, ALU::ShiftLeft(s.PS, s.DataBus, true))) return;
+		}
+		// $C035: CA  DEX
+		if (!cpu.Begin(0xC035, 2)) return;
+		s.Cycles += 2;
+		{
+			cpu.Fetch(0xC035, 0xCA);
+			cpu.Fetch(0xC036, 0xD0);
+			ALU::Load(s.X, s.PS, s.X - 1);
+		}
+		// $C036: D0 DF  BNE
+		if (!cpu.Begin(0xC036, 4)) return;
+		s.Cycles += 2;
+		{
+			cpu.Fetch(0xC036, 0xD0);
+			cpu.Fetch(0xC037, 0xDF);
+			if (ALU::IsBranchTaken(Operation::BNE, s.PS))
+			{
+				s.Cycles += 1;
+				s.AddressBus = 0xC017;
+				s.PC = 0xC017;
+				return;
+			}
+			s.PC = 0xC038;
+			return;
+		}
+	}
+
+	void Block_C038(StaticCPU& cpu)
+	{
+		JitContext& s = cpu.State;
+		// $C038: EA  NOP
+		if (!cpu.Begin(0xC038, 2)) return;
+		s.Cycles += 2;
+		{
+			cpu.Fetch(0xC038, 0xEA);
+			cpu.Fetch(0xC039, 0xEA);
+		}
+		// $C039: EA  NOP
+		if (!cpu.Begin(0xC039, 2)) return;
+		s.Cycles += 2;
+		{
+			cpu.Fetch(0xC039, 0xEA);
+			cpu.Fetch(0xC03A, 0x00);
+		}
+		s.PC = 0xC03A;
+	}
+
+	const StaticBlock s_Blocks[] = {
+		{ 0xC000, 0xC0, 0xC0, Block_C000 },
+		{ 0xC017, 0xC0, 0xC0, Block_C017 },
+		{ 0xC01C, 0xC0, 0xC0, Block_C01C },
+		{ 0xC02F, 0xC0, 0xC0, Block_C02F },
+		{ 0xC038, 0xC0, 0xC0, Block_C038 },
+	};
+}
+
+extern const StaticProgram StaticProgram7 = {
+	"StaticProgram7", 0xC000, 16384, 0xAB23E9F9971D43E9ull,
+	s_Blocks, 5
+};
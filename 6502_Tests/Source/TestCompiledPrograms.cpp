@@ -109,9 +109,9 @@ TEST_F(CompiledProgramTest, Program4)
 
 	int32_t cycles = RunTestProgram();
 
-	EXPECT_EQ(MCU->CPU.A, 0x30);
-	EXPECT_EQ(MCU->SRAM->ReadByte(0x3320), 0x30);
-	EXPECT_EQ(MCU->CPU.PS.Bits.C, 0);
+	EXPECT_EQ(MCU->CPU.A, 0x2F);
+	EXPECT_EQ(MCU->SRAM->ReadByte(0x3320), 0x2F);
+	EXPECT_EQ(MCU->CPU.PS.Bits.C, 1);
 	EXPECT_EQ(MCU->CPU.PS.Bits.Z, 0);
 	EXPECT_EQ(MCU->CPU.PS.Bits.V, 1);
 	EXPECT_EQ(MCU->CPU.PS.Bits.N, 0);
@@ -238,4 +238,53 @@ TEST_F(CompiledProgramTest, Program7)
 	// 12 * 23 = 276 = 0x0114
 	EXPECT_EQ(MCU->SRAM->ReadByte(0x3003), 0x14); 
 	EXPECT_EQ(MCU->SRAM->ReadByte(0x3004), 0x01);
-}
\ No newline at end of file
+}
+
+// StaticProgram7.cpp is translated from program7.out by 6502_Recompiler
+extern const StaticProgram StaticProgram7;
+
+TEST_F(CompiledProgramTest, StaticProgram7MatchesInterpreter)
+{
+	MCU->EEPROM->LoadProgram("C:\\Dev\\6502\\6502_Tests\\TestPrograms\\program7.out");
+	MCU->CPU.AttachStaticProgram(&StaticProgram7);
+
+	Computer interpreted(SRAM_MEMORY, EEPROM_MEMORY);
+	interpreted.clock.SetSpeedMS(0);
+	interpreted.clock.Start();
+	interpreted.EEPROM->LoadProgram("C:\\Dev\\6502\\6502_Tests\\TestPrograms\\program7.out");
+
+	// Uneven runs end in the middle of instructions and blocks
+	for (uint32_t run = 0; run < 100; run++)
+	{
+		uint64_t cycles = 1 + (run * 37) % 250;
+		EXPECT_EQ(MCU->RunCycles(cycles), interpreted.RunCycles(cycles));
+
+		ASSERT_EQ(MCU->CPU.Cycles, interpreted.CPU.Cycles);
+		ASSERT_EQ(MCU->CPU.PC, interpreted.CPU.PC);
+		ASSERT_EQ(MCU->CPU.A, interpreted.CPU.A);
+		ASSERT_EQ(MCU->CPU.X, interpreted.CPU.X);
+		ASSERT_EQ(MCU->CPU.PS.Byte, interpreted.CPU.PS.Byte);
+		ASSERT_EQ(MCU->CPU.AddressBus, interpreted.CPU.AddressBus);
+		ASSERT_EQ(MCU->CPU.DataBus, interpreted.CPU.DataBus);
+		ASSERT_EQ(MCU->CPU.DataRead, interpreted.CPU.DataRead);
+	}
+
+	for (WORD address = 0x3000; address < 0x3005; address++)
+		EXPECT_EQ(MCU->SRAM->ReadByte(address), interpreted.SRAM->ReadByte(address));
+
+	ASSERT_NE(MCU->CPU.GetStaticRunner(), nullptr);
+	EXPECT_TRUE(MCU->CPU.GetStaticRunner()->IsActive());
+	uint64_t blockRuns = MCU->CPU.GetStaticRunner()->GetBlockRuns();
+	EXPECT_GT(blockRuns, 0);
+
+	// Writing over the image stops the translated blocks
+	BYTE program[] = { 0xEA };
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+	MCU->RunCycles(1000);
+	EXPECT_EQ(MCU->CPU.GetStaticRunner()->GetBlockRuns(), blockRuns);
+
+	// As does loading another image
+	MCU->EEPROM->LoadProgram("C:\\Dev\\6502\\6502_Tests\\TestPrograms\\program1.out");
+	MCU->RunCycles(10);
+	EXPECT_FALSE(MCU->CPU.GetStaticRunner()->IsActive());
+}
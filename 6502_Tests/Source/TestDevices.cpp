@@ -0,0 +1,369 @@
+#include "ComputerTest.h"
+
+#include <Device.h>
+#include <Mapper.h>
+
+#include <memory>
+
+class DeviceTest : public ComputerTest {};
+
+class LatchDevice : public Device
+{
+public:
+	BYTE Registers[16] = {};
+	uint64_t TickedCycles = 0;
+	uint32_t TickCalls = 0;
+
+	BYTE Read(WORD address) override { return Registers[address & 0x0F]; }
+	void Write(WORD address, BYTE value) override { Registers[address & 0x0F] = value; }
+	void Tick(uint64_t cycles) override
+	{
+		TickedCycles += cycles;
+		TickCalls++;
+	}
+};
+
+// Reads 0 until the given number of cycles have elapsed, then 1
+class TimerDevice : public Device
+{
+public:
+	uint64_t Elapsed = 0;
+	uint64_t Delay = 0;
+
+	BYTE Read(WORD) override { return Elapsed >= Delay ? 0x01 : 0x00; }
+	void Write(WORD, BYTE) override {}
+	void Tick(uint64_t cycles) override { Elapsed += cycles; }
+	uint64_t GetCyclesUntilEvent() override { return Elapsed >= Delay ? UINT64_MAX : Delay - Elapsed; }
+};
+
+// Counts periods of cycles through scheduled events instead of being ticked
+class PeriodicDevice : public Device
+{
+public:
+	BYTE Count = 0;
+	uint64_t Period = 0;
+
+	BYTE Read(WORD) override { return Count; }
+	void Write(WORD, BYTE) override {}
+	void Connect(Scheduler& events, uint64_t cycle) override { Expire(events, cycle); }
+
+private:
+	void Expire(Scheduler& events, uint64_t cycle)
+	{
+		events.Schedule(cycle + Period, [this, &events](uint64_t cycle)
+			{
+				Count++;
+				Expire(events, cycle);
+			}, this);
+	}
+};
+
+// Reads 0, raising an NMI on the given tick
+class InterruptingDevice : public Device
+{
+public:
+	CPU* Target = nullptr;
+	uint32_t Ticks = 0;
+	uint32_t InterruptOn = 0;
+
+	BYTE Read(WORD) override { return 0x00; }
+	void Write(WORD, BYTE) override {}
+	void Tick(uint64_t) override
+	{
+		if (++Ticks == InterruptOn)
+			Target->InterruptNMI();
+	}
+};
+
+TEST_F(DeviceTest, CpuCanReadAndWriteDevice)
+{
+	BYTE program[] = {
+		0xA9, 0x42,			// LDA Immediate
+		0x8D, 0x03, 0x80,	// STA Absolute
+		0xAE, 0x03, 0x80	// LDX Absolute
+	};
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+
+	LatchDevice latch;
+	EXPECT_TRUE(MCU->AttachDevice(&latch, 0x8000, 0x800F));
+
+	int32_t cycles = RunTestProgram();
+
+	EXPECT_EQ(latch.Registers[3], 0x42);
+	EXPECT_EQ(MCU->CPU.X, 0x42);
+	EXPECT_EQ(cycles, 10);
+}
+
+TEST_F(DeviceTest, DeviceHasPriorityOverMemory)
+{
+	BYTE program[] = {
+		0xA9, 0x42,			// LDA Immediate
+		0x85, 0x10			// STA Zero Page
+	};
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+
+	LatchDevice latch;
+	EXPECT_TRUE(MCU->AttachDevice(&latch, 0x0010, 0x0010));
+
+	RunTestProgram();
+
+	EXPECT_EQ(latch.Registers[0], 0x42);
+	EXPECT_EQ(MCU->SRAM->ReadByte(0x0010), 0x00);
+}
+
+TEST_F(DeviceTest, DevicesCanNotOverlap)
+{
+	LatchDevice first, second;
+
+	EXPECT_TRUE(MCU->AttachDevice(&first, 0x8000, 0x800F));
+	EXPECT_FALSE(MCU->AttachDevice(&second, 0x800F, 0x801F));
+	EXPECT_TRUE(MCU->AttachDevice(&second, 0x8010, 0x801F));
+
+	MCU->DetachDevice(&first);
+	EXPECT_TRUE(MCU->AttachDevice(&first, 0x8000, 0x800F));
+}
+
+TEST_F(DeviceTest, DeviceIsTickedLazily)
+{
+	BYTE program[] = {
+		0xE8,				// INX
+		0xAD, 0x00, 0x80	// LDA Absolute
+	};
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+
+	LatchDevice latch;
+	MCU->AttachDevice(&latch, 0x8000, 0x800F);
+
+	// Ticked once when read, then once when the batch ends
+	EXPECT_EQ(MCU->RunCycles(8 + 2 + 4 + 10), 24);
+	EXPECT_EQ(latch.TickCalls, 2);
+	EXPECT_EQ(latch.TickedCycles, 24);
+}
+
+TEST_F(DeviceTest, IdleLoopsStopAtDeviceEvents)
+{
+	BYTE program[] = {
+		0xAD, 0x00, 0x80,	// LDA Absolute
+		0xF0, 0xFB,			// BEQ -5
+		0x8D, 0x01, 0x80,	// STA Absolute
+		0x4C, 0x08, 0xC0	// JMP Absolute (to itself)
+	};
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+
+	TimerDevice timer, interpretedTimer;
+	timer.Delay = interpretedTimer.Delay = 100000;
+	MCU->AttachDevice(&timer, 0x8000, 0x8001);
+
+	Computer interpreted(SRAM_MEMORY, EEPROM_MEMORY);
+	interpreted.clock.SetSpeedMS(0);
+	interpreted.clock.Start();
+	interpreted.EEPROM->ShareImage(std::make_shared<std::vector<BYTE>>(MCU->EEPROM->GetData(), MCU->EEPROM->GetData() + EEPROM_MEMORY));
+	interpreted.AttachDevice(&interpretedTimer, 0x8000, 0x8001);
+	interpreted.CPU.EnableIdleSkip(false);
+
+	// The poll loop skips ahead to the timer, then leaves on the same cycle it would have
+	EXPECT_EQ(MCU->RunCycles(8 + 90000), interpreted.RunCycles(8 + 90000));
+	EXPECT_EQ(MCU->CPU.A, 0x00);
+	EXPECT_GT(MCU->CPU.GetIdleCycles(), 80000);
+
+	for (uint64_t cycles : { 9990, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 1000 })
+	{
+		EXPECT_EQ(MCU->RunCycles(cycles), interpreted.RunCycles(cycles));
+
+		ASSERT_EQ(MCU->CPU.Cycles, interpreted.CPU.Cycles);
+		ASSERT_EQ(MCU->CPU.PC, interpreted.CPU.PC);
+		ASSERT_EQ(MCU->CPU.A, interpreted.CPU.A);
+		ASSERT_EQ(MCU->CPU.AddressBus, interpreted.CPU.AddressBus);
+	}
+	EXPECT_EQ(MCU->CPU.A, 0x01);
+}
+
+TEST_F(DeviceTest, IdleLoopsStopAtInterruptsRaisedByDevices)
+{
+	BYTE program[] = {
+		0xAD, 0x00, 0x80,	// LDA Absolute
+		0xF0, 0xFB,			// BEQ -5
+		0x4C, 0x05, 0xC0,	// JMP Absolute (to itself)
+		0xE8,				// INX (NMI handler)
+		0x4C, 0x08, 0xC0	// JMP Absolute (to the INX)
+	};
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+	MCU->EEPROM->WriteByte(0xFFFA, 0x08);
+	MCU->EEPROM->WriteByte(0xFFFB, 0xC0);
+
+	// Ticked by the first read, the two probed iterations, then when the skip looks for the next event
+	InterruptingDevice device;
+	device.Target = &MCU->CPU;
+	device.InterruptOn = 4;
+	MCU->AttachDevice(&device, 0x8000, 0x8000);
+
+	// The handler runs from the next instruction rather than after the skip
+	MCU->RunCycles(8 + 10000);
+	EXPECT_EQ(device.Ticks, 5);
+	EXPECT_EQ(MCU->CPU.GetIdleCycles(), 0);
+	EXPECT_GT(MCU->CPU.X, 100);
+	EXPECT_GE(MCU->CPU.PC, 0xC008);
+}
+
+TEST_F(DeviceTest, DeviceCanScheduleEvents)
+{
+	BYTE program[] = {
+		0x4C, 0x00, 0xC0	// JMP Absolute (to itself)
+	};
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+
+	PeriodicDevice timer;
+	timer.Period = 1000;
+	MCU->AttachDevice(&timer, 0x8000, 0x8000);
+
+	// The event due on the last cycle runs before the next one
+	MCU->RunCycles(10000);
+	EXPECT_EQ(timer.Count, 9);
+	MCU->RunCycles(1);
+	EXPECT_EQ(timer.Count, 10);
+
+	MCU->DetachDevice(&timer);
+	EXPECT_EQ(MCU->Events.GetPendingCount(), 0);
+}
+
+TEST_F(DeviceTest, MapperSwitchesROMBanks)
+{
+	BYTE program[] = {
+		0xA2, 0x00,			// LDX Immediate
+		0x8E, 0x00, 0x90,	// STX Absolute (bank register)
+		0x20, 0x00, 0x80,	// JSR Absolute (banked routine)
+		0x9D, 0x00, 0x02,	// STA Absolute X
+		0xE8,				// INX
+		0xE0, 0x02,			// CPX Immediate
+		0xD0, 0xF2,			// BNE (back to STX)
+		0xEE, 0x10, 0x02,	// INC Absolute
+		0x4C, 0x00, 0xC0	// JMP Absolute
+	};
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+
+	// Each bank has its own routine at the same address
+	BYTE routines[2][4] = {
+		{ 0xA9, 0x11, 0x60 },		// LDA Immediate, RTS
+		{ 0xEA, 0xA9, 0x22, 0x60 }	// NOP, LDA Immediate, RTS
+	};
+	Mapper mapper(0x8000, 0x1000, 2, true);
+	for (BYTE bank = 0; bank < 2; bank++)
+	{
+		for (WORD i = 0; i < 4; i++)
+			mapper.GetBank(bank)->WriteByte(0x8000 + i, routines[bank][i]);
+	}
+	ASSERT_TRUE(MCU->AttachMapper(&mapper));
+	MCU->AttachDevice(&mapper, 0x9000, 0x9000);
+
+	// Neither decoded nor compiled code may outlive a switch
+	for (bool jit : { true, false })
+	{
+		MCU->CPU.EnableJit(jit);
+		for (int pass = 0; pass < 3; pass++)
+		{
+			MCU->SRAM->WriteByte(0x0200, 0x00);
+			MCU->SRAM->WriteByte(0x0201, 0x00);
+			MCU->RunCycles(1000);
+			EXPECT_EQ(MCU->SRAM->ReadByte(0x0200), 0x11);
+			EXPECT_EQ(MCU->SRAM->ReadByte(0x0201), 0x22);
+		}
+	}
+	EXPECT_GT(MCU->SRAM->ReadByte(0x0210), 5);
+	MCU->RunUntilPC(0xC010, 1000);
+
+	// The bank register reads back, and snapshots see the selected bank
+	EXPECT_EQ(mapper.GetSelectedBank(), 1);
+	EXPECT_EQ(MCU->ReadByte(0x8002), 0x22);
+	auto snapshot = std::make_unique<ComputerSnapshot>();
+	MCU->TakeSnapshot(*snapshot);
+	EXPECT_EQ(snapshot->MapperCount, 1);
+	EXPECT_EQ(snapshot->Banks[0], 1);
+	EXPECT_EQ(snapshot->Memory[0x8002], 0x22);
+}
+
+TEST_F(DeviceTest, MapperBacksDevicePagesInItsWindow)
+{
+	BYTE program[] = {
+		0xA9, 0x55,			// LDA Immediate
+		0x8D, 0x10, 0x80,	// STA Absolute (bank 0)
+		0xA2, 0x01,			// LDX Immediate
+		0x8E, 0x00, 0x80,	// STX Absolute (bank register)
+		0xA9, 0x66,			// LDA Immediate
+		0x8D, 0x10, 0x80,	// STA Absolute (bank 1)
+		0xA2, 0x00,			// LDX Immediate
+		0x8E, 0x00, 0x80,	// STX Absolute (bank register)
+		0xAC, 0x10, 0x80,	// LDY Absolute (bank 0)
+		0xAE, 0x00, 0x80	// LDX Absolute (bank register)
+	};
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+
+	// The bank register shares the first page of the window with the banks
+	Mapper mapper(0x8000, 0x1000, 2, false);
+	ASSERT_TRUE(MCU->AttachMapper(&mapper));
+	MCU->AttachDevice(&mapper, 0x8000, 0x8000);
+
+	RunCycles(8 + 2 + 4 + 2 + 4 + 2 + 4 + 2 + 4 + 4 + 4);
+	EXPECT_EQ(mapper.GetBank(0)->ReadByte(0x8010), 0x55);
+	EXPECT_EQ(mapper.GetBank(1)->ReadByte(0x8010), 0x66);
+	EXPECT_EQ(mapper.GetBank(0)->ReadByte(0x8000), 0x00);	// Written to the register only
+	EXPECT_EQ(MCU->CPU.Y, 0x55);
+	EXPECT_EQ(MCU->CPU.X, 0x00);
+	EXPECT_EQ(MCU->ReadByte(0x8010), MCU->CPU.Y);
+}
+
+TEST_F(DeviceTest, MapperBanksRAMOverSRAM)
+{
+	BYTE program[] = {
+		0xA9, 0x55,			// LDA Immediate
+		0x8D, 0x00, 0x40,	// STA Absolute
+		0xA9, 0x01,			// LDA Immediate
+		0x8D, 0x00, 0x90,	// STA Absolute (bank register)
+		0xA9, 0x66,			// LDA Immediate
+		0x8D, 0x00, 0x40,	// STA Absolute
+		0xAD, 0x00, 0x40	// LDA Absolute
+	};
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+
+	Mapper mapper(0x4000, 0x0100, 2, false);
+	MCU->AttachMapper(&mapper);
+	MCU->AttachDevice(&mapper, 0x9000, 0x9000);
+
+	MCU->RunCycles(8 + 2 + 4 + 2 + 4 + 2 + 4 + 4);
+	EXPECT_EQ(MCU->CPU.A, 0x66);
+	EXPECT_EQ(mapper.GetBank(0)->ReadByte(0x4000), 0x55);
+	EXPECT_EQ(mapper.GetBank(1)->ReadByte(0x4000), 0x66);
+	EXPECT_EQ(MCU->SRAM->ReadByte(0x4000), 0x00);
+
+	// Without the mapper the CPU sees SRAM again
+	MCU->DetachMapper(&mapper);
+	MCU->CPU.PC = 0xC00F;
+	MCU->RunCycles(4);
+	EXPECT_EQ(MCU->CPU.A, 0x00);
+	EXPECT_EQ(MCU->ReadByte(0x4000), 0x00);
+}
+
+TEST_F(DeviceTest, MapperRemapsReallocatedBank)
+{
+	BYTE program[] = {
+		0xAD, 0x00, 0x40,	// LDA Absolute
+		0x8D, 0x00, 0x02,	// STA Absolute
+		0xAD, 0x00, 0x40,	// LDA Absolute
+		0x8D, 0x01, 0x02	// STA Absolute
+	};
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+
+	auto image = std::make_shared<std::vector<BYTE>>(0x0100, 0x77);
+	Mapper mapper(0x4000, 0x0100, 2, false);
+	mapper.GetBank(0)->ShareImage(image);
+	MCU->AttachMapper(&mapper);
+
+	MCU->RunCycles(8 + 4 + 4);
+	EXPECT_EQ(MCU->SRAM->ReadByte(0x0200), 0x77);
+
+	// The bank gets its own copy, which the window must follow
+	mapper.GetBank(0)->WriteByte(0x4000, 0x99);
+	EXPECT_FALSE(mapper.GetBank(0)->IsShared());
+	MCU->RunCycles(4 + 4);
+	EXPECT_EQ(MCU->SRAM->ReadByte(0x0201), 0x99);
+	EXPECT_EQ((*image)[0], 0x77);
+}
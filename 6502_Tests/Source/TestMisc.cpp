@@ -1,5 +1,17 @@
 #include "ComputerTest.h"
 
+#include <EmulationThread.h>
+#include <Fleet.h>
+#include <Lockstep.h>
+#include <ProgramLoader.h>
+#include <TraceFile.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
 class MiscTest : public ComputerTest {};
 
 TEST_F(MiscTest, CpuCanReset)
@@ -17,6 +29,651 @@ TEST_F(MiscTest, CpuCanReset)
 	EXPECT_TRUE(MCU->CPU.DataRead);
 }
 
+TEST_F(MiscTest, CpuCanRunWholeInstructions)
+{
+	BYTE program[] = {
+		0xA2, 0x01,			// LDX Immediate
+		0xBD, 0xFF, 0x20,	// LDA Absolute X (page crossing)
+		0x18,				// CLC
+		0x90, 0x02,			// BCC (taken)
+		0xE8, 0xE8,
+		0xE8				// INX
+	};
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+	MCU->SRAM->WriteByte(0x2100, 0x42);
+
+	EXPECT_EQ(MCU->CPU.RunInstruction(MCU->SRAM, MCU->EEPROM), 8);	// Reset
+	EXPECT_EQ(MCU->CPU.RunInstruction(MCU->SRAM, MCU->EEPROM), 2);
+	EXPECT_EQ(MCU->CPU.RunInstruction(MCU->SRAM, MCU->EEPROM), 5);
+	EXPECT_EQ(MCU->CPU.A, 0x42);
+	EXPECT_EQ(MCU->RunInstructions(3), 7);
+	EXPECT_EQ(MCU->CPU.X, 0x02);
+	EXPECT_EQ(MCU->CPU.PC, 0xC00B);
+}
+
+TEST_F(MiscTest, CpuCanSwitchBetweenCycleAndInstructionStepping)
+{
+	BYTE program[] = {
+		0xA9, 0x42,			// LDA Immediate
+		0x8D, 0x00, 0x20,	// STA Absolute
+		0xE8				// INX
+	};
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+	MCU->CPU.X = 0x01;
+
+	RunCycles(8);
+	EXPECT_EQ(MCU->RunInstructions(1), 2);
+	EXPECT_EQ(MCU->CPU.A, 0x42);
+
+	// Finish the STA half-way through
+	RunCycles(2);
+	EXPECT_FALSE(MCU->CPU.IsInstructionComplete());
+	EXPECT_EQ(MCU->CPU.RunInstruction(MCU->SRAM, MCU->EEPROM), 2);
+	EXPECT_TRUE(MCU->CPU.IsInstructionComplete());
+	EXPECT_EQ(MCU->SRAM->ReadByte(0x2000), 0x42);
+
+	RunCycles(2);
+	EXPECT_EQ(MCU->CPU.X, 0x02);
+	EXPECT_EQ(MCU->CPU.PC, 0xC006);
+}
+
+TEST_F(MiscTest, SteppedCoreMatchesMicroOps)
+{
+	BYTE program[0x32] = {
+		0xA2, 0x08,			// LDX Immediate
+		0xA0, 0xF0,			// LDY Immediate
+		0x06, 0x10,			// ASL Zero Page
+		0x36, 0x11,			// ROL Zero Page X
+		0x96, 0x20,			// STX Zero Page Y
+		0xFE, 0xF8, 0x02,	// INC Absolute X
+		0xBD, 0xF8, 0x02,	// LDA Absolute X
+		0xB9, 0x20, 0x02,	// LDA Absolute Y
+		0x99, 0x00, 0x03,	// STA Absolute Y
+		0xA1, 0x40,			// LDA Indirect X
+		0x91, 0x42,			// STA Indirect Y
+		0xB1, 0x42,			// LDA Indirect Y
+		0x20, 0x30, 0xC0,	// JSR Absolute
+		0x08,				// PHP
+		0x28,				// PLP
+		0x48,				// PHA
+		0x68,				// PLA
+		0xCA,				// DEX
+		0xD0, 0xDE,			// BNE -34
+		0x6C, 0x50, 0x00	// JMP Indirect
+	};
+	program[0x30] = 0x6A;	// ROR Accumulator
+	program[0x31] = 0x60;	// RTS
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+
+	Computer stepped(SRAM_MEMORY, EEPROM_MEMORY);
+	stepped.clock.SetSpeedMS(0);
+	stepped.clock.Start();
+	stepped.EEPROM->ShareImage(std::make_shared<std::vector<BYTE>>(MCU->EEPROM->GetData(), MCU->EEPROM->GetData() + EEPROM_MEMORY));
+	stepped.CPU.EnableSteppedCore(true);
+	stepped.CPU.Reset();
+
+	// Interrupts run the NOPs at $EAEA up to an RTI at $0000
+	for (Computer* computer : { MCU, &stepped })
+	{
+		computer->SRAM->WriteByte(0x0000, 0x40);
+		computer->SRAM->WriteByte(0x0051, 0xC0);
+	}
+
+	for (uint32_t cycle = 0; cycle < 100000; cycle++)
+	{
+		for (Computer* computer : { MCU, &stepped })
+		{
+			if (cycle % 9973 == 5000)
+				computer->CPU.InterruptIRQ();
+			if (cycle % 29989 == 15000)
+				computer->CPU.InterruptNMI();
+
+			// The micro-op programs can take over half-way through an instruction
+			if (cycle % 1009 == 1000)
+				computer->CPU.RunInstruction(computer->SRAM, computer->EEPROM);
+			else
+				computer->RunCycle();
+		}
+
+		ASSERT_EQ(MCU->CPU.Cycles, stepped.CPU.Cycles);
+		ASSERT_EQ(MCU->CPU.AddressBus, stepped.CPU.AddressBus);
+		ASSERT_EQ(MCU->CPU.DataBus, stepped.CPU.DataBus);
+		ASSERT_EQ(MCU->CPU.DataRead, stepped.CPU.DataRead);
+		ASSERT_EQ(MCU->CPU.PC, stepped.CPU.PC);
+		ASSERT_EQ(MCU->CPU.A, stepped.CPU.A);
+		ASSERT_EQ(MCU->CPU.X, stepped.CPU.X);
+		ASSERT_EQ(MCU->CPU.Y, stepped.CPU.Y);
+		ASSERT_EQ(MCU->CPU.SP, stepped.CPU.SP);
+		ASSERT_EQ(MCU->CPU.PS.Byte, stepped.CPU.PS.Byte);
+	}
+}
+
+TEST_F(MiscTest, LazyFlagsMatchEagerFlags)
+{
+	BYTE program[] = {
+		0xA2, 0x03,			// LDX Immediate
+		0xA9, 0x80,			// LDA Immediate (negative)
+		0x08,				// PHP
+		0xCA,				// DEX
+		0xD0, 0xFC,			// BNE (back to PHP)
+		0xA9, 0x00,			// LDA Immediate (zero)
+		0x4C, 0x0A, 0xC0	// JMP (to itself)
+	};
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+
+	Computer eager(SRAM_MEMORY, EEPROM_MEMORY);
+	eager.clock.SetSpeedMS(0);
+	eager.clock.Start();
+	std::vector<BYTE> image(MCU->EEPROM->GetData(), MCU->EEPROM->GetData() + EEPROM_MEMORY);
+	eager.EEPROM->LoadProgram(image.data());
+	eager.CPU.EnableLazyFlags(false);
+
+	for (uint32_t chunk : { 3, 9, 1, 14, 7, 12 })
+	{
+		EXPECT_EQ(MCU->RunCycles(chunk), eager.RunCycles(chunk));
+		EXPECT_EQ(MCU->CPU.PS.Byte, eager.CPU.PS.Byte);
+		EXPECT_EQ(MCU->CPU.PC, eager.CPU.PC);
+	}
+	EXPECT_TRUE(MCU->CPU.PS.Bits.Z);
+	EXPECT_EQ(MCU->SRAM->ReadByte(0x01FD), eager.SRAM->ReadByte(0x01FD));
+	EXPECT_EQ(MCU->SRAM->ReadByte(0x01FB), eager.SRAM->ReadByte(0x01FB));
+
+	// Batched stepping leaves N and Z to be worked out
+	MCU->CPU.PC = 0xC002;
+	MCU->CPU.AttachMemory(MCU->SRAM, MCU->EEPROM);
+	MCU->CPU.RunInstruction();
+	EXPECT_TRUE(MCU->CPU.PS.Bits.Z);
+	MCU->CPU.SyncFlags();
+	EXPECT_FALSE(MCU->CPU.PS.Bits.Z);
+	EXPECT_TRUE(MCU->CPU.PS.Bits.N);
+
+	// Unless asked to, a CPU stepped on its own keeps PS up to date
+	CPU bare;
+	bare.AttachMemory(MCU->SRAM, MCU->EEPROM);
+	bare.RunInstruction();	// Reset
+	bare.RunInstruction();
+	bare.RunInstruction();
+	EXPECT_EQ(bare.PC, 0xC004);
+	EXPECT_FALSE(bare.PS.Bits.Z);
+	EXPECT_TRUE(bare.PS.Bits.N);
+}
+
+TEST_F(MiscTest, OpcodeTableDescribesInstructions)
+{
+	static_assert(OPCODE_TABLE[INS_LDA_ABSX].Cycles == 4 && OPCODE_TABLE[INS_LDA_ABSX].PageCrossCycles == 1);
+
+	const OpcodeInfo& sta = MicroCode::GetInfo(INS_STA_INDY);
+	EXPECT_STREQ(sta.Mnemonic, "STA");
+	EXPECT_EQ(sta.Mode, AddressingMode::IndirectY);
+	EXPECT_EQ(sta.Access, AccessClass::Write);
+	EXPECT_EQ(sta.Cycles, 6);
+	EXPECT_EQ(sta.PageCrossCycles, 0);
+
+	const OpcodeInfo& inc = MicroCode::GetInfo(INS_INC_ABSX);
+	EXPECT_EQ(inc.Access, AccessClass::ReadModifyWrite);
+	EXPECT_EQ(inc.Cycles, 7);
+
+	const OpcodeInfo& bne = MicroCode::GetInfo(INS_BNE_REL);
+	EXPECT_EQ(bne.Mode, AddressingMode::Relative);
+	EXPECT_EQ(bne.Cycles, 2);
+	EXPECT_EQ(bne.PageCrossCycles, 1);
+
+	EXPECT_EQ(MicroCode::GetInfo(INS_ASL_ACC).Access, AccessClass::None);
+	EXPECT_EQ(MicroCode::GetInfo(INS_BRK_IMP).Cycles, 7);
+	EXPECT_EQ(MicroCode::GetInfo(0x02).Op, Operation::None);
+
+	// Every program is the one built from its descriptor
+	for (uint32_t opcode = 0; opcode < 256; opcode++)
+	{
+		const OpcodeInfo& info = MicroCode::GetInfo((BYTE)opcode);
+		const MicroProgram& program = MicroCode::GetProgram((BYTE)opcode);
+		EXPECT_EQ(program.Op, info.Op);
+		EXPECT_EQ(program.Length == 0, info.Cycles == 0);
+	}
+}
+
+TEST_F(MiscTest, ComputerCanRunBatchedCycles)
+{
+	BYTE program[] = {
+		0xE8,				// INX
+		0xE8,				// INX
+		0x4C, 0x00, 0xC0	// JMP Absolute
+	};
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+	MCU->CPU.X = 0x00;
+
+	EXPECT_EQ(MCU->RunCycles(8 + 2 * 2), 12);
+	EXPECT_EQ(MCU->CPU.X, 0x02);
+
+	EXPECT_EQ(MCU->RunUntilPC(0xC001), 3 + 2);
+	EXPECT_EQ(MCU->CPU.X, 0x03);
+
+	EXPECT_EQ(MCU->RunUntilOpcode(0x4C), 2);
+	EXPECT_EQ(MCU->CPU.PC, 0xC002);
+
+	// The cycle budget stops the run even if the condition is never met
+	EXPECT_EQ(MCU->RunUntilPC(0x1234, 100), 100);
+
+	MCU->clock.Stop();
+	EXPECT_EQ(MCU->RunCycles(10), 0);
+}
+
+TEST_F(MiscTest, CpuCanTraceBusCycles)
+{
+	BYTE program[] = {
+		0xA9, 0x42,			// LDA Immediate
+		0x8D, 0x00, 0x20	// STA Absolute
+	};
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+
+	MCU->CPU.EnableTrace(3);	// Rounded up to 4
+	EXPECT_EQ(MCU->CPU.GetTrace()->GetCapacity(), 4);
+
+	RunCycles(8 + 2 + 4);
+	EXPECT_EQ(MCU->CPU.GetTrace()->GetRecordCount(), 14);
+
+	// Only the latest four cycles are kept, the STA
+	std::vector<TraceRecord> records = MCU->CPU.GetTrace()->Read(8);
+	ASSERT_EQ(records.size(), 4);
+	EXPECT_EQ(records[0].Cycle, 11);
+	EXPECT_EQ(records[0].Address, 0xC002);
+	EXPECT_EQ(records[0].Data, 0x8D);
+	EXPECT_TRUE(records[0].Read);
+	EXPECT_EQ(records[3].Cycle, 14);
+	EXPECT_EQ(records[3].Address, 0x2000);
+	EXPECT_EQ(records[3].Data, 0x42);
+	EXPECT_FALSE(records[3].Read);
+
+	// Instruction stepping records every cycle too
+	MCU->CPU.GetTrace()->Clear();
+	uint64_t cycles = MCU->RunInstructions(1);
+	EXPECT_EQ(MCU->CPU.GetTrace()->GetRecordCount(), cycles);
+
+	MCU->CPU.DisableTrace();
+	EXPECT_EQ(MCU->CPU.GetTrace(), nullptr);
+}
+
+TEST_F(MiscTest, TraceReadDropsTornRecords)
+{
+	TraceBuffer trace(8);
+	std::atomic<bool> done = false;
+
+	// The bus of every record is derived from its cycle, so a torn record shows up as a mismatch
+	std::thread producer([&]()
+	{
+		for (uint64_t cycle = 0; cycle < 2000000; cycle++)
+			trace.Push(cycle, (WORD)cycle, (BYTE)(cycle >> 16), cycle & 1);
+		done = true;
+	});
+
+	uint64_t checked = 0;
+	uint64_t torn = 0;
+	do
+	{
+		for (const TraceRecord& record : trace.Read(8))
+		{
+			if (record.Address != (WORD)record.Cycle || record.Data != (BYTE)(record.Cycle >> 16) || record.Read != (bool)(record.Cycle & 1))
+				torn++;
+			checked++;
+		}
+	} while (!done);
+	producer.join();
+
+	EXPECT_GT(checked, 0);
+	EXPECT_EQ(torn, 0);
+
+	// Once the producer is done every slot holds a whole record
+	std::vector<TraceRecord> records = trace.Read(8);
+	ASSERT_EQ(records.size(), 8);
+	EXPECT_EQ(records.front().Cycle, 1999992);
+	EXPECT_EQ(records.back().Cycle, 1999999);
+}
+
+TEST_F(MiscTest, CpuCanWriteTraceFile)
+{
+	BYTE program[] = {
+		0xA2, 0x05,			// LDX Immediate
+		0x9D, 0x00, 0x20,	// STA Absolute X
+		0xCA,				// DEX
+		0xD0, 0xFA,			// BNE (back to STA)
+		0x4C, 0x00, 0xC0	// JMP Absolute
+	};
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+
+	TraceWriter writer;
+	ASSERT_TRUE(writer.Open("TraceTest.trace", 16));
+	MCU->CPU.AttachTraceWriter(&writer);
+	MCU->CPU.EnableTrace(256);
+
+	RunCycles(100);
+	MCU->CPU.AttachTraceWriter(nullptr);
+	RunCycles(10);
+	MCU->CPU.AttachTraceWriter(&writer);	// Resuming after a gap starts a new keyframe
+	RunCycles(20);
+	EXPECT_TRUE(writer.Close());
+
+	std::vector<TraceRecord> expected = MCU->CPU.GetTrace()->Read(256);
+	expected.erase(expected.begin() + 100, expected.begin() + 110);
+
+	TraceReader reader;
+	ASSERT_TRUE(reader.Open("TraceTest.trace"));
+	EXPECT_EQ(reader.GetIndex().size(), 100 / 16 + 1 + 20 / 16 + 1);
+
+	std::vector<TraceRecord> records;
+	uint32_t keyframes = 0;
+	EXPECT_TRUE(reader.Decode(0, UINT64_MAX, [&](const TraceRecord& record) { records.push_back(record); },
+		[&](const TraceKeyframe& frame) { keyframes++; }));
+	EXPECT_EQ(keyframes, reader.GetIndex().size());
+
+	ASSERT_EQ(records.size(), expected.size());
+	for (size_t i = 0; i < records.size(); i++)
+	{
+		EXPECT_EQ(records[i].Cycle, expected[i].Cycle);
+		EXPECT_EQ(records[i].Address, expected[i].Address);
+		EXPECT_EQ(records[i].Data, expected[i].Data);
+		EXPECT_EQ(records[i].Read, expected[i].Read);
+	}
+
+	// Ranges start decoding from the closest keyframe
+	records.clear();
+	EXPECT_TRUE(reader.Decode(40, 45, [&](const TraceRecord& record) { records.push_back(record); }));
+	ASSERT_EQ(records.size(), 6);
+	EXPECT_EQ(records[0].Cycle, 40);
+	EXPECT_EQ(records[5].Address, expected[44].Address);
+
+	// A failed open releases the mapped file, so it can be removed
+	EXPECT_FALSE(reader.Open("MissingTest.trace"));
+	EXPECT_FALSE(reader.Decode(0, UINT64_MAX, [&](const TraceRecord& record) {}));
+	std::remove("TraceTest.trace");
+}
+
+TEST_F(MiscTest, CpuBlockCacheFollowsSelfModifyingCode)
+{
+	BYTE program[] = {
+		0x4C, 0x00, 0x02	// JMP Absolute
+	};
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+
+	BYTE code[] = {
+		0xA9, 0x01,			// LDA Immediate
+		0x8D, 0x06, 0x02,	// STA Absolute (low byte of the LDX below)
+		0xAE, 0x00, 0x03,	// LDX Absolute
+		0xEE, 0x01, 0x02,	// INC Absolute (immediate of the LDA above)
+		0x4C, 0x00, 0x02	// JMP Absolute
+	};
+	for (WORD i = 0; i < PROGRAM_LENGTH(code); i++)
+		MCU->SRAM->WriteByte(0x0200 + i, code[i]);
+	for (WORD i = 0; i < 8; i++)
+		MCU->SRAM->WriteByte(0x0300 + i, 0x10 + i);
+
+	// Every pass loads from the address written by the pass itself
+	for (BYTE pass = 1; pass <= 5; pass++)
+	{
+		MCU->RunUntilPC(0x0208, 1000);
+		EXPECT_EQ(MCU->CPU.X, 0x10 + pass);
+		MCU->RunUntilPC(0x0200, 1000);
+	}
+
+	const BlockCache& cache = MCU->CPU.GetBlockCache();
+	EXPECT_GT(cache.GetDecodes(), 1);
+	EXPECT_GT(cache.GetInvalidations(), 0);
+
+	// Code written from outside the CPU is picked up as well
+	MCU->SRAM->WriteByte(0x0207, 0x04);
+	MCU->SRAM->WriteByte(0x0406, 0x42);
+	MCU->RunUntilPC(0x0208, 1000);
+	EXPECT_EQ(MCU->CPU.X, 0x42);
+}
+
+TEST_F(MiscTest, CpuJitMatchesInterpreter)
+{
+	BYTE program[] = {
+		0xA2, 0x08,			// LDX Immediate
+		0x06, 0x10,			// ASL Zero Page
+		0x26, 0x11,			// ROL Zero Page
+		0xA5, 0x12,			// LDA Zero Page
+		0x7D, 0x00, 0x02,	// ADC Absolute X
+		0x9D, 0x00, 0x03,	// STA Absolute X
+		0x48,				// PHA
+		0x68,				// PLA
+		0xCA,				// DEX
+		0xD0, 0xF1,			// BNE -15
+		0xEE, 0x14, 0x00,	// INC Absolute
+		0x8D, 0x15, 0x02,	// STA Absolute
+		0x4C, 0x00, 0xC0	// JMP Absolute
+	};
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+
+	Computer interpreted(SRAM_MEMORY, EEPROM_MEMORY);
+	interpreted.clock.SetSpeedMS(0);
+	interpreted.clock.Start();
+	interpreted.EEPROM->ShareImage(std::make_shared<std::vector<BYTE>>(MCU->EEPROM->GetData(), MCU->EEPROM->GetData() + EEPROM_MEMORY));
+
+	bool compiled = MCU->CPU.EnableJit(true);
+	EXPECT_EQ(compiled, Jit::IsSupported());
+
+	// Uneven runs end in the middle of instructions and blocks
+	for (uint32_t run = 0; run < 200; run++)
+	{
+		uint64_t cycles = 1 + (run * 37) % 250;
+		EXPECT_EQ(MCU->RunCycles(cycles), interpreted.RunCycles(cycles));
+		if (run % 50 == 25)
+		{
+			MCU->CPU.InterruptIRQ();
+			interpreted.CPU.InterruptIRQ();
+		}
+
+		ASSERT_EQ(MCU->CPU.Cycles, interpreted.CPU.Cycles);
+		ASSERT_EQ(MCU->CPU.PC, interpreted.CPU.PC);
+		ASSERT_EQ(MCU->CPU.A, interpreted.CPU.A);
+		ASSERT_EQ(MCU->CPU.X, interpreted.CPU.X);
+		ASSERT_EQ(MCU->CPU.SP, interpreted.CPU.SP);
+		ASSERT_EQ(MCU->CPU.PS.Byte, interpreted.CPU.PS.Byte);
+		ASSERT_EQ(MCU->CPU.AddressBus, interpreted.CPU.AddressBus);
+		ASSERT_EQ(MCU->CPU.DataBus, interpreted.CPU.DataBus);
+		ASSERT_EQ(MCU->CPU.DataRead, interpreted.CPU.DataRead);
+	}
+	for (WORD address = 0x0200; address < 0x0400; address++)
+		EXPECT_EQ(MCU->SRAM->ReadByte(address), interpreted.SRAM->ReadByte(address));
+
+	if (compiled)
+	{
+		EXPECT_GT(MCU->CPU.GetJit()->GetCompiledBlocks(), 0);
+		EXPECT_GT(MCU->CPU.GetJit()->GetCompiledRuns(), 0);
+	}
+	EXPECT_TRUE(MCU->CPU.EnableJit(false));
+	EXPECT_EQ(MCU->CPU.GetJit(), nullptr);
+}
+
+TEST_F(MiscTest, CpuJitRunsDecimalArithmetic)
+{
+	BYTE program[] = {
+		0xF8,				// SED
+		0xA2, 0x00,			// LDX Immediate
+		0x18,				// CLC
+		0xA5, 0x10,			// LDA Zero Page
+		0x69, 0x07,			// ADC Immediate
+		0x85, 0x10,			// STA Zero Page
+		0x38,				// SEC
+		0xA5, 0x11,			// LDA Zero Page
+		0xE9, 0x03,			// SBC Immediate
+		0x85, 0x11,			// STA Zero Page
+		0xE8,				// INX
+		0xD0, 0xEF,			// BNE -17
+		0x4C, 0x14, 0xC0	// JMP Absolute (to itself)
+	};
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+	bool compiled = MCU->CPU.EnableJit(true);
+
+	MCU->RunCycles(10000);
+	EXPECT_EQ(MCU->CPU.X, 0x00);
+	EXPECT_EQ(MCU->SRAM->ReadByte(0x10), 0x92);	// 256 * 7 in BCD
+	EXPECT_EQ(MCU->SRAM->ReadByte(0x11), 0x32);	// -256 * 3 in BCD
+	if (compiled)
+		EXPECT_GT(MCU->CPU.GetJit()->GetCompiledRuns(), 0);
+}
+
+TEST_F(MiscTest, CpuSkipsIdleLoops)
+{
+	BYTE program[] = {
+		0xA2, 0x05,			// LDX Immediate
+		0xCA,				// DEX
+		0xD0, 0xFD,			// BNE -3
+		0xA5, 0x10,			// LDA Zero Page
+		0x29, 0x01,			// AND Immediate
+		0xF0, 0xFA,			// BEQ -6
+		0xE8,				// INX
+		0x4C, 0x0C, 0xC0	// JMP Absolute (to itself)
+	};
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+
+	Computer interpreted(SRAM_MEMORY, EEPROM_MEMORY);
+	interpreted.clock.SetSpeedMS(0);
+	interpreted.clock.Start();
+	interpreted.EEPROM->ShareImage(std::make_shared<std::vector<BYTE>>(MCU->EEPROM->GetData(), MCU->EEPROM->GetData() + EEPROM_MEMORY));
+	interpreted.CPU.EnableIdleSkip(false);
+
+	// The poll loop idles until $10 changes, then the JMP loop idles for good
+	for (uint32_t run = 0; run < 100; run++)
+	{
+		uint64_t cycles = 1 + (run * 997) % 5000;
+		EXPECT_EQ(MCU->RunCycles(cycles), interpreted.RunCycles(cycles));
+		if (run == 50)
+		{
+			EXPECT_EQ(MCU->CPU.X, 0x00);
+			MCU->SRAM->WriteByte(0x10, 0x01);
+			interpreted.SRAM->WriteByte(0x10, 0x01);
+		}
+
+		ASSERT_EQ(MCU->CPU.Cycles, interpreted.CPU.Cycles);
+		ASSERT_EQ(MCU->CPU.PC, interpreted.CPU.PC);
+		ASSERT_EQ(MCU->CPU.A, interpreted.CPU.A);
+		ASSERT_EQ(MCU->CPU.X, interpreted.CPU.X);
+		ASSERT_EQ(MCU->CPU.PS.Byte, interpreted.CPU.PS.Byte);
+		ASSERT_EQ(MCU->CPU.AddressBus, interpreted.CPU.AddressBus);
+		ASSERT_EQ(MCU->CPU.DataBus, interpreted.CPU.DataBus);
+	}
+	EXPECT_EQ(MCU->CPU.X, 0x01);
+	EXPECT_GT(MCU->CPU.GetIdleCycles(), MCU->CPU.Cycles / 2);
+	EXPECT_EQ(interpreted.CPU.GetIdleCycles(), 0);
+
+	ComputerSnapshot snapshot;
+	MCU->TakeSnapshot(snapshot);
+	EXPECT_EQ(snapshot.IdleCycles, MCU->CPU.GetIdleCycles());
+}
+
+TEST_F(MiscTest, CpuSkipsDelayLoops)
+{
+	BYTE program[0x103] = {
+		0xA2, 0x00,			// LDX Immediate
+		0xCA,				// DEX
+		0xD0, 0xFD,			// BNE -3
+		0xA2, 0x03,			// LDX Immediate
+		0xA0, 0x00,			// LDY Immediate
+		0x88,				// DEY
+		0xD0, 0xFD,			// BNE -3
+		0xCA,				// DEX
+		0xD0, 0xF8,			// BNE -8
+		0xC8,				// INY
+		0xC8,				// INY
+		0xD0, 0xFD,			// BNE -3
+		0x4C, 0xFD, 0xC0	// JMP Absolute
+	};
+	// The branch back crosses a page
+	program[0xFD] = 0xCA;	// DEX
+	program[0xFE] = 0xD0;	// BNE -3
+	program[0xFF] = 0xFD;
+	program[0x100] = 0x4C;	// JMP Absolute (to itself)
+	program[0x101] = 0x00;
+	program[0x102] = 0xC1;
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+
+	Computer interpreted(SRAM_MEMORY, EEPROM_MEMORY);
+	interpreted.clock.SetSpeedMS(0);
+	interpreted.clock.Start();
+	interpreted.EEPROM->ShareImage(std::make_shared<std::vector<BYTE>>(MCU->EEPROM->GetData(), MCU->EEPROM->GetData() + EEPROM_MEMORY));
+	interpreted.CPU.EnableIdleSkip(false);
+
+	for (uint32_t run = 0; run < 60; run++)
+	{
+		uint64_t cycles = 1 + (run * 397) % 800;
+		EXPECT_EQ(MCU->RunCycles(cycles), interpreted.RunCycles(cycles));
+
+		ASSERT_EQ(MCU->CPU.Cycles, interpreted.CPU.Cycles);
+		ASSERT_EQ(MCU->CPU.PC, interpreted.CPU.PC);
+		ASSERT_EQ(MCU->CPU.X, interpreted.CPU.X);
+		ASSERT_EQ(MCU->CPU.Y, interpreted.CPU.Y);
+		ASSERT_EQ(MCU->CPU.PS.Byte, interpreted.CPU.PS.Byte);
+		ASSERT_EQ(MCU->CPU.AddressBus, interpreted.CPU.AddressBus);
+		ASSERT_EQ(MCU->CPU.DataBus, interpreted.CPU.DataBus);
+	}
+	EXPECT_EQ(MCU->CPU.PC, 0xC102);
+	EXPECT_EQ(MCU->CPU.X, 0x00);
+	EXPECT_EQ(MCU->CPU.Y, 0x00);
+	EXPECT_GT(MCU->CPU.GetIdleCycles(), 0);
+}
+
+TEST_F(MiscTest, SchedulerRunsEventsInOrder)
+{
+	Scheduler events;
+	std::vector<int> order;
+
+	events.Schedule(20, [&](uint64_t cycle) { order.push_back(2); });
+	events.Schedule(10, [&](uint64_t cycle) { order.push_back(0); });
+	events.Schedule(10, [&](uint64_t cycle) { order.push_back(1); });
+	EventId cancelled = events.Schedule(15, [&](uint64_t cycle) { order.push_back(-1); });
+	events.Schedule(30, [&](uint64_t cycle)
+		{
+			order.push_back(3);
+			events.Schedule(cycle + 5, [&](uint64_t cycle) { order.push_back(4); });
+		});
+	EXPECT_EQ(events.GetNextCycle(), 10);
+
+	EXPECT_TRUE(events.Cancel(cancelled));
+	EXPECT_FALSE(events.Cancel(cancelled));
+
+	events.Run(9);
+	EXPECT_TRUE(order.empty());
+	events.Run(30);
+	EXPECT_EQ(order, std::vector<int>({ 0, 1, 2, 3 }));
+	EXPECT_EQ(events.GetNextCycle(), 35);
+	events.Run(100);
+	EXPECT_EQ(order, std::vector<int>({ 0, 1, 2, 3, 4 }));
+	EXPECT_EQ(events.GetNextCycle(), UINT64_MAX);
+	EXPECT_EQ(events.GetRunCount(), 5);
+}
+
+TEST_F(MiscTest, ComputerStopsAtScheduledEvents)
+{
+	BYTE program[] = {
+		0x58,				// CLI
+		0x4C, 0x01, 0xC0	// JMP Absolute (to itself)
+	};
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+
+	Computer stepped(SRAM_MEMORY, EEPROM_MEMORY);
+	stepped.clock.SetSpeedMS(0);
+	stepped.clock.Start();
+	stepped.EEPROM->ShareImage(std::make_shared<std::vector<BYTE>>(MCU->EEPROM->GetData(), MCU->EEPROM->GetData() + EEPROM_MEMORY));
+
+	// The idle loop is skipped up to the interrupt, which lands on the same cycle as when stepping
+	MCU->Events.Schedule(5001, [this](uint64_t cycle) { MCU->CPU.InterruptIRQ(); });
+	stepped.Events.Schedule(5001, [&stepped](uint64_t cycle) { stepped.CPU.InterruptIRQ(); });
+
+	EXPECT_EQ(MCU->RunCycles(3000), 3000);
+	EXPECT_EQ(MCU->RunCycles(3000), 3000);
+	for (uint32_t i = 0; i < 6000; i++)
+		stepped.RunCycle();
+
+	EXPECT_EQ(MCU->Events.GetPendingCount(), 0);
+	EXPECT_GT(MCU->CPU.GetIdleCycles(), 4000);
+	EXPECT_NE(MCU->CPU.SP, 0xFD);
+	EXPECT_EQ(MCU->CPU.Cycles, stepped.CPU.Cycles);
+	EXPECT_EQ(MCU->CPU.PC, stepped.CPU.PC);
+	EXPECT_EQ(MCU->CPU.SP, stepped.CPU.SP);
+	EXPECT_EQ(MCU->CPU.AddressBus, stepped.CPU.AddressBus);
+}
+
 TEST_F(MiscTest, MemoryCanGetCorrectSizeAndZeroAddress)
 {
 	MCU->SRAM->ChangeMemory(16 * 1024, 0); // $0000 -> $3FFF
@@ -37,6 +694,247 @@ TEST_F(MiscTest, MemoryCanGetCorrectSizeAndZeroAddress)
 	EXPECT_FALSE(MCU->SRAM->IsAddressOk(0x8000));
 }
 
+TEST_F(MiscTest, CpuBusFollowsMemoryLayoutChanges)
+{
+	BYTE program[] = {
+		0xA9, 0x42,			// LDA Immediate
+		0x8D, 0x00, 0x40,	// STA Absolute
+		0xAD, 0x00, 0x40	// LDA Absolute
+	};
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+
+	RunCycles(8 + 2 + 4);
+	EXPECT_EQ(MCU->SRAM->ReadByte(0x4000), 0x42);
+
+	// $0000 -> $3FFF, the write above is gone and $4000 is now unmapped
+	MCU->SRAM->ChangeMemory(16 * 1024, 0);
+	RunCycles(4);
+	EXPECT_EQ(MCU->CPU.A, 0x40);	// Nothing drives the data bus, last fetched byte remains
+	EXPECT_EQ(MCU->SRAM->ReadByte(0x4000), 0x00);
+
+	// $4000 -> $7FFF
+	MCU->SRAM->ChangeMemory(16 * 1024, 16 * 1024);
+	MCU->SRAM->WriteByte(0x4000, 0x24);
+	MCU->CPU.PC = 0xC005;
+	RunCycles(4);
+	EXPECT_EQ(MCU->CPU.A, 0x24);
+}
+
+TEST_F(MiscTest, CpuCannotWriteToROM)
+{
+	BYTE program[] = {
+		0xA9, 0x42,			// LDA Immediate
+		0x8D, 0x00, 0xC0,	// STA Absolute (first byte of this program)
+		0xEE, 0x01, 0xC0,	// INC Absolute (immediate of the LDA above)
+		0x8D, 0x00, 0x02	// STA Absolute
+	};
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+
+	RunCycles(8 + 2 + 4 + 6 + 4);
+	EXPECT_EQ(MCU->EEPROM->ReadByte(0xC000), 0xA9);
+	EXPECT_EQ(MCU->EEPROM->ReadByte(0xC001), 0x42);
+	EXPECT_EQ(MCU->SRAM->ReadByte(0x0200), 0x42);
+	EXPECT_FALSE(MCU->CPU.DataRead);
+
+	// The host still programs the EEPROM
+	MCU->EEPROM->WriteByte(0xC001, 0x24);
+	MCU->CPU.PC = 0xC000;
+	RunCycles(2);
+	EXPECT_EQ(MCU->CPU.A, 0x24);
+}
+
+TEST_F(MiscTest, MemoryCanShareImage)
+{
+	auto image = std::make_shared<std::vector<BYTE>>(EEPROM_MEMORY, 0xEA);
+	(*image)[0] = 0xA9;	// LDA Immediate
+	(*image)[1] = 0x42;
+	(*image)[0xFFFC - 0xC000] = 0x00;
+	(*image)[0xFFFD - 0xC000] = 0xC0;
+
+	MCU->EEPROM->ShareImage(image);
+	EXPECT_TRUE(MCU->EEPROM->IsShared());
+	EXPECT_EQ(MCU->EEPROM->GetData(), image->data());
+
+	RunCycles(8 + 2);
+	EXPECT_EQ(MCU->CPU.A, 0x42);
+
+	// Writing gives the memory its own copy and leaves the image untouched
+	MCU->EEPROM->WriteByte(0xC001, 0x24);
+	EXPECT_FALSE(MCU->EEPROM->IsShared());
+	EXPECT_EQ(MCU->EEPROM->ReadByte(0xC001), 0x24);
+	EXPECT_EQ((*image)[1], 0x42);
+
+	MCU->CPU.PC = 0xC000;
+	RunCycles(2);
+	EXPECT_EQ(MCU->CPU.A, 0x24);
+}
+
+TEST_F(MiscTest, MemoryCanMapImage)
+{
+	std::vector<BYTE> firmware(EEPROM_MEMORY, 0xEA);
+	firmware[0] = 0xA9;	// LDA Immediate
+	firmware[1] = 0x42;
+	firmware[0xFFFC - 0xC000] = 0x00;
+	firmware[0xFFFD - 0xC000] = 0xC0;
+	{
+		std::ofstream file("MapTest.bin", std::ios::binary);
+		file.write((const char*)firmware.data(), firmware.size());
+	}
+
+	MemoryImage image = Memory::LoadImage("MapTest.bin");
+	ASSERT_TRUE(image);
+	EXPECT_TRUE(image.IsMapped());
+	EXPECT_EQ(image.GetSize(), EEPROM_MEMORY);
+	EXPECT_EQ(image[1], 0x42);
+
+	// The mapping backs the EEPROM without a copy
+	MCU->EEPROM->ShareImage(image);
+	EXPECT_EQ(MCU->EEPROM->GetData(), image.GetData());
+	RunCycles(8 + 2);
+	EXPECT_EQ(MCU->CPU.A, 0x42);
+
+	// Writing copies it, the file is left untouched
+	MCU->EEPROM->WriteByte(0xC001, 0x24);
+	EXPECT_FALSE(MCU->EEPROM->IsShared());
+	EXPECT_EQ(image[1], 0x42);
+
+	// Smaller images are rejected, unless asked to be loaded to the top of the memory
+	{
+		std::ofstream file("MapTest.bin", std::ios::binary | std::ios::trunc);
+		file.write((const char*)firmware.data() + EEPROM_MEMORY - 4, 4);
+	}
+	EXPECT_FALSE(MCU->EEPROM->LoadProgram("MapTest.bin"));
+	EXPECT_EQ(MCU->EEPROM->ReadByte(0xC001), 0x24);
+	EXPECT_TRUE(MCU->EEPROM->LoadProgramAtTop("MapTest.bin"));
+	EXPECT_FALSE(MCU->EEPROM->IsShared());
+	EXPECT_EQ(MCU->EEPROM->ReadByte(0xC001), 0x00);
+	EXPECT_EQ(MCU->EEPROM->ReadByte(0xFFFD), 0xC0);
+
+	// Empty files give no image and leave the memory alone
+	{
+		std::ofstream file("MapTest.bin", std::ios::binary | std::ios::trunc);
+	}
+	EXPECT_FALSE(Memory::LoadImage("MapTest.bin"));
+	EXPECT_FALSE(MCU->EEPROM->LoadProgramAtTop("MapTest.bin"));
+	EXPECT_EQ(MCU->EEPROM->ReadByte(0xFFFD), 0xC0);
+
+	std::remove("MapTest.bin");
+}
+
+TEST_F(MiscTest, ProgramLoaderReadsIntelHex)
+{
+	// Data at $C000 and $0200, then $10000 through an extended linear address record
+	std::istringstream input(
+		":03C00000A942EA68\r\n"
+		":020200001234B6\n"
+		":020000040001F9\n"
+		":0100000055AA\n"
+		":00000001FF\n");
+
+	ProgramLoader loader(MCU->SRAM, MCU->EEPROM);
+	ASSERT_TRUE(loader.Load(input));
+	EXPECT_EQ(MCU->EEPROM->ReadByte(0xC000), 0xA9);
+	EXPECT_EQ(MCU->EEPROM->ReadByte(0xC001), 0x42);
+	EXPECT_EQ(MCU->EEPROM->ReadByte(0xC002), 0xEA);
+	EXPECT_EQ(MCU->SRAM->ReadByte(0x0200), 0x12);
+	EXPECT_EQ(MCU->SRAM->ReadByte(0x0201), 0x34);
+
+	const ProgramLoadStats& stats = loader.GetStats();
+	EXPECT_EQ(stats.Records, 3);
+	EXPECT_EQ(stats.BytesLoaded, 5);
+	EXPECT_EQ(stats.BytesSkipped, 1);
+
+	std::istringstream corrupt(":03C00000A942EA69\n");
+	EXPECT_FALSE(loader.Load(corrupt));
+}
+
+TEST_F(MiscTest, ProgramLoaderReadsSRecords)
+{
+	std::istringstream input(
+		"S00600004844521B\n"
+		"S106C000A942EA64\n"
+		"S2060002001234B1\n"
+		"S9030000FC\n");
+
+	ProgramLoader loader(MCU->SRAM, MCU->EEPROM);
+	ASSERT_TRUE(loader.Load(input));
+	EXPECT_EQ(MCU->EEPROM->ReadByte(0xC000), 0xA9);
+	EXPECT_EQ(MCU->EEPROM->ReadByte(0xC002), 0xEA);
+	EXPECT_EQ(MCU->SRAM->ReadByte(0x0200), 0x12);
+	EXPECT_EQ(MCU->SRAM->ReadByte(0x0201), 0x34);
+	EXPECT_EQ(loader.GetStats().Records, 2);
+
+	std::istringstream corrupt("S106C000A942EA65\n");
+	EXPECT_FALSE(loader.Load(corrupt));
+}
+
+TEST_F(MiscTest, ProgramLoaderReadsImagesStartingLikeText)
+{
+	// Images starting with ':' or "S<digit>" are not taken for text records
+	std::string image(EEPROM_MEMORY, (char)0xEA);
+	image[0] = ':';
+	image[1] = (char)0xA9;
+	image[0xFFFC - 0xC000] = 0x00;
+	image[0xFFFD - 0xC000] = (char)0xC0;
+
+	ProgramLoader loader(MCU->SRAM, MCU->EEPROM);
+	std::istringstream colon(image);
+	EXPECT_EQ(loader.DetectFormat(colon), ProgramFormat::Image);
+	ASSERT_TRUE(loader.Load(colon));
+	EXPECT_EQ(MCU->EEPROM->ReadByte(0xC000), ':');
+	EXPECT_EQ(MCU->EEPROM->ReadByte(0xC001), 0xA9);
+
+	image[0] = 'S';
+	image[1] = '1';
+	image[2] = '0';
+	std::istringstream record(image);
+	EXPECT_EQ(loader.DetectFormat(record), ProgramFormat::Image);
+	ASSERT_TRUE(loader.Load(record));
+	EXPECT_EQ(MCU->EEPROM->ReadByte(0xC000), 'S');
+	EXPECT_EQ(MCU->EEPROM->ReadByte(0xC002), '0');
+}
+
+TEST_F(MiscTest, ProgramLoaderReadsSegments)
+{
+	// A segment across the end of SRAM and the unmapped addresses, then the reset vector
+	std::string segments = {
+		SEGMENTS_MAGIC[0], SEGMENTS_MAGIC[1], SEGMENTS_MAGIC[2], SEGMENTS_MAGIC[3],
+		(char)0xFE, 0x7F, 0x04, 0x00, 0x11, 0x22, 0x33, 0x44,
+		(char)0xFC, (char)0xFF, 0x02, 0x00, 0x00, (char)0xC0
+	};
+	MCU->EEPROM->WriteByte(0xC000, 0xEA);
+	std::istringstream input(segments);
+
+	ProgramLoader loader(MCU->SRAM, MCU->EEPROM);
+	EXPECT_EQ(loader.DetectFormat(input), ProgramFormat::Segments);
+	ASSERT_TRUE(loader.Load(input));
+	EXPECT_EQ(MCU->SRAM->ReadByte(0x7FFE), 0x11);
+	EXPECT_EQ(MCU->SRAM->ReadByte(0x7FFF), 0x22);
+	EXPECT_EQ(MCU->EEPROM->ReadByte(0xFFFC), 0x00);
+	EXPECT_EQ(MCU->EEPROM->ReadByte(0xFFFD), 0xC0);
+	EXPECT_EQ(MCU->EEPROM->ReadByte(0xC000), 0xEA);	// Untouched
+
+	const ProgramLoadStats& stats = loader.GetStats();
+	EXPECT_EQ(stats.Records, 2);
+	EXPECT_EQ(stats.FileBytes, segments.size());
+	EXPECT_EQ(stats.BytesLoaded, 4);
+	EXPECT_EQ(stats.BytesSkipped, 2);
+
+	// The CPU runs from what was loaded
+	RunCycles(8);
+	EXPECT_EQ(MCU->CPU.PC, 0xC000);
+
+	std::istringstream truncated(segments.substr(0, 10));
+	EXPECT_FALSE(loader.Load(truncated, ProgramFormat::Segments));
+
+	// Other binaries are neither taken for segments nor loaded
+	std::istringstream unknown(segments.substr(sizeof(SEGMENTS_MAGIC)));
+	EXPECT_EQ(loader.DetectFormat(unknown), ProgramFormat::Unknown);
+	EXPECT_FALSE(loader.Load(unknown));
+	EXPECT_FALSE(loader.Load(unknown, ProgramFormat::Segments));
+	EXPECT_EQ(MCU->SRAM->ReadByte(0x7FFE), 0x11);
+}
+
 TEST_F(MiscTest, MemoryCanReadAndWrite)
 {
 	MCU->SRAM->ChangeMemory(16 * 1024, 0); // $0000 -> $3FFF
@@ -99,4 +997,181 @@ TEST_F(MiscTest, ClockCanStartAndStopAndStep)
 	EXPECT_TRUE(MCU->clock.IsRunning());
 
 	// TODO: Test Step()
-}
\ No newline at end of file
+}
+
+TEST_F(MiscTest, ClockHandsOutCycleQuanta)
+{
+	MCU->clock.SetSpeedHZ(1000000);
+	MCU->clock.Start();
+	EXPECT_GE(MCU->clock.WaitForNextQuantum(), 1000);	// 1 ms worth, more if the test fell behind
+	EXPECT_EQ(MCU->clock.WaitForNextQuantum(10), 10);
+
+	// Overruns are caught up at once, up to 100 ms worth
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	EXPECT_GE(MCU->clock.WaitForNextQuantum(), 18000);
+	std::this_thread::sleep_for(std::chrono::milliseconds(150));
+	EXPECT_EQ(MCU->clock.WaitForNextQuantum(), 100000);
+	EXPECT_GT(MCU->clock.GetDroppedCycles(), 0);
+
+	// Running can not get ahead of the requested speed
+	auto start = std::chrono::steady_clock::now();
+	EXPECT_EQ(MCU->RunCycles(5000), 5000);
+	EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(4));
+	EXPECT_LE(MCU->clock.GetAchievedHZ(), MCU->clock.GetRequestedHZ() * 1.01);
+
+	MCU->clock.Stop();
+	EXPECT_EQ(MCU->clock.WaitForNextQuantum(), 0);
+
+	MCU->clock.Step();
+	EXPECT_EQ(MCU->clock.WaitForNextQuantum(), 1);
+	EXPECT_FALSE(MCU->clock.IsRunning());
+}
+
+TEST_F(MiscTest, EmulationThreadRunsComputer)
+{
+	BYTE program[] = {
+		0xE8,				// INX
+		0x4C, 0x00, 0xC0	// JMP Absolute
+	};
+	LoadProgramToEEPROM(program, PROGRAM_LENGTH(program));
+	MCU->clock.Stop();
+
+	auto emulator = std::make_unique<EmulationThread>(MCU);
+	auto waitFor = [&emulator](auto condition)
+	{
+		auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while (std::chrono::steady_clock::now() < timeout)
+		{
+			if (condition(emulator->ReadSnapshot()))
+				return true;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return false;
+	};
+
+	EXPECT_TRUE(emulator->Start());
+	EXPECT_TRUE(waitFor([](const ComputerSnapshot& snapshot) { return snapshot.Cycles > 100000; }));
+
+	EXPECT_TRUE(emulator->Stop());
+	EXPECT_TRUE(waitFor([](const ComputerSnapshot& snapshot) { return !snapshot.Running; }));
+
+	uint64_t cycles = emulator->ReadSnapshot().Cycles;
+	EXPECT_TRUE(emulator->Step());
+	EXPECT_TRUE(waitFor([cycles](const ComputerSnapshot& snapshot) { return snapshot.Cycles == cycles + 1; }));
+
+	const ComputerSnapshot& snapshot = emulator->ReadSnapshot();
+	EXPECT_EQ(snapshot.Memory[0xC001], 0x4C);
+	EXPECT_EQ(snapshot.Memory[0xFFFD], 0xC0);
+	EXPECT_FALSE(snapshot.Running);
+
+	emulator.reset();
+	EXPECT_EQ(MCU->CPU.Cycles, cycles + 1);
+}
+
+
+TEST_F(MiscTest, FleetRunsMachinesOnSharedROM)
+{
+	auto ROM = std::make_shared<std::vector<BYTE>>(EEPROM_MEMORY, 0xEA);
+	BYTE program[] = {
+		0xE8,				// INX
+		0x8E, 0x00, 0x20,	// STX Absolute
+		0x4C, 0x00, 0xC0	// JMP Absolute
+	};
+	std::copy(std::begin(program), std::end(program), ROM->begin());
+	(*ROM)[0xFFFC - 0xC000] = 0x00;
+	(*ROM)[0xFFFD - 0xC000] = 0xC0;
+
+	Fleet fleet(16, SRAM_MEMORY, ROM, 4);
+	EXPECT_EQ(fleet.GetSize(), 16);
+	EXPECT_EQ(fleet.GetThreadCount(), 4);
+
+	EXPECT_EQ(fleet.Run(10003, 1000), 16 * 10003);
+	EXPECT_GT(fleet.GetEmulatedMHz(), 0);
+	EXPECT_EQ(fleet.Run(5000), 16 * 5000);
+
+	for (uint32_t i = 0; i < fleet.GetSize(); i++)
+	{
+		Computer& computer = fleet.GetComputer(i);
+		EXPECT_EQ(computer.CPU.Cycles, 15003);
+		EXPECT_EQ(computer.CPU.X, fleet.GetComputer(0).CPU.X);
+		EXPECT_EQ(computer.SRAM->ReadByte(0x2000), fleet.GetComputer(0).SRAM->ReadByte(0x2000));
+		EXPECT_EQ(computer.EEPROM->GetData(), ROM->data());
+	}
+}
+
+TEST_F(MiscTest, LockstepLanesMatchCpu)
+{
+	auto ROM = std::make_shared<std::vector<BYTE>>(EEPROM_MEMORY, 0xEA);
+	BYTE program[] = {
+		0xA6, 0x10,			// LDX Zero Page
+		0xCA,				// DEX
+		0xD0, 0xFD,			// BNE -3
+		0xA5, 0x11,			// LDA Zero Page
+		0x65, 0x10,			// ADC Zero Page
+		0x85, 0x11,			// STA Zero Page
+		0xE6, 0x10,			// INC Zero Page
+		0xA0, 0x05,			// LDY Immediate
+		0xB1, 0x20,			// LDA Indirect Y
+		0x9D, 0x00, 0x03,	// STA Absolute X
+		0x4C, 0x00, 0xC0	// JMP Absolute
+	};
+	std::copy(std::begin(program), std::end(program), ROM->begin());
+	(*ROM)[0xFFFC - 0xC000] = 0x00;
+	(*ROM)[0xFFFD - 0xC000] = 0xC0;
+
+	// Every lane counts down from a different value, so the lanes drift apart
+	const uint32_t lanes = 8;
+	LockstepCPU lockstep(lanes, SRAM_MEMORY, ROM);
+	EXPECT_EQ(lockstep.GetLaneCount(), lanes);
+
+	std::vector<std::unique_ptr<Computer>> computers;
+	for (uint32_t lane = 0; lane < lanes; lane++)
+	{
+		computers.push_back(std::make_unique<Computer>(SRAM_MEMORY, EEPROM_MEMORY));
+		Computer& computer = *computers.back();
+		computer.clock.SetSpeedMS(0);
+		computer.clock.Start();
+		computer.EEPROM->ShareImage(ROM);
+
+		// The CPU leaves its registers uninitialised on power on
+		CPU& cpu = computer.CPU;
+		cpu.A = cpu.X = cpu.Y = 0;
+		cpu.PS.Byte = 0;
+		cpu.AddressBus = 0;
+		cpu.DataBus = 0;
+
+		BYTE memory[][2] = { { 0x10, BYTE(lane + 1) }, { 0x11, BYTE(lane * 3) }, { 0x20, BYTE(0xFE - lane) }, { 0x21, 0x01 } };
+		for (auto& [address, value] : memory)
+		{
+			computer.SRAM->WriteByte(address, value);
+			lockstep.WriteByte(lane, address, value);
+		}
+	}
+
+	for (uint32_t cycle = 0; cycle < 3000; cycle++)
+	{
+		lockstep.RunCycles(1);
+		for (uint32_t lane = 0; lane < lanes; lane++)
+		{
+			CPU& cpu = computers[lane]->CPU;
+			computers[lane]->RunCycle();
+			ASSERT_EQ(lockstep.AddressBus[lane], cpu.AddressBus);
+			ASSERT_EQ(lockstep.DataBus[lane], cpu.DataBus);
+			ASSERT_EQ(lockstep.DataRead[lane], cpu.DataRead);
+		}
+	}
+
+	for (uint32_t lane = 0; lane < lanes; lane++)
+	{
+		CPU& cpu = computers[lane]->CPU;
+		EXPECT_EQ(lockstep.PC[lane], cpu.PC);
+		EXPECT_EQ(lockstep.SP[lane], cpu.SP);
+		EXPECT_EQ(lockstep.PS[lane].Byte, cpu.PS.Byte);
+		EXPECT_EQ(lockstep.A[lane], cpu.A);
+		EXPECT_EQ(lockstep.X[lane], cpu.X);
+		EXPECT_EQ(lockstep.Y[lane], cpu.Y);
+		EXPECT_EQ(lockstep.Cycles[lane], cpu.Cycles);
+		EXPECT_EQ(lockstep.ReadByte(lane, 0x11), computers[lane]->SRAM->ReadByte(0x11));
+	}
+	EXPECT_GT(lockstep.GetAverageGroups(), 1.0);
+}
@@ -0,0 +1,68 @@
+#include <Log.h>
+#include <TraceFile.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// Turns a binary bus trace into text, one "$ADDR - "r" $DATA" line per cycle
+//
+// 6502_TraceDecoder <trace file> [first cycle] [last cycle] [--registers]
+//   --registers  also prints the registers stored in every keyframe
+
+static void PrintUsage()
+{
+	std::printf("Usage: 6502_TraceDecoder <trace file> [first cycle] [last cycle] [--registers]\n");
+}
+
+int main(int argc, char* argv[])
+{
+	Log::Init();
+
+	const char* filepath = nullptr;
+	uint64_t bounds[2] = { 0, UINT64_MAX };
+	int boundCount = 0;
+	bool printRegisters = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--registers") == 0)
+			printRegisters = true;
+		else if (filepath == nullptr)
+			filepath = argv[i];
+		else if (boundCount < 2)
+			bounds[boundCount++] = std::strtoull(argv[i], nullptr, 0);
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	if (filepath == nullptr)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	TraceReader reader;
+	if (!reader.Open(filepath))
+		return 1;
+
+	auto onRecord = [](const TraceRecord& record)
+	{
+		std::printf("$%04X - %s $%02X\n", record.Address, record.Read ? "\"r\"" : "\"W\"", record.Data);
+	};
+
+	auto onKeyframe = [](const TraceKeyframe& frame)
+	{
+		std::printf("; Cycle %llu PC=$%04X SP=$%02X PS=$%02X A=$%02X X=$%02X Y=$%02X\n",
+			(unsigned long long)frame.Cycle, frame.PC, frame.SP, frame.PS, frame.A, frame.X, frame.Y);
+	};
+
+	bool decoded = printRegisters ? reader.Decode(bounds[0], bounds[1], onRecord, onKeyframe) : reader.Decode(bounds[0], bounds[1], onRecord);
+
+	Log::Shutdown();
+	return decoded ? 0 : 1;
+}
@@ -19,4 +19,6 @@ group ""
 
 include "6502"
 include "6502_GUI"
-include "6502_Tests"
\ No newline at end of file
+include "6502_Tests"
+include "6502_TraceDecoder"
+include "6502_Recompiler"
\ No newline at end of file